@@ -0,0 +1,128 @@
+// AdaptiveValidationBenchmark.cpp : Parsing clean and noisy synthetic sources with adaptive validation, against
+// validating every line fully.
+//
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <Nmea/AdaptiveValidation.h>
+#include <Nmea/CorpusGenerator.h>
+#include <Nmea/LineFramer.h>
+#include <Nmea/Nmea.h>
+
+#include "Benchmarks.h"
+#include "Results.h"
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    const size_t chunkBytes = 16 << 10;
+    const size_t chunksPerSource = 48;
+
+    // The error rate of each source, the clean ones are trusted after a while
+    const double errorRates[] = { 0.0, 0.0, 0.0, 0.0001, 0.02 };
+    const size_t sources = std::size(errorRates);
+    const size_t rareErrors = 3;    // Trusted, and demoted by its first error
+    const size_t noisy = 4;         // Never clean long enough to be trusted
+
+    // Parses the chunks of the sources in turn, the lines parsed per second.
+    // The tag blocks of the corpus all have an s: source, which a line validated less shall keep.
+    double run(const std::vector<std::vector<std::string>>& chunks, const std::vector<SourceId>& ids, AdaptiveValidation* adaptive,
+        uint64_t& reducedTagged, uint64_t& lostTagBlocks)
+    {
+        Nmea nmea;
+        nmea.setAdaptiveValidation(adaptive);
+
+        uint64_t lines = 0;
+        const auto start = Clock::now();
+        for (size_t chunk = 0; chunk < chunksPerSource; ++chunk)
+        {
+            for (size_t i = 0; i < sources; ++i)
+            {
+                const LineOrigin origin{ ids[i], 0 };
+                LineFramer::split(chunks[i][chunk], [&](std::string_view line) {
+                    nmea.parse(line, origin);
+                    ++lines;
+                    if (nmea.validated() != Validation::full && nmea.errorCode() == ErrorCode::E000 && line[0] == '\\')
+                    {
+                        ++reducedTagged;
+                        lostTagBlocks += nmea.tagBlock().has(TagBlock::source) ? 0 : 1;
+                    }
+                });
+            }
+        }
+
+        return lines / std::chrono::duration<double>(Clock::now() - start).count();
+    }
+}
+
+void adaptiveValidationBenchmark()
+{
+    std::vector<std::vector<std::string>> chunks(sources);
+    std::vector<SourceId> ids(sources);
+    for (size_t i = 0; i < sources; ++i)
+    {
+        CorpusGenerator generator(i + 1, errorRates[i]);
+        ids[i] = SourceInterner::global().intern("adaptive" + std::to_string(i));
+        chunks[i].resize(chunksPerSource);
+        for (auto& chunk : chunks[i])
+            generator.fill(chunk, chunkBytes);
+    }
+
+    AdaptiveValidation::Options options;
+    options.cleanLines = 1000;
+    options.sampleInterval = 100;
+    AdaptiveValidation adaptive(options);
+
+    uint64_t reducedTagged = 0;
+    uint64_t lostTagBlocks = 0;
+    const double full = run(chunks, ids, nullptr, reducedTagged, lostTagBlocks);
+    const double adapted = run(chunks, ids, &adaptive, reducedTagged, lostTagBlocks);
+
+    std::cout << std::fixed << std::setprecision(0) << full << " lines/s validating fully, " << adapted
+        << " lines/s adaptive, trusted after " << options.cleanLines << " clean lines, 1 in " << options.sampleInterval
+        << " sampled" << std::endl;
+    Results::record("adaptive/full/rate", "lines/s", full);
+    Results::record("adaptive/rate", "lines/s", adapted);
+
+    std::cout << "  source      errors  mode     full lines  reduced lines  errors  demotions  full ns  reduced ns  saved ms" << std::endl;
+    size_t seen = 0;
+    for (const auto& entry : adaptive.snapshot())
+    {
+        size_t i = 0;
+        while (i < sources && ids[i] != entry.source)
+            ++i;
+        if (i == sources)
+            continue;
+        ++seen;
+
+        std::cout << "  " << std::left << std::setw(11) << SourceInterner::global().name(entry.source) << std::right
+            << std::setprecision(2) << std::setw(6) << errorRates[i] * 100 << "%  " << std::left << std::setw(7)
+            << (entry.trusted ? "trusted" : "full") << std::right << std::setprecision(0) << std::setw(12) << entry.fullLines
+            << std::setw(15) << entry.reducedLines << std::setw(8) << entry.errors << std::setw(11) << entry.demotions
+            << std::setw(9) << entry.fullNs << std::setw(12) << entry.reducedNs << std::setprecision(1) << std::setw(10)
+            << entry.savedNs / 1e6 << std::endl;
+
+        const std::string name(SourceInterner::global().name(entry.source));
+        Results::record("adaptive/" + name + "/saved", "ms", entry.savedNs / 1e6);
+
+        if (errorRates[i] == 0 && !entry.trusted)
+            Results::fail("adaptive: " + name + " is clean and not trusted");
+        if (i == rareErrors && (entry.errors == 0 || entry.demotions == 0))
+            Results::fail("adaptive: " + name + " has not been demoted by an error");
+        if (i == noisy && (entry.trusted || entry.reducedLines != 0 || entry.errors == 0))
+            Results::fail("adaptive: " + name + " has " + std::to_string(entry.errors) + " errors and " + std::to_string(entry.reducedLines) + " lines not validated fully");
+    }
+
+    if (seen != sources)
+        Results::fail("adaptive: " + std::to_string(seen) + " of " + std::to_string(sources) + " sources counted");
+
+    std::cout << "  " << reducedTagged << " lines with a tag block validated less, " << lostTagBlocks << " without their s: source" << std::endl;
+    if (reducedTagged == 0 || lostTagBlocks != 0)
+        Results::fail("adaptive: " + std::to_string(lostTagBlocks) + " of " + std::to_string(reducedTagged)
+            + " lines with a tag block validated less lost their s: source");
+}
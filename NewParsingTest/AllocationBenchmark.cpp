@@ -0,0 +1,155 @@
+// AllocationBenchmark.cpp : Heap allocations per Nmea::parse by formatter, checked against a budget per formatter
+// for the mean and for the most allocating parse.
+//
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <Nmea/CorpusGenerator.h>
+#include <Nmea/Nmea.h>
+#include <Nmea/StageProfiler.h>
+
+#include "AllocationCounter.h"
+#include "Benchmarks.h"
+#include "Results.h"
+
+namespace
+{
+    const size_t corpusLines = 20000;
+
+    struct Allocations
+    {
+        uint64_t parses = 0;
+        uint64_t allocations = 0;
+        uint64_t bytes = 0;
+        uint64_t maxAllocations = 0;
+    };
+
+    // The allocations per parse measured with this corpus, rounded up, so that a parser allocating more fails the run
+    std::map<std::string, double>& budgets()
+    {
+        static std::map<std::string, double> budgets{
+            { "all", 330 },
+            { "GGA", 310 },
+            { "GSA", 330 },
+            { "GSV", 330 },
+            { "PGRME", 290 },
+            { "RMC", 320 },
+            { "VDM", 310 },
+        };
+        return budgets;
+    }
+
+    // The most allocations of one parse measured with this corpus, rounded up
+    std::map<std::string, double>& maxBudgets()
+    {
+        static std::map<std::string, double> budgets{
+            { "all", 340 },
+            { "GGA", 330 },
+            { "GSA", 330 },
+            { "GSV", 340 },
+            { "PGRME", 290 },
+            { "RMC", 330 },
+            { "VDM", 310 },
+        };
+        return budgets;
+    }
+
+    // A formatter without a budget of its own has the budget of all, nullptr if neither has one
+    const double* budgetOf(const std::map<std::string, double>& budgets, const std::string& formatter)
+    {
+        auto budget = budgets.find(formatter);
+        if (budget == budgets.end())
+            budget = budgets.find("all");
+        return budget != budgets.end() ? &budget->second : nullptr;
+    }
+}
+
+void setAllocationBudget(const std::string& formatter, double allocations)
+{
+    budgets()[formatter] = allocations;
+}
+
+void setMaxAllocationBudget(const std::string& formatter, double allocations)
+{
+    maxBudgets()[formatter] = allocations;
+}
+
+void allocationBenchmark()
+{
+    // Valid lines and a few with errors, which take the exception paths
+    std::vector<std::string> lines(corpusLines);
+    CorpusGenerator generator(45, 0.02);
+    for (auto& line : lines)
+        generator.next(line);
+
+    // Parsed once first, so the capacity of the vectors of the parser has grown to its steady state
+    Nmea nmea;
+    for (const auto& line : lines)
+        nmea.parse(line);
+
+    std::map<std::string, Allocations> byFormatter;
+    for (const auto& line : lines)
+    {
+        const auto before = AllocationCounter::current();
+        nmea.parse(line);
+        const auto after = AllocationCounter::current();
+
+        // The formatter is looked up after the count, as the map allocates
+        const uint64_t allocations = after.allocations - before.allocations;
+        const uint64_t bytes = after.bytes - before.bytes;
+        const auto& fields = nmea.sentenceFields();
+        const std::string formatter(fields.empty() ? std::string_view("(none)") : StageProfiler::formatter(fields[0]));
+
+        for (const auto& key : { std::string("all"), std::string(nmea.errorCode() == ErrorCode::E000 ? "valid" : "error"), formatter })
+        {
+            auto& total = byFormatter[key];
+            ++total.parses;
+            total.allocations += allocations;
+            total.bytes += bytes;
+            total.maxAllocations = std::max(total.maxAllocations, allocations);
+        }
+    }
+
+    std::cout << "  per parse      parses  allocations      bytes  budget    max  budget" << std::endl;
+    for (const auto& [formatter, total] : byFormatter)
+    {
+        const double allocations = static_cast<double>(total.allocations) / total.parses;
+        const double bytes = static_cast<double>(total.bytes) / total.parses;
+
+        const double* budget = budgetOf(budgets(), formatter);
+        const double* maxBudget = budgetOf(maxBudgets(), formatter);
+
+        std::cout << "  " << std::left << std::setw(10) << formatter << std::right << std::setw(10) << total.parses
+            << std::fixed << std::setprecision(1) << std::setw(13) << allocations << std::setw(11) << bytes << std::setw(8);
+        if (budget != nullptr)
+            std::cout << *budget;
+        else
+            std::cout << "";
+        std::cout << std::setw(7) << total.maxAllocations << std::setw(8);
+        if (maxBudget != nullptr)
+            std::cout << *maxBudget;
+        else
+            std::cout << "";
+
+        if (budget != nullptr && allocations > *budget)
+        {
+            std::cout << "  exceeded";
+            Results::fail("allocations/" + formatter + ": " + std::to_string(allocations) + " allocations per parse, budget " + std::to_string(*budget));
+        }
+        if (maxBudget != nullptr && total.maxAllocations > *maxBudget)
+        {
+            std::cout << "  max exceeded";
+            Results::fail("allocations/" + formatter + ": " + std::to_string(total.maxAllocations) + " allocations in a parse, budget " + std::to_string(*maxBudget));
+        }
+        std::cout << std::endl;
+
+        Results::record("allocations/" + formatter, "allocations/parse", allocations);
+        Results::record("allocations/" + formatter + "/bytes", "bytes/parse", bytes);
+        Results::record("allocations/" + formatter + "/max", "allocations", static_cast<double>(total.maxAllocations));
+    }
+}
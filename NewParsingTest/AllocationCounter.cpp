@@ -0,0 +1,95 @@
+#include "AllocationCounter.h"
+
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+    thread_local AllocationCounter::Counts counts;
+
+    void* allocate(std::size_t size)
+    {
+        ++counts.allocations;
+        counts.bytes += size;
+
+        // malloc(0) may return nullptr, while operator new shall return a unique pointer
+        return std::malloc(size == 0 ? 1 : size);
+    }
+
+    void* allocate(std::size_t size, std::align_val_t alignment)
+    {
+        ++counts.allocations;
+        counts.bytes += size;
+
+        const std::size_t align = static_cast<std::size_t>(alignment);
+#if defined(_WIN32)
+        return _aligned_malloc(size == 0 ? 1 : size, align);
+#else
+        // aligned_alloc requires a multiple of the alignment
+        return std::aligned_alloc(align, (size + align - 1) / align * align);
+#endif
+    }
+
+    void deallocate(void* pointer) noexcept
+    {
+        if (pointer == nullptr)
+            return;
+
+        ++counts.deallocations;
+        std::free(pointer);
+    }
+
+    void deallocate(void* pointer, std::align_val_t) noexcept
+    {
+        if (pointer == nullptr)
+            return;
+
+        ++counts.deallocations;
+#if defined(_WIN32)
+        _aligned_free(pointer);
+#else
+        std::free(pointer);
+#endif
+    }
+
+    void* allocateOrThrow(std::size_t size)
+    {
+        if (void* pointer = allocate(size))
+            return pointer;
+        throw std::bad_alloc();
+    }
+
+    void* allocateOrThrow(std::size_t size, std::align_val_t alignment)
+    {
+        if (void* pointer = allocate(size, alignment))
+            return pointer;
+        throw std::bad_alloc();
+    }
+}
+
+AllocationCounter::Counts AllocationCounter::current() noexcept
+{
+    return counts;
+}
+
+void* operator new(std::size_t size) { return allocateOrThrow(size); }
+void* operator new[](std::size_t size) { return allocateOrThrow(size); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { return allocate(size); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return allocate(size); }
+void* operator new(std::size_t size, std::align_val_t alignment) { return allocateOrThrow(size, alignment); }
+void* operator new[](std::size_t size, std::align_val_t alignment) { return allocateOrThrow(size, alignment); }
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return allocate(size, alignment); }
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return allocate(size, alignment); }
+
+void operator delete(void* pointer) noexcept { deallocate(pointer); }
+void operator delete[](void* pointer) noexcept { deallocate(pointer); }
+void operator delete(void* pointer, std::size_t) noexcept { deallocate(pointer); }
+void operator delete[](void* pointer, std::size_t) noexcept { deallocate(pointer); }
+void operator delete(void* pointer, const std::nothrow_t&) noexcept { deallocate(pointer); }
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept { deallocate(pointer); }
+void operator delete(void* pointer, std::align_val_t alignment) noexcept { deallocate(pointer, alignment); }
+void operator delete[](void* pointer, std::align_val_t alignment) noexcept { deallocate(pointer, alignment); }
+void operator delete(void* pointer, std::size_t, std::align_val_t alignment) noexcept { deallocate(pointer, alignment); }
+void operator delete[](void* pointer, std::size_t, std::align_val_t alignment) noexcept { deallocate(pointer, alignment); }
+void operator delete(void* pointer, std::align_val_t alignment, const std::nothrow_t&) noexcept { deallocate(pointer, alignment); }
+void operator delete[](void* pointer, std::align_val_t alignment, const std::nothrow_t&) noexcept { deallocate(pointer, alignment); }
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdint>
+
+/// <summary>
+///        Counts the heap allocations of each thread, by replacing the global operator new and delete of the
+///        program it is linked into.
+/// </summary>
+/// Every form of operator new and delete is replaced, and forwards to malloc and free. The counts are kept per
+/// thread, so the allocations of a call are those between two calls to current() on the calling thread.
+namespace AllocationCounter
+{
+    struct Counts
+    {
+        uint64_t allocations;
+        uint64_t bytes;
+        uint64_t deallocations;
+    };
+
+    /// The allocations of the calling thread so far
+    Counts current() noexcept;
+}
@@ -0,0 +1,136 @@
+﻿#pragma once
+
+#include <string>
+
+/// <summary>
+///        Measures updates and range queries of the SpatialIndex over a moving fleet of AIS targets.
+/// </summary>
+void spatialIndexBenchmark();
+
+/// <summary>
+///        Measures parsing and decoding of AIS traffic received by several receivers, with and without the Deduplicator.
+/// </summary>
+void deduplicatorBenchmark();
+
+/// <summary>
+///        Measures collecting tag block sentence groups with the GroupCorrelator, and checks delivery, expiry and eviction.
+/// </summary>
+void groupCorrelatorBenchmark();
+
+/// <summary>
+///        Measures the IngestionEngine reading loopback UDP, TCP and pseudo terminal sources.
+/// </summary>
+void ingestionBenchmark();
+
+/// <summary>
+///        Compares receiving loopback datagrams with recvfrom one by one and with the UdpReceiver in batches.
+/// </summary>
+void udpReceiverBenchmark();
+
+/// <summary>
+///        Measures throughput and latency of the ParallelParser against the number of workers, and checks the order.
+/// </summary>
+void parallelParserBenchmark();
+
+/// <summary>
+///        Compares reading a gzip compressed log through a decompressed file with streaming it through the GzipReader.
+/// </summary>
+void gzipReaderBenchmark();
+
+/// <summary>
+///        Compares replaying a text log through Nmea::parse with replaying a capture file, and measures seeking by time.
+/// </summary>
+void captureBenchmark();
+
+/// <summary>
+///        Measures the rate and pacing error of the ReplayEngine at several speeds and with several sinks.
+/// </summary>
+void replayBenchmark();
+
+/// <summary>
+///        Measures the latency of quiet sources next to a noisy source with the ShardedParser, and its rebalancing.
+/// </summary>
+void shardedParserBenchmark();
+
+/// <summary>
+///        Measures the Publisher with a fast and several slow subscribers, and checks that no alarm is shed.
+/// </summary>
+void publisherBenchmark();
+
+/// <summary>
+///        Compares a coroutine per source awaiting a SentenceStream with a callback, on the IngestionEngine.
+/// </summary>
+void sentenceStreamBenchmark();
+
+/// <summary>
+///        Measures each stage of Nmea::parse per formatter, for valid and for corrupt input, and records the results.
+/// </summary>
+void stageBenchmark();
+
+/// <summary>
+///        Measures the CorpusGenerator in memory and to a file, parses its output at several error rates, and shows
+///        the code the parser reports for each kind of injected error.
+/// </summary>
+void corpusBenchmark();
+
+/// <summary>
+///        Frames, parses and publishes lines of many sources while snapshots are taken, and shows the latency
+///        histograms of each stage when built with NMEA_PROFILING=1.
+/// </summary>
+void profilerBenchmark();
+
+/// <summary>
+///        Measures the cost of ParseCounters per line, and scrapes the MetricsExporter on Linux.
+/// </summary>
+void metricsBenchmark();
+
+/// <summary>
+///        Counts cycles, instructions, branch misses and L1D and LLC misses per sentence of each parse stage and
+///        formatter with perf_event_open, or measures the time only where the counters are not permitted.
+/// </summary>
+void perfCounterBenchmark();
+
+/// <summary>
+///        Counts the heap allocations per Nmea::parse by formatter, and fails the run when a budget is exceeded.
+/// </summary>
+void allocationBenchmark();
+
+/// <summary>
+///        Sets the allocations per parse allowed for a formatter, e.g. "GGA", or for any formatter with "all".
+/// </summary>
+/// Replaces the budget the benchmark has for the formatter by default.
+void setAllocationBudget(const std::string& formatter, double allocations);
+
+/// <summary>
+///        Sets the allocations allowed in any one parse of a formatter, e.g. "GGA", or of any formatter with "all".
+/// </summary>
+/// Replaces the budget the benchmark has for the formatter by default.
+void setMaxAllocationBudget(const std::string& formatter, double allocations);
+
+/// <summary>
+///        Records the spans of synthetic lines read, framed, parsed by sharded parsers, decoded and dispatched, writes
+///        them as a Chrome trace, and measures the cost of recording.
+/// </summary>
+void traceBenchmark();
+
+/// <summary>
+///        Sets where traceBenchmark writes its trace.
+/// </summary>
+void setTraceFile(const std::string& path);
+
+/// <summary>
+///        Measures the parse rate of a synthetic corpus at each validation level.
+/// </summary>
+void validationBenchmark();
+
+/// <summary>
+///        Measures parsing the subscribed sentences of a mixed feed, with and without a SentenceFilter dropping the
+///        others first.
+/// </summary>
+void prefilterBenchmark();
+
+/// <summary>
+///        Measures adaptive validation of clean and noisy sources against validating every line fully, and prints the
+///        mode and CPU time saved per source.
+/// </summary>
+void adaptiveValidationBenchmark();
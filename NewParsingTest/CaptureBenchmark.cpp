@@ -0,0 +1,164 @@
+// CaptureBenchmark.cpp : Replaying a text log with Nmea::parse, and the same lines from a capture file.
+//
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <Nmea/Capture.h>
+#include <Nmea/Messages.h>
+#include <Nmea/Nmea.h>
+
+#include "Benchmarks.h"
+#include "Results.h"
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    const size_t lines = 200000;
+    const int64_t interval = 1000000;   // One line per millisecond
+    const int64_t firstTime = 1700000000LL * 1000000000;
+    const char* const sources[]{ "capture0", "capture1", "capture2", "capture3" };
+
+    double seconds(Clock::time_point start)
+    {
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    // The FNV-1a hash of a field and its position, to compare the fields of a record with those of the parser
+    uint64_t fieldsHash(uint64_t hash, size_t i, std::string_view field)
+    {
+        hash = (hash ^ i) * 0x100000001B3;
+        for (const char c : field)
+            hash = (hash ^ static_cast<unsigned char>(c)) * 0x100000001B3;
+        return hash;
+    }
+}
+
+void captureBenchmark()
+{
+    const auto& messages = GetMessages();
+    std::vector<std::string> input;
+    for (size_t i = 0; i < lines; ++i)
+        input.emplace_back(messages[i % messages.size()]);
+
+    const char* directory = std::getenv("TMPDIR");
+    const std::string path = std::string(directory != nullptr ? directory : "/tmp") + "/capturebenchmark.cap";
+
+    // The writer and the reader intern the sources in tables of their own, as two processes would
+    SourceInterner writerSources;
+    SourceInterner readerSources;
+    writerSources.intern("writer only");
+    std::vector<SourceId> sourceIds;
+    for (const auto name : sources)
+        sourceIds.push_back(writerSources.intern(name));
+
+    Nmea nmea(writerSources);
+    std::vector<std::string_view> written;   // The source name of each record
+    std::vector<uint64_t> writtenFields;     // The fieldsHash of each record
+    size_t textBytes = 0;
+    size_t fields = 0;
+
+    auto start = Clock::now();
+    {
+        Capture::Writer writer(path);
+        for (size_t i = 0; i < input.size(); ++i)
+        {
+            nmea.parse(input[i], LineOrigin{ sourceIds[i % sourceIds.size()], firstTime + static_cast<int64_t>(i) * interval });
+            if (writer.write(input[i], nmea))
+            {
+                written.push_back(writerSources.name(nmea.origin().source));
+                uint64_t hash = 0xCBF29CE484222325;
+                for (size_t field = 0; field < nmea.sentenceFields().size(); ++field)
+                    hash = fieldsHash(hash, field, nmea.sentenceFields()[field]);
+                writtenFields.push_back(hash);
+            }
+            textBytes += input[i].size();
+        }
+        writer.close();
+    }
+    const double writing = seconds(start);
+
+    // Today: every replay validates and splits again
+    start = Clock::now();
+    for (const auto& line : input)
+    {
+        nmea.parse(line);
+        fields += nmea.sentenceFields().size();
+    }
+    const double parsing = seconds(start);
+
+    Capture::Reader reader(path, readerSources);
+
+    start = Clock::now();
+    size_t records = 0;
+    size_t capturedFields = 0;
+    size_t length = 0;
+    size_t misnamed = 0;
+    Capture::Record record;
+    for (auto cursor = reader.begin(); reader.next(cursor, record);)
+    {
+        if (records >= written.size() || readerSources.name(record.source) != written[records])
+            ++misnamed;
+        ++records;
+        capturedFields += record.fieldCount;
+        for (size_t i = 0; i < record.fieldCount; ++i)
+            length += record.field(i).size();
+    }
+    const double replaying = seconds(start);
+
+    // The fields of each record are those the parser split the line into
+    size_t changed = 0;
+    records = 0;
+    for (auto cursor = reader.begin(); reader.next(cursor, record); ++records)
+    {
+        uint64_t hash = 0xCBF29CE484222325;
+        for (size_t i = 0; i < record.fieldCount; ++i)
+            hash = fieldsHash(hash, i, record.field(i));
+        if (records >= writtenFields.size() || hash != writtenFields[records])
+            ++changed;
+    }
+
+    // Seek to random times, and check that the record found is the first one at or after the time
+    std::mt19937_64 random(42);
+    std::uniform_int_distribution<int64_t> times(firstTime, firstTime + static_cast<int64_t>(lines) * interval);
+    const size_t seeks = 10000;
+    size_t wrong = 0;
+
+    start = Clock::now();
+    for (size_t i = 0; i < seeks; ++i)
+    {
+        const int64_t time = times(random);
+        auto cursor = reader.seek(time);
+        const int64_t expected = firstTime + (time - firstTime + interval - 1) / interval * interval;
+        if (reader.next(cursor, record) ? record.receiveTime != expected : expected < firstTime + static_cast<int64_t>(lines) * interval)
+            ++wrong;
+    }
+    const double seeking = seconds(start);
+
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    std::fseek(file, 0, SEEK_END);
+    const long captureBytes = std::ftell(file);
+    std::fclose(file);
+    std::remove(path.c_str());
+
+    std::cout << std::fixed << std::setprecision(0)
+        << "write capture:   " << std::setw(9) << lines / writing << " lines/s (including parse)" << std::endl
+        << "parse text:      " << std::setw(9) << lines / parsing << " lines/s, " << fields << " fields" << std::endl
+        << "replay capture:  " << std::setw(9) << records / replaying << " lines/s, " << capturedFields << " fields, "
+        << length << " field characters" << std::endl
+        << "seek by time:    " << std::setw(9) << std::setprecision(2) << seeking / seeks * 1e6 << " us per seek, "
+        << wrong << " wrong, " << reader.chunks() << " chunks" << std::endl
+        << "size:            " << std::setw(9) << textBytes << " bytes of text, " << captureBytes << " bytes of capture" << std::endl;
+
+    if (records != written.size() || misnamed != 0 || changed != 0)
+        Results::fail("capture: " + std::to_string(records) + " of " + std::to_string(written.size()) + " records read, "
+            + std::to_string(misnamed) + " with the wrong source, " + std::to_string(changed) + " with other fields");
+}
@@ -0,0 +1,145 @@
+// CorpusBenchmark.cpp : Generating a synthetic corpus in memory and to a file, and parsing it at several error rates.
+//
+
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <Nmea/CorpusGenerator.h>
+#include <Nmea/LineFramer.h>
+#include <Nmea/Nmea.h>
+
+#include "Benchmarks.h"
+#include "Results.h"
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    const uint64_t seed = 20240611;
+    const size_t memoryBytes = 64 << 20;
+    const uint64_t fileBytes = 256 << 20;
+    const size_t parsedLines = 200000;
+    const size_t errorLines = 33 * 1000;
+
+    std::string codeName(size_t code)
+    {
+        char name[8];
+        std::snprintf(name, sizeof(name), "E%03zu", code);
+        return name;
+    }
+
+    double secondsSince(Clock::time_point start)
+    {
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    void generateInMemory()
+    {
+        CorpusGenerator generator(seed, 0.01);
+        std::string buffer;
+        buffer.reserve(memoryBytes + 1024);
+
+        const auto start = Clock::now();
+        const size_t lines = generator.fill(buffer, memoryBytes);
+        const double seconds = secondsSince(start);
+
+        std::cout << std::fixed << std::setprecision(0) << "generate in memory: " << std::setw(6) << buffer.size() / seconds / 1e6
+            << " MB/s " << std::setw(9) << lines / seconds << " lines/s" << std::endl;
+        Results::record("corpus/generate/memory", "MB/s", buffer.size() / seconds / 1e6);
+        Results::record("corpus/generate/memory/rate", "lines/s", lines / seconds);
+    }
+
+    void generateToFile()
+    {
+        const std::string path = "corpus_benchmark.nmea";
+        CorpusGenerator generator(seed, 0.01);
+
+        const auto start = Clock::now();
+        const uint64_t lines = generator.write(path, fileBytes);
+        const double seconds = secondsSince(start);
+        std::remove(path.c_str());
+
+        std::cout << "generate to file:   " << std::setw(6) << fileBytes / seconds / 1e6
+            << " MB/s " << std::setw(9) << lines / seconds << " lines/s" << std::endl;
+        Results::record("corpus/generate/file", "MB/s", fileBytes / seconds / 1e6);
+        Results::record("corpus/generate/file/rate", "lines/s", lines / seconds);
+    }
+
+    // Streams the generated lines through the framer into the parser, without a file in between
+    void parse(double errorRate)
+    {
+        CorpusGenerator generator(seed, errorRate);
+        LineFramer framer;
+        Nmea nmea;
+        std::string buffer;
+        uint64_t lines = 0;
+        uint64_t valid = 0;
+        double generating = 0;
+
+        const auto start = Clock::now();
+        while (lines < parsedLines)
+        {
+            const auto generated = Clock::now();
+            buffer.clear();
+            generator.fill(buffer, 64 << 10);
+            generating += secondsSince(generated);
+
+            LineFramer::split(buffer, [&](std::string_view line) {
+                nmea.parse(line);
+                ++lines;
+                if (nmea.errorCode() == ErrorCode::E000)
+                    ++valid;
+            });
+        }
+        const double seconds = secondsSince(start) - generating;
+
+        const std::string name = "corpus/parse/errors" + std::to_string(static_cast<int>(errorRate * 100)) + "%";
+        std::cout << "parse, " << std::setw(3) << static_cast<int>(errorRate * 100) << "% errors: " << std::setw(9) << lines / seconds
+            << " lines/s, " << valid << " of " << lines << " valid" << std::endl;
+        Results::record(name, "lines/s", lines / seconds);
+    }
+
+    // The code the parser reports for each kind of injected error
+    void detection()
+    {
+        const size_t codes = static_cast<size_t>(ErrorCode::E033) + 1;
+        std::vector<std::vector<uint64_t>> reported(codes, std::vector<uint64_t>(codes, 0));
+
+        CorpusGenerator generator(seed, 1.0);
+        Nmea nmea;
+        std::string line;
+        for (size_t i = 0; i < errorLines; ++i)
+        {
+            const ErrorCode injected = generator.next(line);
+            nmea.parse(line);
+            ++reported[static_cast<size_t>(injected)][static_cast<size_t>(nmea.errorCode())];
+        }
+
+        std::cout << "  code         lines  detected  reported instead" << std::endl;
+        for (size_t code = 1; code < codes; ++code)
+        {
+            const uint64_t lines = generator.injected()[code];
+            std::cout << "  " << codeName(code) << std::setw(13) << lines << std::setw(10) << reported[code][code] << "  ";
+            for (size_t other = 0; other < codes; ++other)
+                if (other != code && reported[code][other] != 0)
+                    std::cout << ' ' << codeName(other) << " x" << reported[code][other];
+            std::cout << std::endl;
+
+            Results::record("corpus/detected/" + codeName(code), "fraction",
+                lines == 0 ? 0 : static_cast<double>(reported[code][code]) / lines);
+        }
+    }
+}
+
+void corpusBenchmark()
+{
+    generateInMemory();
+    generateToFile();
+    for (double errorRate : { 0.0, 0.01, 0.1, 0.5 })
+        parse(errorRate);
+    detection();
+}
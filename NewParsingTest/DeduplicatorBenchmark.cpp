@@ -0,0 +1,176 @@
+// DeduplicatorBenchmark.cpp : The same AIS traffic received by several base stations.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <Nmea/AisPosition.h>
+#include <Nmea/Deduplicator.h>
+#include <Nmea/Nmea.h>
+
+#include "Benchmarks.h"
+#include "Results.h"
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    // Appends the bits of value to a string of '0' and '1'
+    void append(std::string& bits, int64_t value, size_t length)
+    {
+        for (size_t i = length; i > 0; --i)
+            bits += ((value >> (i - 1)) & 1) ? '1' : '0';
+    }
+
+    // Encodes an AIS message 1 in the six-bit binary representation
+    std::string positionReport(uint32_t mmsi, double latitude, double longitude)
+    {
+        std::string bits;
+        append(bits, 1, 6);                                            // Message id
+        append(bits, 0, 2);                                            // Repeat indicator
+        append(bits, mmsi, 30);
+        append(bits, 0, 4);                                            // Navigational status
+        append(bits, -128, 8);                                         // Rate of turn not available
+        append(bits, 123, 10);                                         // Speed over ground
+        append(bits, 0, 1);                                            // Position accuracy
+        append(bits, static_cast<int64_t>(longitude * 600000.0), 28);
+        append(bits, static_cast<int64_t>(latitude * 600000.0), 27);
+        append(bits, 2345, 12);                                        // Course over ground
+        append(bits, 511, 9);                                          // True heading not available
+        append(bits, 0, 31);                                           // Time stamp, flags and radio status
+
+        std::string payload;
+        for (size_t i = 0; i < bits.size(); i += 6)
+        {
+            const int value = std::stoi(bits.substr(i, 6), nullptr, 2);
+            payload += static_cast<char>(value < 40 ? value + 48 : value + 56);
+        }
+
+        return payload;
+    }
+
+    // Returns the checksum field "*hh" for the characters between the start character and the checksum
+    std::string checksum(const std::string& s)
+    {
+        unsigned char sum = 0;
+        for (size_t i = 1; i < s.size(); ++i)
+            sum ^= static_cast<unsigned char>(s[i]);
+
+        char buffer[4];
+        std::snprintf(buffer, sizeof(buffer), "%02X", sum);
+        return std::string("*") + buffer;
+    }
+
+    // A sentence as received by a base station, with its source and time in a tag block
+    std::string received(size_t receiver, int64_t time, const std::string& sentence)
+    {
+        const std::string tagBlock = "\\s:r" + std::to_string(3669961 + receiver) + ",c:" + std::to_string(time);
+        return tagBlock + checksum(tagBlock) + "\\" + sentence + checksum(sentence) + "\r\n";
+    }
+
+    // The fragments of a message are passed on or dropped together, and a message is told apart by all its fragments
+    void checkMessages()
+    {
+        using Verdict = Deduplicator::Verdict;
+
+        const int64_t time = 1120959341;
+        const std::string first = "!ABVDM,2,1,3,A,55?MbV02;H;s<HtKR20EHE:0@T4@Dn2222222216L961O5Gf0NSQEp6ClRp8,0";
+        const std::string other = "!ABVDM,2,1,4,A,55?MbV02;H;s<HtKR20EHE:0@T4@Dn2222222216L961O5Gf0NSQEp6ClRp9,0";
+        const std::string tail = "88888888880,2";   // A common ending of static and voyage related data
+
+        Nmea nmea;
+        Deduplicator deduplicator;
+        auto accept = [&](const std::string& line) {
+            nmea.parse(line);
+            if (nmea.errorCode() != ErrorCode::E000)
+                Results::fail("dedup: " + std::string(nmea.indication()) + " in " + line);
+            return deduplicator.accept(line, nmea.sentenceFields(), nmea.tagBlock().sourceId, nmea.tagBlock().time);
+        };
+
+        // Two receivers, with their fragments interleaved
+        const std::string a1 = received(0, time, first);
+        const std::string a2 = received(0, time, "!ABVDM,2,2,3,A," + tail);
+        const bool held = accept(a1) == Verdict::hold && accept(received(1, time, first)) == Verdict::hold;
+        const bool passed = accept(a2) == Verdict::pass && deduplicator.held() == std::vector<std::string>{ a1 };
+        const bool dropped = accept(received(1, time, "!ABVDM,2,2,3,A," + tail)) == Verdict::drop;
+        if (!held || !passed || !dropped)
+            Results::fail("dedup: the fragments of a message received twice were not passed on once, together");
+
+        // Another message with the same last fragment
+        if (accept(received(0, time, other)) != Verdict::hold || accept(received(0, time, "!ABVDM,2,2,4,A," + tail)) != Verdict::pass)
+            Results::fail("dedup: a message was dropped as a duplicate of another message ending alike");
+
+        if (deduplicator.accepted() != 4 || deduplicator.dropped() != 2 || deduplicator.incomplete() != 0)
+            Results::fail("dedup: " + std::to_string(deduplicator.accepted()) + " accepted, " + std::to_string(deduplicator.dropped())
+                + " dropped and " + std::to_string(deduplicator.incomplete()) + " incomplete instead of 4, 2 and 0");
+    }
+
+    // Each message is received by all the receivers, in a random order
+    std::vector<std::string> makeTraffic(size_t messages, size_t receivers, std::mt19937& random)
+    {
+        std::uniform_real_distribution<double> latitude(50.0, 62.0);
+        std::uniform_real_distribution<double> longitude(-5.0, 12.0);
+
+        std::vector<std::string> lines;
+        for (size_t i = 0; i < messages; ++i)
+        {
+            const int64_t time = 1120959341 + static_cast<int64_t>(i / 100);
+            const std::string sentence = "!ABVDM,1,1,,A," + positionReport(257000000 + i % 5000, latitude(random), longitude(random)) + ",0";
+
+            std::vector<std::string> copies;
+            for (size_t r = 0; r < receivers; ++r)
+                copies.push_back(received(r, time, sentence));
+
+            std::shuffle(copies.begin(), copies.end(), random);
+            lines.insert(lines.end(), copies.begin(), copies.end());
+        }
+
+        return lines;
+    }
+}
+
+void deduplicatorBenchmark()
+{
+    checkMessages();
+
+    std::mt19937 random(4711);
+
+    for (size_t receivers : { 1, 2, 4 })
+    {
+        const auto lines = makeTraffic(20000, receivers, random);
+
+        for (bool deduplicate : { false, true })
+        {
+            Nmea nmea;
+            Deduplicator deduplicator;
+            size_t decoded = 0;
+
+            const auto start = Clock::now();
+            for (const auto& line : lines)
+            {
+                nmea.parse(line);
+                if (nmea.errorCode() != ErrorCode::E000)
+                    continue;
+
+                if (deduplicate && deduplicator.accept(line, nmea.sentenceFields(), nmea.tagBlock().sourceId, nmea.tagBlock().time) != Deduplicator::Verdict::pass)
+                    continue;
+
+                if (Ais::decodePositionReport(nmea.sentenceFields()))
+                    ++decoded;
+            }
+            const auto elapsed = Clock::now() - start;
+
+            std::cout << std::fixed << std::setprecision(1)
+                << receivers << " receiver(s), " << (deduplicate ? "deduplicated: " : "all:          ")
+                << std::setw(7) << std::chrono::duration<double, std::nano>(elapsed).count() / lines.size() << " ns/line, "
+                << std::setw(6) << decoded << " decoded, "
+                << std::setw(6) << deduplicator.dropped() << " dropped" << std::endl;
+        }
+    }
+}
@@ -0,0 +1,149 @@
+// GroupCorrelatorBenchmark.cpp : Collecting the tag block sentence groups of Messages.h, and checking what is
+// delivered, expired and evicted.
+//
+
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <Nmea/GroupCorrelator.h>
+#include <Nmea/Messages.h>
+#include <Nmea/Nmea.h>
+
+#include "Benchmarks.h"
+#include "Results.h"
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    const size_t repeats = 2000;
+
+    // The lines of Messages.h in a sentence group, g:1-2-1234 .. g:3-3-2347
+    std::vector<std::string_view> groupLines()
+    {
+        std::vector<std::string_view> lines;
+        for (const auto line : GetMessages())
+            if (line.substr(0, 3) == "\\g:")
+                lines.push_back(line);
+        return lines;
+    }
+
+    // The first line of a group of two with a group id of its own
+    std::string firstOfTwo(uint32_t groupId)
+    {
+        const std::string parameters = "g:1-2-" + std::to_string(groupId) + ",s:r3669961";
+        unsigned char sum = 0;
+        for (const char c : parameters)
+            sum ^= static_cast<unsigned char>(c);
+
+        char checksum[4];
+        std::snprintf(checksum, sizeof(checksum), "*%02X", sum);
+        return "\\" + parameters + checksum + "\\\r\n";
+    }
+
+    // The sentence number and group id a member shall have, checked on the characters of its tag block
+    bool isMember(std::string_view line, uint32_t number, const GroupCorrelator::SentenceGroup& group)
+    {
+        const std::string grouping = "\\g:" + std::to_string(number) + "-" + std::to_string(group.size) + "-" + std::to_string(group.groupId);
+        return line.substr(0, grouping.size()) == grouping && (line.size() == grouping.size() || line[grouping.size()] == ',' || line[grouping.size()] == '*');
+    }
+
+    void checkDelivery(const std::vector<std::string_view>& lines)
+    {
+        Nmea nmea;
+        GroupCorrelator correlator;
+        size_t delivered = 0;
+        size_t misordered = 0;
+        correlator.subscribe([&](const GroupCorrelator::SentenceGroup& group) {
+            ++delivered;
+            for (uint32_t i = 0; i < group.size; ++i)
+                if (!isMember(group.members[i], i + 1, group))
+                    ++misordered;
+        });
+
+        // The groups in the order of Messages.h, then the last group of three again with its lines reversed
+        size_t groups = 0;
+        for (const auto line : lines)
+        {
+            nmea.parse(line);
+            if (correlator.add(line, nmea, 0) && line.substr(3, 2) == "1-")
+                ++groups;
+        }
+        for (size_t i = lines.size(); i > lines.size() - 3; --i)
+        {
+            nmea.parse(lines[i - 1]);
+            correlator.add(lines[i - 1], nmea, 0);
+        }
+        ++groups;
+
+        if (groups != 10 + 1 || delivered != groups || misordered != 0 || correlator.expired() != 0)
+            Results::fail("groups: " + std::to_string(delivered) + " of " + std::to_string(groups) + " groups delivered, "
+                + std::to_string(misordered) + " members out of order, " + std::to_string(correlator.expired()) + " expired");
+    }
+
+    void checkExpiry(const std::vector<std::string_view>& lines)
+    {
+        Nmea nmea;
+        const int64_t timeout = 2;
+
+        // The first line of g:1-3-1234 alone never completes
+        GroupCorrelator timedOut(64, timeout);
+        nmea.parse(lines[10]);
+        timedOut.add(lines[10], nmea, 100);
+        timedOut.expire(100 + timeout);
+        const bool kept = timedOut.expired() == 0;
+        timedOut.expire(100 + timeout + 1);
+        if (!kept || timedOut.expired() != 1 || timedOut.completed() != 0)
+            Results::fail("groups: an incomplete group was not expired after its timeout");
+
+        // A table of 8 holds 8 incomplete groups, the ninth evicts the oldest
+        GroupCorrelator full(8, timeout);
+        for (uint32_t groupId = 1; groupId <= 9; ++groupId)
+        {
+            const std::string line = firstOfTwo(groupId);
+            nmea.parse(line);
+            full.add(line, nmea, groupId / 10);
+        }
+        if (full.expired() != 1)
+            Results::fail("groups: " + std::to_string(full.expired()) + " groups evicted from a full table instead of 1");
+    }
+}
+
+void groupCorrelatorBenchmark()
+{
+    const auto lines = groupLines();
+    if (lines.size() != 25 || lines[10].substr(0, 11) != "\\g:1-3-1234")
+    {
+        Results::fail("groups: the sentence groups of Messages.h have changed");
+        return;
+    }
+
+    checkDelivery(lines);
+    checkExpiry(lines);
+
+    Nmea nmea;
+    GroupCorrelator correlator;
+    uint64_t members = 0;
+    correlator.subscribe([&](const GroupCorrelator::SentenceGroup& group) { members += group.size; });
+
+    const auto start = Clock::now();
+    for (size_t repeat = 0; repeat < repeats; ++repeat)
+    {
+        for (const auto line : lines)
+        {
+            nmea.parse(line);
+            correlator.add(line, nmea, static_cast<int64_t>(repeat));
+        }
+    }
+    const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    const double rate = repeats * lines.size() / seconds;
+    std::cout << std::fixed << std::setprecision(0) << rate << " lines/s parsed and correlated, "
+        << correlator.completed() << " groups of " << members << " lines delivered, " << correlator.expired() << " expired" << std::endl;
+    Results::record("groups/rate", "lines/s", rate);
+}
@@ -0,0 +1,150 @@
+// GzipReaderBenchmark.cpp : A gzip compressed log read by decompressing to disk first, and by the GzipReader.
+//
+
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <Nmea/GzipReader.h>
+#include <Nmea/LineFramer.h>
+#include <Nmea/Messages.h>
+#include <Nmea/Nmea.h>
+
+#include "Benchmarks.h"
+
+#if __has_include(<zlib.h>)
+
+#include <zlib.h>
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    const size_t lines = 200000;
+
+    std::string temporary(const char* name)
+    {
+        const char* directory = std::getenv("TMPDIR");
+        return std::string(directory != nullptr ? directory : "/tmp") + "/" + name;
+    }
+
+    void writeArchive(const std::string& path)
+    {
+        const auto& messages = GetMessages();
+
+        gzFile file = ::gzopen(path.c_str(), "wb");
+        for (size_t i = 0; i < lines; ++i)
+        {
+            const auto& message = messages[i % messages.size()];
+            ::gzwrite(file, message.data(), static_cast<unsigned>(message.size()));
+        }
+        ::gzclose(file);
+    }
+
+    double seconds(Clock::time_point start)
+    {
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    void report(const char* name, double elapsed, uint64_t bytes, size_t count)
+    {
+        std::cout << std::fixed << std::setprecision(1)
+            << name << std::setw(7) << bytes / elapsed / 1e6 << " MB/s, "
+            << std::setprecision(0) << std::setw(8) << count / elapsed << " lines/s, "
+            << count << " lines" << std::endl;
+    }
+
+    // The decompression limit: inflate only
+    void decompressOnly(const std::string& archive)
+    {
+        const auto start = Clock::now();
+
+        GzipReader reader(archive);
+        std::string_view block;
+        uint64_t bytes = 0;
+        while (reader.next(block))
+            bytes += block.size();
+
+        report("decompress only:       ", seconds(start), bytes, lines);
+    }
+
+    // Today: decompress to disk, then read and parse the file
+    void decompressToDisk(const std::string& archive, bool parse)
+    {
+        const std::string path = temporary("gzipbenchmark.txt");
+        const auto start = Clock::now();
+
+        gzFile in = ::gzopen(archive.c_str(), "rb");
+        FILE* out = std::fopen(path.c_str(), "wb");
+        std::vector<char> buffer(1 << 20);
+        for (int count; (count = ::gzread(in, buffer.data(), static_cast<unsigned>(buffer.size()))) > 0;)
+            std::fwrite(buffer.data(), 1, static_cast<size_t>(count), out);
+        ::gzclose(in);
+        std::fclose(out);
+
+        Nmea nmea;
+        LineFramer framer;
+        size_t count = 0;
+        uint64_t bytes = 0;
+        auto handler = [&](std::string_view line) {
+            if (parse)
+                nmea.parse(line);
+            ++count;
+        };
+
+        FILE* file = std::fopen(path.c_str(), "rb");
+        for (size_t read; (read = std::fread(framer.writePosition(), 1, framer.writeSpace(), file)) > 0;)
+        {
+            bytes += read;
+            framer.commit(read);
+            framer.drain(handler);
+        }
+        std::fclose(file);
+        std::remove(path.c_str());
+
+        report(parse ? "to disk, frame + parse: " : "to disk, frame:         ", seconds(start), bytes, count);
+    }
+
+    void streaming(const std::string& archive, bool parse)
+    {
+        const auto start = Clock::now();
+
+        Nmea nmea;
+        size_t count = 0;
+        GzipReader reader(archive);
+        reader.forEachLine([&](std::string_view line) {
+            if (parse)
+                nmea.parse(line);
+            ++count;
+        });
+
+        report(parse ? "streamed, frame + parse:" : "streamed, frame:        ", seconds(start), reader.decompressedBytes(), count);
+    }
+}
+
+void gzipReaderBenchmark()
+{
+    const std::string archive = temporary("gzipbenchmark.nmea.gz");
+    writeArchive(archive);
+
+    decompressOnly(archive);
+    for (bool parse : { false, true })
+    {
+        decompressToDisk(archive, parse);
+        streaming(archive, parse);
+    }
+
+    std::remove(archive.c_str());
+}
+
+#else
+
+void gzipReaderBenchmark()
+{
+    std::cout << "The GzipReader needs zlib" << std::endl;
+}
+
+#endif
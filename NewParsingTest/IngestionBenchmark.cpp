@@ -0,0 +1,227 @@
+// IngestionBenchmark.cpp : Lines from loopback UDP, TCP, pseudo terminal and file sources through the IngestionEngine.
+//
+
+#include <iostream>
+
+#include "Benchmarks.h"
+#include "Results.h"
+
+#if defined(__linux__)
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <Nmea/IngestionEngine.h>
+#include <Nmea/Messages.h>
+#include <Nmea/Nmea.h>
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    const size_t udpSources = 8;
+    const size_t tcpSources = 8;
+    const size_t ptySources = 4;
+    const size_t fileSources = 4;
+    const size_t linesPerSource = 5000;
+
+    // The lines of the corpus, one after the other
+    std::string corpus(size_t lines)
+    {
+        const auto& messages = GetMessages();
+
+        std::string text;
+        for (size_t i = 0; i < lines; ++i)
+            text += messages[i % messages.size()];
+
+        return text;
+    }
+
+    int listenTcp(uint16_t& port)
+    {
+        const int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+
+        sockaddr_in local{};
+        local.sin_family = AF_INET;
+        local.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        ::bind(fd, reinterpret_cast<sockaddr*>(&local), sizeof(local));
+        ::listen(fd, 1);
+
+        socklen_t length = sizeof(local);
+        ::getsockname(fd, reinterpret_cast<sockaddr*>(&local), &length);
+        port = ntohs(local.sin_port);
+
+        return fd;
+    }
+
+    void writeAll(int fd, const std::string& text)
+    {
+        for (size_t written = 0; written < text.size();)
+        {
+            const ssize_t count = ::write(fd, text.data() + written, text.size() - written);
+            if (count <= 0)
+                return;
+            written += static_cast<size_t>(count);
+        }
+    }
+
+    void sendDatagrams(uint16_t port, size_t lines)
+    {
+        const int fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+
+        sockaddr_in remote{};
+        remote.sin_family = AF_INET;
+        remote.sin_port = htons(port);
+        remote.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        const auto& messages = GetMessages();
+        for (size_t i = 0; i < lines; ++i)
+        {
+            const auto& message = messages[i % messages.size()];
+            ::sendto(fd, message.data(), message.size(), 0, reinterpret_cast<sockaddr*>(&remote), sizeof(remote));
+
+            // Give the receiver a chance, one datagram per line is what overflows socket buffers in practice
+            if (i % 64 == 63)
+                std::this_thread::yield();
+        }
+
+        ::close(fd);
+    }
+
+    void run(IngestionEngine::Backend backend, size_t loops, bool parse)
+    {
+        std::atomic<uint64_t> received{ 0 };
+        std::atomic<uint64_t> datagrams{ 0 };
+        std::atomic<uint64_t> valid{ 0 };
+
+        // Datagrams may be lost, the lines of the other sources may not
+        std::vector<bool> udp(size_t(1) << 16);
+
+        IngestionEngine engine([&](const LineOrigin& origin, std::string_view line) {
+            if (parse)
+            {
+                // One parser per event loop thread
+                thread_local Nmea nmea;
+                nmea.parse(line, origin);
+                if (nmea.errorCode() == ErrorCode::E000)
+                    valid.fetch_add(1, std::memory_order_relaxed);
+            }
+            received.fetch_add(1, std::memory_order_relaxed);
+            if (udp[origin.source])
+                datagrams.fetch_add(1, std::memory_order_relaxed);
+        }, loops, SourceInterner::global(), backend);
+
+        std::vector<std::thread> senders;
+        std::vector<int> descriptors;
+        const std::string text = corpus(linesPerSource);
+
+        const uint16_t firstUdpPort = 29000;
+        for (size_t i = 0; i < udpSources; ++i)
+            udp[engine.addUdpSource("udp" + std::to_string(i), static_cast<uint16_t>(firstUdpPort + i), "127.0.0.1")] = true;
+
+        for (size_t i = 0; i < tcpSources; ++i)
+        {
+            uint16_t port = 0;
+            const int listener = listenTcp(port);
+            engine.addTcpSource("tcp" + std::to_string(i), "127.0.0.1", port);
+            descriptors.push_back(::accept(listener, nullptr, nullptr));
+            ::close(listener);
+        }
+
+        std::vector<int> ptys;
+        for (size_t i = 0; i < ptySources; ++i)
+        {
+            const int master = ::posix_openpt(O_RDWR | O_NOCTTY);
+            ::grantpt(master);
+            ::unlockpt(master);
+            engine.addSerialSource("pty" + std::to_string(i), ::ptsname(master), 38400);
+            ptys.push_back(master);
+        }
+
+        // The archives are read as soon as the engine starts
+        char path[] = "/tmp/ingestionXXXXXX";
+        const int archive = ::mkstemp(path);
+        writeAll(archive, text);
+        ::close(archive);
+        for (size_t i = 0; i < fileSources; ++i)
+            engine.addFile("file" + std::to_string(i), path);
+
+        engine.start();
+        const auto start = Clock::now();
+
+        for (size_t i = 0; i < udpSources; ++i)
+            senders.emplace_back(sendDatagrams, static_cast<uint16_t>(firstUdpPort + i), linesPerSource);
+        for (int fd : descriptors)
+            senders.emplace_back([fd, &text] { writeAll(fd, text); ::close(fd); });
+        for (int fd : ptys)
+            senders.emplace_back([fd, &text] { writeAll(fd, text); });
+
+        for (auto& sender : senders)
+            sender.join();
+
+        // Wait until everything sent has arrived, or the datagrams lost are given up
+        const uint64_t sent = (udpSources + tcpSources + ptySources + fileSources) * linesPerSource;
+        uint64_t previous = 0;
+        auto lastProgress = Clock::now();
+        while (received < sent && Clock::now() - lastProgress < std::chrono::milliseconds(200))
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            if (received != previous)
+            {
+                previous = received;
+                lastProgress = Clock::now();
+            }
+        }
+        const auto elapsed = (received < sent ? lastProgress : Clock::now()) - start;
+
+        engine.stop();
+        for (int fd : ptys)
+            ::close(fd);
+        ::unlink(path);
+
+        const double seconds = std::chrono::duration<double>(elapsed).count();
+        std::cout << std::fixed << std::setprecision(0)
+            << (engine.backend() == IngestionEngine::Backend::uring ? "io_uring, " : "epoll,    ") << loops << " loop(s), " << (parse ? "parse:  " : "frame:  ")
+            << std::setw(9) << received / seconds << " lines/s, "
+            << received << " of " << sent << " lines received";
+        if (parse)
+            std::cout << ", " << valid << " valid";
+        std::cout << std::endl;
+
+        const uint64_t streamed = (tcpSources + ptySources + fileSources) * linesPerSource;
+        if (received - datagrams != streamed || datagrams > udpSources * linesPerSource || datagrams == 0)
+            Results::fail("ingestion: " + std::to_string(received - datagrams) + " of " + std::to_string(streamed) + " stream lines and "
+                + std::to_string(datagrams) + " of " + std::to_string(udpSources * linesPerSource) + " datagrams received");
+        if (parse && valid != received)
+            Results::fail("ingestion: " + std::to_string(received - valid) + " lines of Messages.h not valid after framing");
+    }
+}
+
+void ingestionBenchmark()
+{
+    for (auto backend : { IngestionEngine::Backend::epoll, IngestionEngine::Backend::uring })
+        for (bool parse : { false, true })
+            for (size_t loops : { 1, 2, 4 })
+                run(backend, loops, parse);
+}
+
+#else
+
+void ingestionBenchmark()
+{
+    std::cout << "The IngestionEngine is only available on Linux" << std::endl;
+}
+
+#endif
@@ -0,0 +1,162 @@
+// MetricsBenchmark.cpp : The cost of counting each line in ParseCounters, and a scrape of the MetricsExporter.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <Nmea/CorpusGenerator.h>
+#include <Nmea/LineFramer.h>
+#include <Nmea/Nmea.h>
+#include <Nmea/ParseCounters.h>
+
+#include "Benchmarks.h"
+#include "Results.h"
+
+#if defined(__linux__)
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <Nmea/MetricsExporter.h>
+
+#endif
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    const size_t sources = 8;
+    const size_t corpusBytes = 4 << 20;
+    const size_t counts = 10000000;
+
+    double parse(const std::string& corpus, const std::vector<SourceId>& ids, ParseCounters* counters)
+    {
+        Nmea nmea;
+        nmea.setCounters(counters);
+
+        uint64_t lines = 0;
+        const auto start = Clock::now();
+        LineFramer::split(corpus, [&](std::string_view line) {
+            nmea.parse(line, LineOrigin{ ids[lines % ids.size()], 0 });
+            ++lines;
+        });
+
+        return lines / std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+#if defined(__linux__)
+    // A scrape as Prometheus does it
+    std::string get(uint16_t port, const char* path)
+    {
+        const int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in remote{};
+        remote.sin_family = AF_INET;
+        remote.sin_port = htons(port);
+        remote.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (::connect(fd, reinterpret_cast<sockaddr*>(&remote), sizeof(remote)) < 0)
+        {
+            ::close(fd);
+            return {};
+        }
+
+        const std::string request = std::string("GET ") + path + " HTTP/1.1\r\nHost: localhost\r\n\r\n";
+        [[maybe_unused]] auto sent = ::send(fd, request.data(), request.size(), 0);
+
+        std::string response;
+        char buffer[4096];
+        for (ssize_t count; (count = ::recv(fd, buffer, sizeof(buffer), 0)) > 0;)
+            response.append(buffer, static_cast<size_t>(count));
+        ::close(fd);
+
+        return response;
+    }
+#endif
+}
+
+void metricsBenchmark()
+{
+    std::string corpus;
+    CorpusGenerator(11, 0.05).fill(corpus, corpusBytes);
+
+    std::vector<SourceId> ids;
+    for (size_t i = 0; i < sources; ++i)
+        ids.push_back(SourceInterner::global().intern("metrics" + std::to_string(i)));
+
+    // The counting alone, with the labels of the lines changing as in the corpus
+    {
+        ParseCounters counters;
+        auto& shard = counters.addShard();
+        const char* addresses[] = { "GPGGA", "GPRMC", "ABVDM", "GPGSV", "PGRME" };
+        const auto start = Clock::now();
+        for (size_t i = 0; i < counts; ++i)
+            shard.count(ids[i % sources], addresses[i / 3 % 5], i % 20 == 0 ? ErrorCode::E004 : ErrorCode::E000, 70);
+        const double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / counts;
+
+        std::cout << std::fixed << std::setprecision(1) << "count:           " << std::setw(9) << ns << " ns/line" << std::endl;
+        Results::record("metrics/count", "ns/line", ns);
+    }
+
+    // Alternated, the best of each, as the difference is within the noise of one run.
+    // The counters of the first run are shown and served below.
+    ParseCounters counters;
+    ParseCounters later;
+    double without = 0;
+    double with = 0;
+    for (int run = 0; run < 4; ++run)
+    {
+        // Which goes first matters on a busy machine
+        if (run % 2 == 0)
+            without = std::max(without, parse(corpus, ids, nullptr));
+        with = std::max(with, parse(corpus, ids, run == 0 ? &counters : &later));
+        if (run % 2 == 1)
+            without = std::max(without, parse(corpus, ids, nullptr));
+    }
+    std::cout << std::setprecision(0) << "parse:           " << std::setw(9) << without << " lines/s" << std::endl
+        << "parse, counted:  " << std::setw(9) << with << " lines/s" << std::endl;
+    Results::record("metrics/parse", "lines/s", without);
+    Results::record("metrics/parse/counted", "lines/s", with);
+
+    uint64_t lines = 0;
+    uint64_t bytes = 0;
+    uint64_t errors = 0;
+    size_t corrupted = 0;
+    const auto entries = counters.snapshot();
+    for (const auto& entry : entries)
+    {
+        lines += entry.lines;
+        bytes += entry.bytes;
+        if (entry.code != ErrorCode::E000)
+            errors += entry.lines;
+
+        // A corrupted address is labelled invalid, not with its characters
+        const std::string address = entry.talker + entry.formatter;
+        if (entry.formatter != "invalid" && entry.formatter != "other" &&
+            (address.size() < 2 || address.find_first_not_of("ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789") != std::string::npos))
+            ++corrupted;
+    }
+    std::cout << entries.size() << " label combinations, " << lines << " lines, " << bytes << " of " << corpus.size() << " bytes, "
+        << errors << " with errors" << std::endl;
+    if (corrupted != 0 || lines == 0 || bytes != corpus.size())
+        Results::fail("metrics: " + std::to_string(corrupted) + " combinations labelled with a corrupted address, "
+            + std::to_string(bytes) + " of " + std::to_string(corpus.size()) + " bytes counted");
+
+#if defined(__linux__)
+    MetricsExporter exporter(counters, 0);
+    const auto start = Clock::now();
+    const std::string response = get(exporter.port(), "/metrics");
+    const double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+    std::cout << std::setprecision(2) << "scrape: " << response.size() << " bytes in " << ms << " ms, "
+        << response.substr(0, response.find('\r')) << std::endl;
+    const size_t sample = response.find("nmea_lines_total{");
+    if (sample != std::string::npos)
+        std::cout << "  " << response.substr(sample, response.find('\n', sample) - sample) << std::endl;
+    Results::record("metrics/scrape", "ms", ms);
+#endif
+}
@@ -1,10 +1,140 @@
 // NewParsingTest.cpp : This file contains the 'main' function. Program execution begins and ends there.
 //
 
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <fstream>
 #include <iostream>
+#include <string>
+#include <vector>
 
-int main()
+#include <Nmea/CorpusGenerator.h>
+
+#include "Benchmarks.h"
+#include "Results.h"
+
+namespace
 {
-    std::cout << "Hello World!\n";
+    struct Benchmark
+    {
+        const char* name;
+        void (*run)();
+    };
+
+    const Benchmark benchmarks[]{
+        { "spatial", spatialIndexBenchmark },
+        { "dedup", deduplicatorBenchmark },
+        { "groups", groupCorrelatorBenchmark },
+        { "ingestion", ingestionBenchmark },
+        { "udp", udpReceiverBenchmark },
+        { "parallel", parallelParserBenchmark },
+        { "gzip", gzipReaderBenchmark },
+        { "capture", captureBenchmark },
+        { "replay", replayBenchmark },
+        { "sharded", shardedParserBenchmark },
+        { "publisher", publisherBenchmark },
+        { "stream", sentenceStreamBenchmark },
+        { "stages", stageBenchmark },
+        { "corpus", corpusBenchmark },
+        { "profile", profilerBenchmark },
+        { "metrics", metricsBenchmark },
+        { "perf", perfCounterBenchmark },
+        { "allocations", allocationBenchmark },
+        { "trace", traceBenchmark },
+        { "validation", validationBenchmark },
+        { "prefilter", prefilterBenchmark },
+        { "adaptive", adaptiveValidationBenchmark },
+    };
 }
 
+// Run the benchmarks named on the command line, or all of them.
+// --json <file> writes the results recorded by the benchmarks to the file, to track regressions.
+// --generate <file> <megabytes> writes a synthetic corpus instead, with --seed <n> and --errors <rate>.
+// --allocation-budget [<formatter>=]<allocations> fails the run if Nmea::parse allocates more per sentence,
+// of the formatter or else of all, instead of the default budget of the allocation benchmark.
+// --max-allocation-budget [<formatter>=]<allocations> does the same for the most allocating parse.
+// --trace <file> is where the trace benchmark writes its Chrome trace, trace.json by default.
+int main(int argc, char* argv[])
+{
+    const char* json = nullptr;
+    const char* corpus = nullptr;
+    uint64_t megabytes = 0;
+    uint64_t seed = 1;
+    double errorRate = 0;
+    std::vector<const char*> names;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--json") == 0 && i + 1 < argc)
+            json = argv[++i];
+        else if (std::strcmp(argv[i], "--generate") == 0 && i + 2 < argc)
+        {
+            corpus = argv[++i];
+            megabytes = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+            seed = std::strtoull(argv[++i], nullptr, 10);
+        else if (std::strcmp(argv[i], "--errors") == 0 && i + 1 < argc)
+            errorRate = std::atof(argv[++i]);
+        else if (std::strcmp(argv[i], "--allocation-budget") == 0 && i + 1 < argc)
+        {
+            const std::string budget = argv[++i];
+            const size_t equals = budget.find('=');
+            setAllocationBudget(equals == std::string::npos ? "all" : budget.substr(0, equals), std::atof(budget.c_str() + equals + 1));
+        }
+        else if (std::strcmp(argv[i], "--max-allocation-budget") == 0 && i + 1 < argc)
+        {
+            const std::string budget = argv[++i];
+            const size_t equals = budget.find('=');
+            setMaxAllocationBudget(equals == std::string::npos ? "all" : budget.substr(0, equals), std::atof(budget.c_str() + equals + 1));
+        }
+        else if (std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+            setTraceFile(argv[++i]);
+        else
+            names.push_back(argv[i]);
+    }
+
+    if (corpus != nullptr)
+    {
+        try
+        {
+            const uint64_t lines = CorpusGenerator(seed, errorRate).write(corpus, megabytes << 20);
+            std::cout << lines << " lines written to " << corpus << std::endl;
+            return 0;
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+    }
+
+    for (const auto& benchmark : benchmarks)
+    {
+        bool selected = names.empty();
+        for (const char* name : names)
+            selected = selected || std::strcmp(name, benchmark.name) == 0;
+
+        if (!selected)
+            continue;
+
+        std::cout << "== " << benchmark.name << " ==" << std::endl;
+        benchmark.run();
+    }
+
+    if (json != nullptr)
+    {
+        std::ofstream out(json);
+        Results::writeJson(out);
+        if (!out)
+        {
+            std::cerr << "Can't write " << json << std::endl;
+            return 1;
+        }
+    }
+
+    for (const auto& failure : Results::failures())
+        std::cerr << "FAILED " << failure << std::endl;
+
+    return Results::failures().empty() ? 0 : 1;
+}
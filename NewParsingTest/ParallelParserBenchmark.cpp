@@ -0,0 +1,112 @@
+// ParallelParserBenchmark.cpp : One stream parsed by a growing number of workers, checking the dispatch order.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <Nmea/Messages.h>
+#include <Nmea/Nmea.h>
+#include <Nmea/ParallelParser.h>
+
+#include "Benchmarks.h"
+#include "Results.h"
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    const size_t lines = 50000;
+
+    double percentile(std::vector<double>& latencies, double fraction)
+    {
+        const size_t index = static_cast<size_t>(fraction * (latencies.size() - 1));
+        std::nth_element(latencies.begin(), latencies.begin() + index, latencies.end());
+        return latencies[index];
+    }
+
+    void report(const char* name, size_t count, double seconds, std::vector<double>& latencies, size_t misordered, uint64_t stolen)
+    {
+        std::cout << std::fixed << std::setprecision(0)
+            << name << std::setw(8) << count / seconds << " lines/s, latency p50 "
+            << std::setprecision(1) << percentile(latencies, 0.5) << " us, p99 "
+            << percentile(latencies, 0.99) << " us, p99.9 "
+            << percentile(latencies, 0.999) << " us, max "
+            << *std::max_element(latencies.begin(), latencies.end()) << " us, "
+            << misordered << " out of order, " << stolen << " stolen" << std::endl;
+    }
+
+    void runSerial(const std::vector<std::string>& input)
+    {
+        Nmea nmea;
+        std::vector<double> latencies;
+        latencies.reserve(input.size());
+
+        const auto start = Clock::now();
+        for (const auto& line : input)
+        {
+            const auto submitted = Clock::now();
+            nmea.parse(line);
+            latencies.push_back(std::chrono::duration<double, std::micro>(Clock::now() - submitted).count());
+        }
+        const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+        report("serial:     ", input.size(), seconds, latencies, 0, 0);
+    }
+
+    void runParallel(const std::vector<std::string>& input, size_t workers)
+    {
+        std::vector<Clock::time_point> submitted(input.size());
+        std::vector<double> latencies;
+        latencies.reserve(input.size());
+
+        // The dispatch order shall be the submission order, with each line next to its own parse result
+        uint64_t expected = 0;
+        size_t misordered = 0;
+
+        const auto start = Clock::now();
+        uint64_t stolen;
+        {
+            ParallelParser parser([&](uint64_t sequence, std::string_view line, const Nmea& nmea) {
+                latencies.push_back(std::chrono::duration<double, std::micro>(Clock::now() - submitted[sequence]).count());
+                const auto& fields = nmea.sentenceFields();
+                const bool own = fields.empty() || (fields.front().data() >= line.data() && fields.front().data() < line.data() + line.size());
+                if (sequence != expected++ || line != input[sequence] || !own)
+                    ++misordered;
+            }, workers);
+
+            // Submitted as fast as the window allows, so the latency includes the wait for the earlier lines
+            for (size_t i = 0; i < input.size(); ++i)
+            {
+                submitted[i] = Clock::now();
+                parser.submit(input[i]);
+            }
+            parser.flush();
+            stolen = parser.stolen();
+        }
+        const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+        misordered += input.size() - expected;
+
+        const std::string name = std::to_string(workers) + " worker(s): ";
+        report(name.c_str(), input.size(), seconds, latencies, misordered, stolen);
+        if (misordered != 0)
+            Results::fail("parallel: " + std::to_string(misordered) + " line(s) dispatched out of order with " + std::to_string(workers) + " worker(s)");
+    }
+}
+
+void parallelParserBenchmark()
+{
+    const auto& messages = GetMessages();
+
+    std::vector<std::string> input;
+    for (size_t i = 0; i < lines; ++i)
+        input.emplace_back(messages[i % messages.size()]);
+
+    runSerial(input);
+    for (size_t workers : { 1, 2, 4, 8 })
+        runParallel(input, workers);
+}
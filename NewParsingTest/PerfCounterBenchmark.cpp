@@ -0,0 +1,146 @@
+// PerfCounterBenchmark.cpp : Cycles, instructions, branch and cache misses per sentence of each parse stage and formatter.
+//
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <Nmea/CorpusGenerator.h>
+#include <Nmea/Nmea.h>
+#include <Nmea/StageProfiler.h>
+
+#include "Benchmarks.h"
+#include "PerfCounters.h"
+#include "Results.h"
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    const size_t corpusLines = 20000;
+    const size_t minLines = 100000;
+    const char* const stageNames[] = { "main structure", "general contents", "specific contents" };
+    const size_t stages = 3;
+
+    // ns and the events per sentence
+    typedef std::array<double, PerfCounters::events + 1> PerSentence;
+
+    // Runs the first stages of the parse over the lines, repeated to at least minLines
+    PerSentence run(PerfCounters& counters, const std::vector<std::string>& lines, size_t depth)
+    {
+        Nmea nmea;
+        const size_t rounds = std::max<size_t>(1, minLines / lines.size());
+
+        const auto start = Clock::now();
+        counters.start();
+        for (size_t round = 0; round < rounds; ++round)
+        {
+            for (const auto& line : lines)
+            {
+                try
+                {
+                    if (depth > 0)
+                        nmea.parseMainStructure(line);
+                    if (depth > 1)
+                        nmea.parseGeneralContents();
+                    if (depth > 2)
+                        nmea.parseSpecificContents();
+                }
+                catch (...)
+                {
+                }
+            }
+        }
+        const auto counts = counters.stop();
+        const double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+
+        const double sentences = static_cast<double>(rounds * lines.size());
+        PerSentence perSentence{};
+        perSentence[0] = ns / sentences;
+        for (size_t event = 0; event < PerfCounters::events; ++event)
+            perSentence[event + 1] = counts[event] / sentences;
+        return perSentence;
+    }
+
+    void print(const std::string& formatter, size_t stage, const PerSentence& cost, const PerfCounters& counters)
+    {
+        std::cout << "  " << std::left << std::setw(7) << formatter << std::setw(18) << stageNames[stage] << std::right
+            << std::fixed << std::setprecision(0) << std::setw(8) << cost[0];
+
+        const std::string prefix = "perf/" + formatter + "/" + stageNames[stage] + "/";
+        Results::record(prefix + "time", "ns/sentence", cost[0]);
+        if (!counters.available())
+        {
+            std::cout << std::endl;
+            return;
+        }
+
+        const double cycles = cost[1 + PerfCounters::cycles];
+        const double instructions = cost[1 + PerfCounters::instructions];
+        std::cout << std::setw(9) << cycles << std::setw(9) << instructions << std::setprecision(2) << std::setw(6)
+            << (cycles > 0 ? instructions / cycles : 0);
+        for (auto event : { PerfCounters::branchMisses, PerfCounters::l1dMisses, PerfCounters::llcMisses })
+        {
+            if (counters.available(event))
+                std::cout << std::setprecision(1) << std::setw(9) << cost[1 + event];
+            else
+                std::cout << std::setw(9) << "-";
+        }
+        std::cout << std::endl;
+
+        for (size_t event = 0; event < PerfCounters::events; ++event)
+            if (counters.available(static_cast<PerfCounters::Event>(event)))
+                Results::record(prefix + PerfCounters::name(static_cast<PerfCounters::Event>(event)), "1/sentence", cost[1 + event]);
+        Results::record(prefix + "IPC", "instructions/cycle", cycles > 0 ? instructions / cycles : 0);
+    }
+}
+
+void perfCounterBenchmark()
+{
+    PerfCounters counters;
+    if (!counters.available())
+        std::cout << "No hardware counters (" << counters.error() << "), showing the time only" << std::endl;
+
+    // The valid lines of a synthetic corpus, by formatter
+    std::map<std::string, std::vector<std::string>> byFormatter;
+    {
+        CorpusGenerator generator(44);
+        Nmea nmea;
+        std::string line;
+        for (size_t i = 0; i < corpusLines; ++i)
+        {
+            generator.next(line);
+            nmea.parse(line);
+            const auto& fields = nmea.sentenceFields();
+            if (nmea.errorCode() == ErrorCode::E000 && !fields.empty())
+            {
+                byFormatter[std::string(StageProfiler::formatter(fields[0]))].push_back(line);
+                byFormatter["all"].push_back(line);
+            }
+        }
+    }
+
+    std::cout << "  per sentence                    ns";
+    if (counters.available())
+        std::cout << "   cycles    instr   IPC  br miss L1D miss LLC miss";
+    std::cout << std::endl;
+    for (const auto& [formatter, lines] : byFormatter)
+    {
+        // A stage costs what running it adds to running the stages before it
+        PerSentence previous = run(counters, lines, 0);
+        for (size_t stage = 0; stage < stages; ++stage)
+        {
+            const PerSentence total = run(counters, lines, stage + 1);
+            PerSentence cost{};
+            for (size_t i = 0; i < cost.size(); ++i)
+                cost[i] = std::max(0.0, total[i] - previous[i]);
+            print(formatter, stage, cost, counters);
+            previous = total;
+        }
+    }
+}
@@ -0,0 +1,141 @@
+#include "PerfCounters.h"
+
+#if defined(__linux__)
+
+#include <cerrno>
+#include <cstring>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace
+{
+    int open(uint32_t type, uint64_t config, int group)
+    {
+        perf_event_attr attributes;
+        std::memset(&attributes, 0, sizeof(attributes));
+        attributes.size = sizeof(attributes);
+        attributes.type = type;
+        attributes.config = config;
+        attributes.disabled = group < 0 ? 1 : 0;
+        attributes.exclude_kernel = 1;
+        attributes.exclude_hv = 1;
+        attributes.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_ID | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        return static_cast<int>(::syscall(SYS_perf_event_open, &attributes, 0, -1, group, 0));
+    }
+
+    uint64_t cacheMisses(uint64_t cache)
+    {
+        return cache | PERF_COUNT_HW_CACHE_OP_READ << 8 | PERF_COUNT_HW_CACHE_RESULT_MISS << 16;
+    }
+}
+
+PerfCounters::PerfCounters() :
+    m_Descriptors(),
+    m_Error()
+{
+    m_Descriptors.fill(-1);
+
+    m_Descriptors[cycles] = open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, -1);
+    if (m_Descriptors[cycles] < 0)
+    {
+        m_Error = std::string("perf_event_open: ") + std::strerror(errno);
+        if (errno == EACCES || errno == EPERM)
+            m_Error += ", see /proc/sys/kernel/perf_event_paranoid";
+        return;
+    }
+
+    const int leader = m_Descriptors[cycles];
+    m_Descriptors[instructions] = open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, leader);
+    m_Descriptors[branchMisses] = open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES, leader);
+    m_Descriptors[l1dMisses] = open(PERF_TYPE_HW_CACHE, cacheMisses(PERF_COUNT_HW_CACHE_L1D), leader);
+    m_Descriptors[llcMisses] = open(PERF_TYPE_HW_CACHE, cacheMisses(PERF_COUNT_HW_CACHE_LL), leader);
+}
+
+PerfCounters::~PerfCounters()
+{
+    // The members first, then the leader
+    for (size_t event = events; event-- > 0;)
+        if (m_Descriptors[event] >= 0)
+            ::close(m_Descriptors[event]);
+}
+
+void PerfCounters::start() noexcept
+{
+    if (!available())
+        return;
+
+    ::ioctl(m_Descriptors[cycles], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ::ioctl(m_Descriptors[cycles], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+PerfCounters::Counts PerfCounters::stop() noexcept
+{
+    Counts counts{};
+    if (!available())
+        return counts;
+
+    ::ioctl(m_Descriptors[cycles], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+
+    // nr, time enabled, time running, then a value and an id per event
+    uint64_t data[3 + 2 * events] = {};
+    if (::read(m_Descriptors[cycles], data, sizeof(data)) < static_cast<ssize_t>(3 * sizeof(uint64_t)))
+        return counts;
+
+    uint64_t ids[events] = {};
+    for (size_t event = 0; event < events; ++event)
+        if (m_Descriptors[event] >= 0)
+            ::ioctl(m_Descriptors[event], PERF_EVENT_IOC_ID, &ids[event]);
+
+    const double scale = data[2] == 0 ? 0.0 : static_cast<double>(data[1]) / data[2];
+    for (size_t i = 0; i < data[0] && i < events; ++i)
+    {
+        for (size_t event = 0; event < events; ++event)
+            if (m_Descriptors[event] >= 0 && ids[event] == data[4 + 2 * i])
+                counts[event] = static_cast<uint64_t>(data[3 + 2 * i] * scale);
+    }
+
+    return counts;
+}
+
+#else
+
+PerfCounters::PerfCounters() :
+    m_Descriptors(),
+    m_Error("Hardware performance counters are only available on Linux")
+{
+    m_Descriptors.fill(-1);
+}
+
+PerfCounters::~PerfCounters()
+{
+}
+
+void PerfCounters::start() noexcept
+{
+}
+
+PerfCounters::Counts PerfCounters::stop() noexcept
+{
+    return Counts{};
+}
+
+#endif
+
+const char* PerfCounters::name(Event event) noexcept
+{
+    switch (event)
+    {
+    case cycles: return "cycles";
+    case instructions: return "instructions";
+    case branchMisses: return "branch misses";
+    case l1dMisses: return "L1D misses";
+    case llcMisses: return "LLC misses";
+    case events: break;
+    }
+
+    return "unknown";
+}
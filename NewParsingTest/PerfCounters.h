@@ -0,0 +1,54 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+/// <summary>
+///        Hardware performance counters of the calling thread, read with perf_event_open.
+/// </summary>
+/// The counters are opened as one group, so they count over the same instructions. A counter the CPU or the
+/// virtual machine does not provide is left out. When perf events are not permitted, e.g. by
+/// kernel.perf_event_paranoid or a container, or on other systems than Linux, available() is false and
+/// error() tells why.
+class PerfCounters
+{
+public:
+    enum Event { cycles, instructions, branchMisses, l1dMisses, llcMisses, events };
+
+    typedef std::array<uint64_t, events> Counts;
+
+    PerfCounters();
+    ~PerfCounters();
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    /// true if at least the cycles are counted
+    bool available() const noexcept { return m_Descriptors[cycles] >= 0; }
+
+    /// true if the event is counted
+    bool available(Event event) const noexcept { return m_Descriptors[event] >= 0; }
+
+    /// Why the counters are not available
+    const std::string& error() const noexcept { return m_Error; }
+
+    /// <summary>
+    ///        Resets and starts the counters.
+    /// </summary>
+    void start() noexcept;
+
+    /// <summary>
+    ///        Stops the counters and reads them.
+    /// </summary>
+    /// \return The counts since start(), scaled up if the group was multiplexed with other events, 0 for
+    /// the events not available
+    Counts stop() noexcept;
+
+    /// The name of an event
+    static const char* name(Event event) noexcept;
+
+private:
+    std::array<int, events> m_Descriptors;
+    std::string             m_Error;
+};
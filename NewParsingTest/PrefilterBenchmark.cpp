@@ -0,0 +1,125 @@
+// PrefilterBenchmark.cpp : Parsing only the sentences subscribed to out of a mixed synthetic feed, with and without
+// dropping the others by their address field first.
+//
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <Nmea/CorpusGenerator.h>
+#include <Nmea/LineFramer.h>
+#include <Nmea/Nmea.h>
+#include <Nmea/SentenceFilter.h>
+
+#include "Benchmarks.h"
+#include "Results.h"
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    const uint64_t seed = 20240611;
+    const size_t corpusBytes = 4 << 20;
+    const int repeats = 3;
+
+    struct Run
+    {
+        std::vector<std::string> addresses;
+        const char*              name;
+    };
+
+    double secondsSince(Clock::time_point start)
+    {
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    // The formatter of a parsed line, e.g. GGA, or PGRM for proprietary sentences as the filter tells them apart
+    std::string_view formatter(const Nmea& nmea)
+    {
+        const auto& fields = nmea.sentenceFields();
+        if (fields.empty() || fields[0].size() < 5)
+            return {};
+
+        return fields[0][1] == 'P' ? fields[0].substr(1, 4) : fields[0].substr(fields[0].size() - 3);
+    }
+
+    bool wanted(const std::vector<std::string>& addresses, std::string_view code)
+    {
+        for (const auto& address : addresses)
+            if (address == code)
+                return true;
+        return false;
+    }
+}
+
+void prefilterBenchmark()
+{
+    std::string corpus;
+    const size_t lines = CorpusGenerator(seed, 0.01).fill(corpus, corpusBytes);
+
+    const Run runs[]{
+        { { "GGA" }, "GGA" },
+        { { "GGA", "RMC" }, "GGA RMC" },
+        { { "VDM", "PGRM" }, "VDM PGRM" },
+    };
+
+    std::cout << lines << " lines" << std::endl;
+    std::cout << "  subscribed    passed  parse all lines/s  prefilter lines/s  speedup  filter ns/line" << std::endl;
+    for (const auto& run : runs)
+    {
+        SentenceFilter filter;
+        for (const auto& address : run.addresses)
+            filter.subscribe(address);
+
+        Nmea nmea;
+        double parseAll = 0;
+        double prefiltered = 0;
+        double filterOnly = 0;
+        uint64_t matched = 0;
+        uint64_t passed = 0;
+        for (int repeat = 0; repeat < repeats; ++repeat)
+        {
+            // Every line parsed, the subscriber picks its formatters from the results
+            matched = 0;
+            auto start = Clock::now();
+            LineFramer::split(corpus, [&](std::string_view line) {
+                nmea.parse(line);
+                if (wanted(run.addresses, formatter(nmea)))
+                    ++matched;
+            });
+            parseAll = std::max(parseAll, lines / secondsSince(start));
+
+            // The lines of other formatters dropped before parsing
+            passed = 0;
+            start = Clock::now();
+            LineFramer::split(corpus, [&](std::string_view line) {
+                if (!filter.passes(line))
+                    return;
+                ++passed;
+                nmea.parse(line);
+            });
+            prefiltered = std::max(prefiltered, lines / secondsSince(start));
+
+            uint64_t count = 0;
+            start = Clock::now();
+            LineFramer::split(corpus, [&](std::string_view line) { count += filter.passes(line); });
+            const double ns = secondsSince(start) * 1e9 / lines;
+            filterOnly = repeat == 0 ? ns : std::min(filterOnly, ns);
+        }
+
+        std::cout << "  " << std::left << std::setw(12) << run.name << std::right << std::setw(8) << passed
+            << std::fixed << std::setprecision(0) << std::setw(19) << parseAll << std::setw(19) << prefiltered
+            << std::setprecision(1) << std::setw(8) << prefiltered / parseAll << "x" << std::setw(16) << filterOnly << std::endl;
+
+        // Corrupt lines whose address can't be read pass, so the filter passes at least the lines wanted
+        if (passed < matched)
+            Results::fail("prefilter: " + std::string(run.name) + " passed fewer lines than the parser matched");
+
+        const std::string name = "prefilter/" + std::string(run.name);
+        Results::record(name + "/rate", "lines/s", prefiltered);
+        Results::record(name + "/speedup", "x", prefiltered / parseAll);
+        Results::record(name + "/filter", "ns/line", filterOnly);
+    }
+}
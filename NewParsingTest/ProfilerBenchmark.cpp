@@ -0,0 +1,139 @@
+// ProfilerBenchmark.cpp : The per-stage latency histograms of framing, parsing and publishing synthetic lines from many sources.
+//
+
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <Nmea/CorpusGenerator.h>
+#include <Nmea/LineFramer.h>
+#include <Nmea/Nmea.h>
+#include <Nmea/Publisher.h>
+#include <Nmea/StageProfiler.h>
+
+#include "Benchmarks.h"
+#include "Results.h"
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    const size_t sources = 16;
+    const size_t chunkBytes = 16 << 10;
+    const size_t chunksPerSource = 32;
+    const size_t stages = static_cast<size_t>(Stage::count);
+
+    void printStages(const char* label, const StageProfiler::StageHistograms& histograms)
+    {
+        std::cout << "  " << std::left << std::setw(10) << label << std::right;
+        for (size_t stage = 0; stage < stages; ++stage)
+            std::cout << std::setw(9) << histograms[stage].percentile(0.5) << std::setw(8) << histograms[stage].percentile(0.99);
+        std::cout << std::endl;
+    }
+}
+
+void profilerBenchmark()
+{
+    if (!StageProfiler::enabled())
+        std::cout << "Built without NMEA_PROFILING=1, the stage timers are compiled out" << std::endl;
+
+    // The lines of each source in chunks, as they would be read from a socket
+    std::vector<std::vector<std::string>> chunks(sources);
+    std::vector<SourceId> ids(sources);
+    for (size_t i = 0; i < sources; ++i)
+    {
+        CorpusGenerator generator(i + 1, 0.02);
+        ids[i] = SourceInterner::global().intern("profile" + std::to_string(i));
+        chunks[i].resize(chunksPerSource);
+        for (auto& chunk : chunks[i])
+            generator.fill(chunk, chunkBytes);
+    }
+
+    Publisher publisher;
+    std::atomic<uint64_t> delivered{ 0 };
+    publisher.subscribe([&](const Publisher::Delivery&) { delivered.fetch_add(1, std::memory_order_relaxed); });
+
+    // Snapshots are taken all along, as a monitoring thread would
+    std::atomic<bool> running{ true };
+    uint64_t snapshots = 0;
+    std::thread reader([&] {
+        while (running.load(std::memory_order_relaxed))
+        {
+            (void)StageProfiler::snapshot();
+            ++snapshots;
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+    });
+
+    Nmea nmea;
+    uint64_t lines = 0;
+    const auto start = Clock::now();
+    for (size_t chunk = 0; chunk < chunksPerSource; ++chunk)
+    {
+        for (size_t i = 0; i < sources; ++i)
+        {
+            const LineOrigin origin{ ids[i], 0 };
+            StageProfiler::HandlerTimer timer;
+            timer.begin();
+            LineFramer::split(chunks[i][chunk], [&](std::string_view line) {
+                timer.framed();
+                nmea.parse(line, origin);
+                publisher.publish(line, nmea);
+                ++lines;
+                timer.handled(origin.source);
+            });
+        }
+    }
+    const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    running = false;
+    reader.join();
+    publisher.flush();
+
+    std::cout << std::fixed << std::setprecision(0) << lines << " lines from " << sources << " sources, "
+        << lines / seconds << " lines/s, " << delivered << " delivered, " << snapshots << " snapshots taken meanwhile" << std::endl;
+    Results::record("profile/rate", "lines/s", lines / seconds);
+
+    if (!StageProfiler::enabled())
+        return;
+
+    const auto snapshot = StageProfiler::snapshot();
+
+    std::cout << "  ns        ";
+    for (size_t stage = 0; stage < stages; ++stage)
+        std::cout << std::setw(17) << StageProfiler::name(static_cast<Stage>(stage));
+    std::cout << std::endl << "            ";
+    for (size_t stage = 0; stage < stages; ++stage)
+        std::cout << std::setw(9) << "p50" << std::setw(8) << "p99";
+    std::cout << std::endl;
+    printStages("all", snapshot.stages);
+    size_t malformed = 0;
+    for (const auto& [formatter, histograms] : snapshot.formatters)
+    {
+        printStages(formatter.empty() ? "(none)" : formatter.c_str(), histograms);
+        malformed += formatter != "error" && formatter.find_first_not_of("ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789") != std::string::npos ? 1 : 0;
+    }
+
+    // The corrupted lines of the corpus are kept under "error", not under the headers they happen to have
+    if (malformed != 0 || snapshot.formatters.count("error") == 0)
+        Results::fail("profile: " + std::to_string(malformed) + " formatters of corrupted headers, "
+            + std::to_string(snapshot.formatters.count("error")) + " error formatter");
+
+    for (size_t i = 0; i < 3; ++i)
+        printStages(std::string(SourceInterner::global().name(ids[i])).c_str(), snapshot.sources.at(ids[i]));
+
+    for (size_t stage = 0; stage < stages; ++stage)
+    {
+        const auto& histogram = snapshot.stages[stage];
+        const std::string name = std::string("profile/") + StageProfiler::name(static_cast<Stage>(stage));
+        std::cout << "  " << std::left << std::setw(18) << StageProfiler::name(static_cast<Stage>(stage)) << std::right
+            << std::setw(10) << histogram.count() << " lines, mean " << std::setw(6) << histogram.mean()
+            << " ns, p99.9 " << std::setw(7) << histogram.percentile(0.999) << " ns" << std::endl;
+        Results::record(name + "/p50", "ns", static_cast<double>(histogram.percentile(0.5)));
+        Results::record(name + "/p99", "ns", static_cast<double>(histogram.percentile(0.99)));
+    }
+}
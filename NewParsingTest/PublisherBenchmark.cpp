@@ -0,0 +1,166 @@
+// PublisherBenchmark.cpp : A fast and several slow subscribers of the Publisher, with each drop policy.
+//
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <Nmea/Messages.h>
+#include <Nmea/Nmea.h>
+#include <Nmea/Publisher.h>
+
+#include "Benchmarks.h"
+#include "Results.h"
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    const size_t lines = 20000;
+    const size_t alarmInterval = 50;    // One alarm per this many lines
+    const size_t capacity = 256;
+    const auto slowness = std::chrono::microseconds(100);
+
+    // Returns the checksum field "*hh" for the characters between the start character and the checksum
+    std::string checksum(const std::string& s)
+    {
+        unsigned char sum = 0;
+        for (size_t i = 1; i < s.size(); ++i)
+            sum ^= static_cast<unsigned char>(s[i]);
+
+        char buffer[4];
+        std::snprintf(buffer, sizeof(buffer), "%02X", sum);
+        return std::string("*") + buffer;
+    }
+
+    std::string alarm(size_t i)
+    {
+        char buffer[64];
+        std::snprintf(buffer, sizeof(buffer), "$IIALR,%02zu%02zu00.00,%03zu,A,V,Bilge alarm", i / 60 % 24, i % 60, i % 1000);
+        return buffer + checksum(buffer) + "\r\n";
+    }
+
+    // Every field of a delivery, including the empty ones, shall be the field of the parsed line
+    void checkFields()
+    {
+        std::string line = "$GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,,,,";
+        line += checksum(line) + "\r\n";
+
+        Nmea nmea;
+        nmea.parse(line);
+        const std::vector<std::string> expected(nmea.sentenceFields().begin(), nmea.sentenceFields().end());
+
+        size_t delivered = 0;
+        std::string error;
+        Publisher publisher;
+        publisher.subscribe([&](const Publisher::Delivery& delivery) {
+            ++delivered;
+            try
+            {
+                if (delivery.fields() != expected.size())
+                    error = std::to_string(delivery.fields()) + " fields delivered of " + std::to_string(expected.size());
+                for (size_t i = 0; i < delivery.fields() && i < expected.size() && error.empty(); ++i)
+                    if (delivery.field(i) != expected[i])
+                        error = "field " + std::to_string(i) + " delivered as \"" + std::string(delivery.field(i)) + "\"";
+            }
+            catch (const std::out_of_range&)
+            {
+                error = "a field is out of the line";
+            }
+        });
+
+        publisher.publish(line, nmea);
+        publisher.flush();
+
+        if (nmea.errorCode() != ErrorCode::E000 || delivered != 1 || !error.empty())
+            Results::fail("publisher: GGA with empty fields, " + (error.empty() ? std::to_string(delivered) + " deliveries" : error));
+    }
+
+    struct Subscription
+    {
+        const char*           name;
+        bool                  slow;
+        Publisher::Options    options;
+        std::atomic<uint64_t> alarms{ 0 };
+    };
+}
+
+void publisherBenchmark()
+{
+    checkFields();
+
+    const auto& messages = GetMessages();
+
+    std::vector<std::string> input;
+    for (size_t i = 0; i < lines; ++i)
+        input.push_back(i % alarmInterval == 0 ? alarm(i) : std::string(messages[i % messages.size()]));
+
+    Publisher::Options dropOldest;
+    dropOldest.capacity = capacity;
+
+    Publisher::Options dropNewest = dropOldest;
+    dropNewest.policy = Publisher::DropPolicy::dropNewest;
+
+    Publisher::Options latestPerMmsi = dropOldest;
+    latestPerMmsi.policy = Publisher::DropPolicy::latestPerKey;
+    latestPerMmsi.key = Publisher::byMmsi;
+
+    Publisher::Options byPriority = dropOldest;
+    byPriority.policy = Publisher::DropPolicy::byPriority;
+    byPriority.priorities = { { "GGA", 2 }, { "RMC", 2 }, { "VDM", 1 } };
+
+    Subscription subscriptions[] = {
+        { "fast, drop oldest:     ", false, dropOldest },
+        { "slow, drop oldest:     ", true, dropOldest },
+        { "slow, drop newest:     ", true, dropNewest },
+        { "slow, latest per MMSI: ", true, latestPerMmsi },
+        { "slow, by priority:     ", true, byPriority },
+    };
+
+    Publisher publisher;
+    for (auto& subscription : subscriptions)
+    {
+        publisher.subscribe([&subscription](const Publisher::Delivery& delivery) {
+            if (delivery.fields() > 0 && Publisher::isAlarm(delivery.field(0).substr(3)))
+                subscription.alarms.fetch_add(1, std::memory_order_relaxed);
+            if (subscription.slow)
+                std::this_thread::sleep_for(slowness);
+        }, subscription.options);
+    }
+
+    Nmea nmea;
+    Clock::duration publishing{};
+    const auto start = Clock::now();
+    for (const auto& line : input)
+    {
+        nmea.parse(line);
+
+        const auto before = Clock::now();
+        publisher.publish(line, nmea);
+        publishing += Clock::now() - before;
+    }
+    const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    publisher.flush();
+
+    std::cout << std::fixed << std::setprecision(0)
+        << "published " << lines << " lines at " << lines / seconds << " lines/s, publish "
+        << std::chrono::duration<double, std::nano>(publishing).count() / lines << " ns/line for "
+        << publisher.subscribers() << " subscribers" << std::endl;
+
+    const uint64_t alarms = (lines + alarmInterval - 1) / alarmInterval;
+    for (size_t i = 0; i < publisher.subscribers(); ++i)
+    {
+        const auto statistics = publisher.statistics(i);
+        std::cout << subscriptions[i].name
+            << std::setw(6) << statistics.delivered << " delivered, "
+            << std::setw(6) << statistics.dropped << " dropped, "
+            << std::setw(6) << statistics.replaced << " replaced, max queued " << std::setw(4) << statistics.maxQueued
+            << ", alarms delivered " << subscriptions[i].alarms << " of " << alarms << std::endl;
+    }
+}
@@ -0,0 +1,188 @@
+// ReplayBenchmark.cpp : Pacing of the ReplayEngine at several speeds and with several sinks.
+//
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include <Nmea/Capture.h>
+#include <Nmea/Messages.h>
+#include <Nmea/Nmea.h>
+#include <Nmea/ReplayEngine.h>
+#include <Nmea/ReplaySinks.h>
+
+#include "Benchmarks.h"
+#include "Results.h"
+
+#if defined(__linux__)
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    const int64_t interval = 1000000;   // One line per millisecond
+    const int64_t firstTime = 1700000000LL * 1000000000;
+
+    std::string writeCapture(size_t lines)
+    {
+        const char* directory = std::getenv("TMPDIR");
+        const std::string path = std::string(directory != nullptr ? directory : "/tmp") + "/replaybenchmark.cap";
+
+        const auto& messages = GetMessages();
+        Nmea nmea;
+        Capture::Writer writer(path);
+        for (size_t i = 0; i < lines; ++i)
+        {
+            const auto& line = messages[i % messages.size()];
+            nmea.parse(line, LineOrigin{ noSource, firstTime + static_cast<int64_t>(i) * interval });
+            writer.write(line, nmea);
+        }
+        writer.close();
+
+        return path;
+    }
+
+    void report(const std::string& name, const ReplayEngine::Statistics& statistics, uint64_t received)
+    {
+        std::cout << std::fixed << std::setprecision(0)
+            << std::left << std::setw(28) << name << std::right
+            << std::setw(9) << statistics.rate << " lines/s, lateness mean "
+            << std::setprecision(1) << statistics.meanError << " us, p99 < "
+            << statistics.p99Error << " us, max " << statistics.maxError << " us, "
+            << received << " of " << statistics.lines << " received" << std::endl;
+
+        if (received != statistics.lines || statistics.lines == 0)
+            Results::fail("replay: " + name + " " + std::to_string(received) + " of " + std::to_string(statistics.lines) + " lines received");
+    }
+
+    void replayCapture(const std::string& name, const std::string& path, double speed, std::chrono::nanoseconds spinTime)
+    {
+        Capture::Reader reader(path);
+        uint64_t received = 0;
+        CallbackSink sink([&](std::string_view) { ++received; });
+
+        ReplayEngine engine(sink, speed);
+        engine.setSpinTime(spinTime);
+        const auto statistics = engine.replay(reader, reader.begin());
+        report(name, statistics, received);
+    }
+
+    // Lines with a c: parameter, a few per second
+    void replayText(double speed)
+    {
+        const auto& messages = GetMessages();
+        const size_t seconds = 50;
+        const size_t perSecond = 20;
+
+        std::stringstream text;
+        for (size_t i = 0; i < seconds * perSecond; ++i)
+        {
+            const std::string parameter = "c:" + std::to_string(1700000000 + i / perSecond);
+            unsigned char checksum = 0;
+            for (char ch : parameter)
+                checksum ^= static_cast<unsigned char>(ch);
+
+            char hex[3];
+            std::snprintf(hex, sizeof(hex), "%02X", checksum);
+            std::string line(messages[i % messages.size()]);
+            text << '\\' << parameter << '*' << hex << '\\' << line.substr(0, line.find_last_not_of("\r\n") + 1) << "\r\n";
+        }
+
+        uint64_t received = 0;
+        CallbackSink sink([&](std::string_view) { ++received; });
+        ReplayEngine engine(sink, speed);
+        const auto statistics = engine.replay(text);
+        report("text c:, " + std::to_string(static_cast<int>(speed)) + "x:", statistics, received);
+    }
+
+#if defined(__linux__)
+
+    void replayUdp(const std::string& path, double speed)
+    {
+        const int fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+        sockaddr_in local{};
+        local.sin_family = AF_INET;
+        local.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        ::bind(fd, reinterpret_cast<sockaddr*>(&local), sizeof(local));
+        socklen_t length = sizeof(local);
+        ::getsockname(fd, reinterpret_cast<sockaddr*>(&local), &length);
+
+        timeval timeout{ 0, 100000 };
+        ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+        std::atomic<uint64_t> received{ 0 };
+        std::thread receiver([&] {
+            char buffer[2048];
+            while (::recv(fd, buffer, sizeof(buffer), 0) > 0)
+                ++received;
+        });
+
+        Capture::Reader reader(path);
+        UdpSink sink("127.0.0.1", ntohs(local.sin_port));
+        ReplayEngine engine(sink, speed);
+        const auto statistics = engine.replay(reader, reader.begin());
+
+        receiver.join();
+        ::close(fd);
+        report("capture, udp, " + std::to_string(static_cast<int>(speed)) + "x:", statistics, received);
+    }
+
+    void replayPty(const std::string& path, double speed)
+    {
+        Capture::Reader reader(path);
+        PtySink sink;
+
+        const int fd = ::open(sink.device().c_str(), O_RDONLY | O_NOCTTY);
+        std::atomic<uint64_t> received{ 0 };
+        std::atomic<bool> done{ false };
+        std::thread receiver([&] {
+            char buffer[4096];
+            while (!done)
+            {
+                const ssize_t count = ::read(fd, buffer, sizeof(buffer));
+                for (ssize_t i = 0; i < count; ++i)
+                    received += buffer[i] == '\n';
+            }
+        });
+
+        ReplayEngine engine(sink, speed);
+        const auto statistics = engine.replay(reader, reader.begin());
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        done = true;
+        sink.emit("\n");   // Wakes the receiver
+        receiver.join();
+        ::close(fd);
+        report("capture, pty, " + std::to_string(static_cast<int>(speed)) + "x:", statistics, received - 1);
+    }
+
+#endif
+}
+
+void replayBenchmark()
+{
+    const std::string path = writeCapture(5000);
+
+    // 5000 lines at 1 ms intervals, a replay of 0.5 s at 10x
+    replayCapture("capture, 10x, sleep only:", path, 10, std::chrono::nanoseconds(0));
+    replayCapture("capture, 10x, sleep + spin:", path, 10, std::chrono::microseconds(200));
+    replayCapture("capture, as fast as possible:", path, ReplayEngine::asFastAsPossible, std::chrono::nanoseconds(0));
+    replayText(100);
+
+#if defined(__linux__)
+    replayUdp(path, 10);
+    replayPty(path, 10);
+#endif
+
+    std::remove(path.c_str());
+}
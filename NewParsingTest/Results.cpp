@@ -0,0 +1,72 @@
+#include "Results.h"
+
+#include <cmath>
+#include <iomanip>
+#include <vector>
+
+namespace
+{
+    struct Measurement
+    {
+        std::string name;
+        std::string unit;
+        double      value;
+    };
+
+    std::vector<Measurement>& measurements()
+    {
+        static std::vector<Measurement> measurements;
+        return measurements;
+    }
+
+    std::vector<std::string>& failed()
+    {
+        static std::vector<std::string> failed;
+        return failed;
+    }
+
+    void writeString(std::ostream& out, const std::string& s)
+    {
+        out << '"';
+        for (char ch : s)
+        {
+            if (ch == '"' || ch == '\\')
+                out << '\\';
+            out << ch;
+        }
+        out << '"';
+    }
+}
+
+void Results::record(const std::string& name, const std::string& unit, double value)
+{
+    measurements().push_back(Measurement{ name, unit, value });
+}
+
+void Results::writeJson(std::ostream& out)
+{
+    out << "[\n";
+    bool first = true;
+    for (const auto& measurement : measurements())
+    {
+        out << (first ? "  { \"name\": " : ",\n  { \"name\": ");
+        writeString(out, measurement.name);
+        out << ", \"unit\": ";
+        writeString(out, measurement.unit);
+
+        // JSON has no NaN nor infinity
+        out << ", \"value\": " << std::setprecision(9) << (std::isfinite(measurement.value) ? measurement.value : 0.0) << " }";
+        first = false;
+    }
+    out << "\n]\n";
+}
+
+void Results::fail(const std::string& what)
+{
+    failed().push_back(what);
+}
+
+const std::vector<std::string>& Results::failures()
+{
+    return failed();
+}
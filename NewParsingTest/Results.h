@@ -0,0 +1,33 @@
+#pragma once
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+/// <summary>
+///        Collects the measurements of the benchmarks for the machine-readable output.
+/// </summary>
+/// The output is a JSON array of { "name", "unit", "value" } objects, the format of common benchmark trackers,
+/// so the results of each run can be compared with the previous runs.
+namespace Results
+{
+    /// <summary>
+    ///        Records a measurement.
+    /// </summary>
+    /// \param name [in] A name unique within the run, e.g. "stages/valid/parseMainStructure/GGA".
+    /// \param unit [in] The unit of the value, e.g. "ns/sentence".
+    void record(const std::string& name, const std::string& unit, double value);
+
+    /// <summary>
+    ///        Writes the measurements recorded so far as JSON.
+    /// </summary>
+    void writeJson(std::ostream& out);
+
+    /// <summary>
+    ///        Records a failed check, e.g. an exceeded budget, so the program exits with a non-zero code.
+    /// </summary>
+    void fail(const std::string& what);
+
+    /// The failed checks recorded so far
+    const std::vector<std::string>& failures();
+}
@@ -0,0 +1,229 @@
+// SentenceStreamBenchmark.cpp : A coroutine per source awaiting its lines from the IngestionEngine, against a callback.
+//
+
+#include <iostream>
+
+#include "Benchmarks.h"
+#include "Results.h"
+
+#if defined(__linux__)
+
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include <Nmea/IngestionEngine.h>
+#include <Nmea/Messages.h>
+#include <Nmea/Nmea.h>
+#include <Nmea/SentenceStream.h>
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    const size_t sources = 1000;
+    const size_t linesPerSource = 50;
+
+    struct Counters
+    {
+        std::atomic<uint64_t> lines{ 0 };
+        std::atomic<uint64_t> valid{ 0 };
+        std::atomic<uint64_t> positions{ 0 };
+    };
+
+    StreamTask consumeLines(SentenceStream& stream, Counters& counters)
+    {
+        while (const Nmea* nmea = co_await stream.next())
+        {
+            counters.lines.fetch_add(1, std::memory_order_relaxed);
+            if (nmea->errorCode() == ErrorCode::E000)
+                counters.valid.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    StreamTask consumePositions(SentenceStream& stream, Counters& counters)
+    {
+        while (auto report = co_await stream.nextPositionReport())
+            counters.positions.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // The lines of source i, each source starting at another line of the corpus
+    std::string corpus(size_t i)
+    {
+        const auto& messages = GetMessages();
+
+        std::string text;
+        for (size_t line = i * linesPerSource; line < (i + 1) * linesPerSource; ++line)
+            text += messages[line % messages.size()];
+
+        return text;
+    }
+
+    // The number of valid lines of every step-th source
+    uint64_t validLines(size_t step)
+    {
+        const auto& messages = GetMessages();
+        Nmea nmea;
+        uint64_t valid = 0;
+        for (size_t i = 0; i < sources; i += step)
+            for (size_t line = i * linesPerSource; line < (i + 1) * linesPerSource; ++line)
+            {
+                nmea.parse(messages[line % messages.size()]);
+                valid += nmea.errorCode() == ErrorCode::E000 ? 1 : 0;
+            }
+
+        return valid;
+    }
+
+    // Each pipe holds the whole text, so the writes do not wait for the engine
+    void feed(IngestionEngine& engine, std::vector<SourceId>& ids, std::vector<int>& writers)
+    {
+        for (size_t i = 0; i < sources; ++i)
+        {
+            int fds[2];
+            if (::pipe(fds) != 0)
+                break;
+
+            ids.push_back(engine.addDescriptor("stream" + std::to_string(i), fds[0]));
+            writers.push_back(fds[1]);
+        }
+    }
+
+    void write(const std::vector<int>& writers)
+    {
+        for (size_t i = 0; i < writers.size(); ++i)
+        {
+            const int fd = writers[i];
+            const std::string text = corpus(i);
+            for (size_t written = 0; written < text.size();)
+            {
+                const ssize_t count = ::write(fd, text.data() + written, text.size() - written);
+                if (count <= 0)
+                    break;
+                written += static_cast<size_t>(count);
+            }
+            ::close(fd);
+        }
+    }
+
+    // Waits until the count stops growing for a while
+    double settle(const std::atomic<uint64_t>& count, uint64_t expected, Clock::time_point start)
+    {
+        uint64_t previous = 0;
+        auto lastProgress = Clock::now();
+        while (count < expected && Clock::now() - lastProgress < std::chrono::milliseconds(200))
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            if (count != previous)
+            {
+                previous = count;
+                lastProgress = Clock::now();
+            }
+        }
+
+        return std::chrono::duration<double>((count < expected ? lastProgress : Clock::now()) - start).count();
+    }
+
+    void runCallback(size_t loops)
+    {
+        Counters counters;
+        IngestionEngine engine([&](const LineOrigin& origin, std::string_view line) {
+            thread_local Nmea nmea;
+            nmea.parse(line, origin);
+            counters.lines.fetch_add(1, std::memory_order_relaxed);
+            if (nmea.errorCode() == ErrorCode::E000)
+                counters.valid.fetch_add(1, std::memory_order_relaxed);
+        }, loops);
+
+        std::vector<SourceId> ids;
+        std::vector<int> writers;
+        feed(engine, ids, writers);
+
+        engine.start();
+        const auto start = Clock::now();
+        write(writers);
+        const double seconds = settle(counters.lines, ids.size() * linesPerSource, start);
+        engine.stop();
+
+        std::cout << std::fixed << std::setprecision(0)
+            << "callback,   " << loops << " loop(s): " << std::setw(7) << counters.lines / seconds << " lines/s, "
+            << counters.lines << " lines, " << counters.valid << " valid" << std::endl;
+
+        if (counters.lines != ids.size() * linesPerSource || ids.size() != sources || counters.valid != validLines(1))
+            Results::fail("stream: the callback of " + std::to_string(loops) + " loop(s) got " + std::to_string(counters.lines)
+                + " lines of " + std::to_string(sources * linesPerSource) + ", " + std::to_string(counters.valid) + " valid");
+    }
+
+    void runCoroutines(size_t loops)
+    {
+        Counters counters;
+        std::atomic<uint64_t> routed{ 0 };
+        StreamRouter router;
+        IngestionEngine engine([&](const LineOrigin& origin, std::string_view line) {
+            router.route(origin, line);
+            routed.fetch_add(1, std::memory_order_relaxed);
+        }, loops);
+
+        std::vector<SourceId> ids;
+        std::vector<int> writers;
+        feed(engine, ids, writers);
+
+        // Every other source is consumed for its position reports only
+        std::vector<StreamTask> tasks;
+        for (size_t i = 0; i < ids.size(); ++i)
+        {
+            auto& stream = router.stream(ids[i]);
+            tasks.push_back(i % 2 == 0 ? consumeLines(stream, counters) : consumePositions(stream, counters));
+        }
+
+        engine.start();
+        const auto start = Clock::now();
+        write(writers);
+        const double seconds = settle(routed, ids.size() * linesPerSource, start);
+        engine.stop();
+        router.close();
+
+        uint64_t dropped = 0;
+        size_t done = 0;
+        for (size_t i = 0; i < ids.size(); ++i)
+        {
+            dropped += router.stream(ids[i]).dropped();
+            done += tasks[i].done() ? 1 : 0;
+        }
+
+        std::cout << std::fixed << std::setprecision(0)
+            << "coroutines, " << loops << " loop(s): " << std::setw(7) << routed / seconds << " lines/s, "
+            << routed << " lines, " << counters.valid << " valid, " << counters.positions << " position reports, "
+            << dropped << " dropped, " << done << " of " << tasks.size() << " coroutines done" << std::endl;
+
+        // The line consumers are the even sources, half of the lines
+        if (routed != ids.size() * linesPerSource || ids.size() != sources || counters.lines != sources / 2 * linesPerSource ||
+            counters.valid != validLines(2) || dropped != 0 || done != tasks.size())
+            Results::fail("stream: the coroutines of " + std::to_string(loops) + " loop(s) got " + std::to_string(counters.lines)
+                + " lines of " + std::to_string(sources / 2 * linesPerSource) + ", " + std::to_string(counters.valid) + " valid, "
+                + std::to_string(dropped) + " dropped, " + std::to_string(done) + " of " + std::to_string(tasks.size()) + " done");
+    }
+}
+
+void sentenceStreamBenchmark()
+{
+    for (size_t loops : { 1, 2, 4 })
+    {
+        runCallback(loops);
+        runCoroutines(loops);
+    }
+}
+
+#else
+
+void sentenceStreamBenchmark()
+{
+    std::cout << "The IngestionEngine is only available on Linux" << std::endl;
+}
+
+#endif
@@ -0,0 +1,126 @@
+// ShardedParserBenchmark.cpp : A noisy source next to quiet sources, on one shard and on shards of their own.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <Nmea/Messages.h>
+#include <Nmea/Nmea.h>
+#include <Nmea/ShardedParser.h>
+
+#include "Benchmarks.h"
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    const size_t quietSources = 7;
+    const size_t quietInterval = 16;   // One quiet line per this many noisy lines
+    const auto duration = std::chrono::milliseconds(500);
+
+    enum class Placement
+    {
+        together,   // All sources on shard 0
+        apart,      // The noisy source alone on shard 0
+        rebalanced  // All sources on shard 0, moved by the rebalancer
+    };
+
+    double percentile(std::vector<double>& latencies, double fraction)
+    {
+        if (latencies.empty())
+            return 0;
+
+        const size_t index = static_cast<size_t>(fraction * (latencies.size() - 1));
+        std::nth_element(latencies.begin(), latencies.begin() + index, latencies.end());
+        return latencies[index];
+    }
+
+    void run(const char* name, size_t shards, Placement placement)
+    {
+        auto& interner = SourceInterner::global();
+        const SourceId noisy = interner.intern("noisy");
+        std::vector<SourceId> quiet;
+        for (size_t i = 0; i < quietSources; ++i)
+            quiet.push_back(interner.intern("quiet" + std::to_string(i)));
+
+        // The receive time of a line is when it was submitted, on the steady clock
+        const auto now = [] { return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count(); };
+
+        std::mutex mutex;
+        std::vector<double> latencies;
+        uint64_t parsed = 0;
+        uint64_t noisySent = 0, noisyDropped = 0;
+        uint64_t quietSent = 0, quietDropped = 0;
+        size_t moves = 0;
+        size_t noisyShard;
+
+        const auto& messages = GetMessages();
+        {
+            ShardedParser parser([&](size_t, std::string_view, const Nmea& nmea) {
+                std::lock_guard<std::mutex> lock(mutex);
+                ++parsed;
+                if (nmea.origin().source != noisy)
+                    latencies.push_back((now() - nmea.origin().receiveTime) / 1000.0);
+            }, shards, {}, 1024);
+
+            for (size_t i = 0; i < quiet.size(); ++i)
+                parser.assign(quiet[i], placement == Placement::apart ? 1 + i % (shards - 1) : 0);
+            parser.assign(noisy, 0);
+
+            if (placement == Placement::rebalanced)
+            {
+                parser.setRebalancer([&](ShardedParser& p, const std::vector<ShardedParser::ShardLoad>& loads) {
+                    const size_t before = p.shardOf(noisy);
+                    ShardedParser::moveBusiestSource(p, loads);
+                    if (p.shardOf(noisy) != before)
+                        ++moves;
+                }, std::chrono::milliseconds(20));
+            }
+
+            // The noisy source sends as fast as it can, more than one shard can parse
+            const auto end = Clock::now() + duration;
+            for (size_t i = 0; Clock::now() < end; ++i)
+            {
+                const auto& message = messages[i % messages.size()];
+                ++noisySent;
+                if (!parser.submit(message, LineOrigin{ noisy, now() }))
+                    ++noisyDropped;
+
+                if (i % quietInterval == 0)
+                {
+                    ++quietSent;
+                    if (!parser.submit(message, LineOrigin{ quiet[(i / quietInterval) % quiet.size()], now() }))
+                        ++quietDropped;
+                }
+
+                if (i % 64 == 63)
+                    std::this_thread::yield();
+            }
+            parser.flush();
+            noisyShard = parser.shardOf(noisy);
+        }
+
+        std::cout << std::fixed << std::setprecision(0)
+            << name << std::setw(7) << parsed / std::chrono::duration<double>(duration).count() << " lines/s, quiet latency p50 "
+            << std::setprecision(1) << percentile(latencies, 0.5) << " us, p99 "
+            << percentile(latencies, 0.99) << " us, dropped quiet " << quietDropped << " of " << quietSent
+            << ", noisy " << noisyDropped << " of " << noisySent;
+        if (placement == Placement::rebalanced)
+            std::cout << ", noisy source moved " << moves << " time(s) to shard " << noisyShard;
+        std::cout << std::endl;
+    }
+}
+
+void shardedParserBenchmark()
+{
+    run("1 shard:                ", 1, Placement::together);
+    run("4 shards, together:     ", 4, Placement::together);
+    run("4 shards, apart:        ", 4, Placement::apart);
+    run("4 shards, rebalanced:   ", 4, Placement::rebalanced);
+}
@@ -0,0 +1,172 @@
+// SpatialIndexBenchmark.cpp : Updates and range queries over a moving fleet of AIS targets.
+//
+
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <Nmea/SpatialIndex.h>
+
+#include "Benchmarks.h"
+#include "Results.h"
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    struct Vessel
+    {
+        uint32_t mmsi;
+        double   latitude;
+        double   longitude;
+        double   speed;   // Knots
+        double   course;  // Radians
+    };
+
+    // A fleet spread over the North Sea, moving on straight courses
+    std::vector<Vessel> makeFleet(size_t size, std::mt19937& random)
+    {
+        std::uniform_real_distribution<double> latitude(50.0, 62.0);
+        std::uniform_real_distribution<double> longitude(-5.0, 12.0);
+        std::uniform_real_distribution<double> speed(0.0, 25.0);
+        std::uniform_real_distribution<double> course(0.0, 2 * 3.14159265358979323846);
+
+        std::vector<Vessel> fleet(size);
+        for (size_t i = 0; i < size; ++i)
+            fleet[i] = { static_cast<uint32_t>(257000000 + i), latitude(random), longitude(random), speed(random), course(random) };
+
+        return fleet;
+    }
+
+    void move(Vessel& vessel, double seconds)
+    {
+        const double distance = vessel.speed * seconds / 3600.0 / 60.0; // Degrees of latitude
+        vessel.latitude += distance * std::cos(vessel.course);
+        vessel.longitude += distance * std::sin(vessel.course) / std::cos(vessel.latitude * 3.14159265358979323846 / 180.0);
+    }
+
+    // The reference answer, visiting every target
+    size_t linearScan(const std::vector<Vessel>& fleet, double latitude, double longitude, double radius)
+    {
+        size_t count = 0;
+        for (const auto& vessel : fleet)
+            if (SpatialIndex::distance(latitude, longitude, vessel.latitude, vessel.longitude) <= radius)
+                ++count;
+
+        return count;
+    }
+
+    double nanoseconds(Clock::duration duration, size_t count)
+    {
+        return count == 0 ? 0.0 : std::chrono::duration<double, std::nano>(duration).count() / count;
+    }
+}
+
+void spatialIndexBenchmark()
+{
+    const size_t fleetSize = 20000;
+    const size_t rounds = 50;              // Every vessel reports once per round
+    const size_t updatesPerQuery = 50;     // The update and query mix
+    const double radii[]{ 2.0, 10.0, 25.0 };
+
+    std::mt19937 random(4711);
+    auto fleet = makeFleet(fleetSize, random);
+    std::uniform_int_distribution<size_t> anyVessel(0, fleetSize - 1);
+
+    for (double cellSize : { 0.05, 0.1, 0.5 })
+    {
+        SpatialIndex index(cellSize);
+        for (const auto& vessel : fleet)
+            index.update(vessel.mmsi, vessel.latitude, vessel.longitude);
+
+        std::vector<uint32_t> result;
+        size_t updates = 0;
+        size_t queries = 0;
+        size_t hits = 0;
+        Clock::duration updateTime{};
+        Clock::duration queryTime{};
+
+        for (size_t round = 0; round < rounds; ++round)
+        {
+            for (size_t i = 0; i < fleetSize; ++i)
+            {
+                auto& vessel = fleet[i];
+                move(vessel, 10.0);
+
+                const auto start = Clock::now();
+                index.update(vessel.mmsi, vessel.latitude, vessel.longitude);
+                updateTime += Clock::now() - start;
+                ++updates;
+
+                if (i % updatesPerQuery == 0)
+                {
+                    const auto& center = fleet[anyVessel(random)];
+                    const double radius = radii[queries % std::size(radii)];
+
+                    const auto queryStart = Clock::now();
+                    index.queryRadius(center.latitude, center.longitude, radius, result);
+                    queryTime += Clock::now() - queryStart;
+                    ++queries;
+                    hits += result.size();
+                }
+            }
+        }
+
+        std::cout << std::fixed << std::setprecision(2) << "cell " << std::setw(4) << cellSize << " deg: "
+            << std::setprecision(1) << std::setw(8) << nanoseconds(updateTime, updates) << " ns/update, "
+            << std::setw(8) << nanoseconds(queryTime, queries) << " ns/query, "
+            << std::setw(6) << static_cast<double>(hits) / queries << " targets/query" << std::endl;
+    }
+
+    // Compare with visiting every target, and check that the answers agree
+    SpatialIndex index;
+    for (const auto& vessel : fleet)
+        index.update(vessel.mmsi, vessel.latitude, vessel.longitude);
+
+    std::vector<uint32_t> result;
+    const size_t queries = 1000;
+    Clock::duration indexTime{};
+    Clock::duration scanTime{};
+    size_t mismatches = 0;
+
+    for (size_t i = 0; i < queries; ++i)
+    {
+        const auto& center = fleet[anyVessel(random)];
+        const double radius = radii[i % std::size(radii)];
+
+        auto start = Clock::now();
+        index.queryRadius(center.latitude, center.longitude, radius, result);
+        indexTime += Clock::now() - start;
+
+        start = Clock::now();
+        const size_t expected = linearScan(fleet, center.latitude, center.longitude, radius);
+        scanTime += Clock::now() - start;
+
+        if (expected != result.size())
+            ++mismatches;
+    }
+
+    std::cout << "linear scan: " << std::setw(10) << nanoseconds(scanTime, queries) << " ns/query, index: "
+        << std::setw(8) << nanoseconds(indexTime, queries) << " ns/query, mismatches: " << mismatches << std::endl;
+
+    if (mismatches != 0)
+        Results::fail("spatial: " + std::to_string(mismatches) + " radius queries differ from the linear scan");
+
+    // A position that is not a number is not indexed, and finds nothing
+    const double notANumber = std::numeric_limits<double>::quiet_NaN();
+    index.queryBox(-90.0, -180.0, 90.0, 180.0, result);
+    const size_t indexed = result.size();
+    if (index.update(1, notANumber, 0.0) || index.update(1, 0.0, notANumber))
+        Results::fail("spatial: a position that is not a number was indexed");
+    index.queryBox(-90.0, -180.0, 90.0, 180.0, result);
+    if (result.size() != indexed)
+        Results::fail("spatial: a position that is not a number changed the index");
+    index.queryRadius(notANumber, 0.0, 100.0, result);
+    if (!result.empty())
+        Results::fail("spatial: a query at a position that is not a number found targets");
+}
@@ -0,0 +1,225 @@
+// StageBenchmark.cpp : The cost of each stage of Nmea::parse, per formatter, for valid and for corrupt input.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <Nmea/CorpusGenerator.h>
+#include <Nmea/Nmea.h>
+
+#include "Benchmarks.h"
+#include "Results.h"
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    const size_t lines = 100000;
+    const uint64_t seed = 2024;
+    const char* const stageNames[] = { "parseMainStructure", "parseGeneralContents", "parseSpecificContents" };
+    const size_t stages = 3;
+
+    struct StageTimes
+    {
+        uint64_t count[stages] = {};    // The lines entering each stage
+        double   ns[stages] = {};
+        uint64_t valid = 0;
+    };
+
+    // The position of the sentence start character after the tag blocks, or npos
+    size_t sentenceStart(const std::string& line)
+    {
+        const size_t lastTagBlock = line.rfind('\\');
+        return line.find_first_of("$!", lastTagBlock == std::string::npos ? 0 : lastTagBlock);
+    }
+
+    // The last three characters of the address field, e.g. GGA of $GPGGA
+    std::string formatter(const std::string& line)
+    {
+        const size_t start = sentenceStart(line);
+        if (start == std::string::npos)
+            return "none";
+
+        const size_t end = line.find_first_of(",*", start);
+        if (end == std::string::npos || end < start + 4)
+            return "none";
+
+        return line.substr(end - 3, 3);
+    }
+
+    // Replaces one character of the sentence, and for every other line corrects the checksum so the
+    // error is found by the later stages
+    std::string corrupt(std::string line, std::mt19937& random)
+    {
+        const size_t start = sentenceStart(line);
+        const size_t star = line.rfind('*');
+        if (start == std::string::npos || star == std::string::npos || star <= start + 1)
+            return line;
+
+        static const char replacements[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ,.-~ ";
+        const size_t position = std::uniform_int_distribution<size_t>(start + 1, star - 1)(random);
+        const char replacement = replacements[std::uniform_int_distribution<size_t>(0, sizeof(replacements) - 2)(random)];
+        line[position] = replacement == line[position] ? '~' : replacement;
+
+        if (random() % 2 == 0 && star + 2 < line.size())
+        {
+            unsigned char sum = 0;
+            for (size_t i = start + 1; i < star; ++i)
+                sum ^= static_cast<unsigned char>(line[i]);
+
+            char digits[3];
+            std::snprintf(digits, sizeof(digits), "%02X", sum);
+            line[star + 1] = digits[0];
+            line[star + 2] = digits[1];
+        }
+
+        return line;
+    }
+
+    // The cost of reading the clock, subtracted from each stage
+    double clockOverhead()
+    {
+        const size_t reads = 100000;
+        const auto start = Clock::now();
+        for (size_t i = 0; i < reads; ++i)
+            (void)Clock::now();
+        return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / reads;
+    }
+
+    // Runs the stages one by one as Nmea::parse does, timing each
+    std::map<std::string, StageTimes> measureStages(const std::vector<std::string>& input, const std::vector<std::string>& formatters)
+    {
+        std::map<std::string, StageTimes> times;
+        Nmea nmea;
+
+        for (size_t i = 0; i < input.size(); ++i)
+        {
+            auto& time = times[formatters[i]];
+            Clock::time_point marks[stages + 1];
+            size_t completed = 0;
+            bool ok = false;
+
+            marks[0] = Clock::now();
+            try
+            {
+                nmea.parseMainStructure(input[i]);
+                marks[++completed] = Clock::now();
+                nmea.parseGeneralContents();
+                marks[++completed] = Clock::now();
+                nmea.parseSpecificContents();
+                marks[++completed] = Clock::now();
+                ok = true;
+            }
+            catch (...)
+            {
+                // The stage that threw is timed to the end of its exception handling
+                marks[++completed] = Clock::now();
+            }
+
+            for (size_t stage = 0; stage < completed; ++stage)
+            {
+                ++time.count[stage];
+                time.ns[stage] += std::chrono::duration<double, std::nano>(marks[stage + 1] - marks[stage]).count();
+            }
+            if (ok)
+                ++time.valid;
+        }
+
+        return times;
+    }
+
+    // Nmea::parse over the whole input, without reading the clock per line
+    double measureParse(const std::vector<std::string>& input)
+    {
+        Nmea nmea;
+        const auto start = Clock::now();
+        for (const auto& line : input)
+            nmea.parse(line);
+        return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / input.size();
+    }
+
+    double perSentence(const StageTimes& time, size_t stage, double overhead)
+    {
+        return time.count[stage] == 0 ? 0 : std::max(0.0, time.ns[stage] / time.count[stage] - overhead);
+    }
+
+    void run(const char* kind, const std::vector<std::string>& input, const std::vector<std::string>& formatters, double overhead)
+    {
+        const auto times = measureStages(input, formatters);
+
+        StageTimes all;
+        for (const auto& [name, time] : times)
+        {
+            for (size_t stage = 0; stage < stages; ++stage)
+            {
+                all.count[stage] += time.count[stage];
+                all.ns[stage] += time.ns[stage];
+            }
+            all.valid += time.valid;
+        }
+
+        const std::string prefix = std::string("stages/") + kind + "/";
+        std::cout << kind << " input, " << input.size() << " lines, " << all.valid << " valid" << std::endl;
+        for (size_t stage = 0; stage < stages; ++stage)
+        {
+            const double ns = perSentence(all, stage, overhead);
+            std::cout << "  " << std::left << std::setw(22) << stageNames[stage] << std::right << std::fixed << std::setprecision(0)
+                << std::setw(8) << ns << " ns/sentence " << std::setw(10) << (ns > 0 ? 1e9 / ns : 0) << " sentences/s, "
+                << all.count[stage] << " lines entered" << std::endl;
+
+            Results::record(prefix + stageNames[stage], "ns/sentence", ns);
+            Results::record(prefix + stageNames[stage] + "/rate", "sentences/s", ns > 0 ? 1e9 / ns : 0);
+        }
+
+        const double parse = measureParse(input);
+        std::cout << "  " << std::left << std::setw(22) << "parse" << std::right
+            << std::setw(8) << parse << " ns/sentence " << std::setw(10) << 1e9 / parse << " sentences/s" << std::endl;
+        Results::record(prefix + "parse", "ns/sentence", parse);
+        Results::record(prefix + "parse/rate", "sentences/s", 1e9 / parse);
+
+        std::cout << "  formatter     lines   main ns general ns specific ns" << std::endl;
+        for (const auto& [name, time] : times)
+        {
+            std::cout << "  " << std::left << std::setw(9) << name << std::right << std::setw(9) << time.count[0];
+            for (size_t stage = 0; stage < stages; ++stage)
+            {
+                const double ns = perSentence(time, stage, overhead);
+                std::cout << std::setw(stage == 0 ? 10 : 12) << ns;
+                Results::record(prefix + stageNames[stage] + "/" + name, "ns/sentence", ns);
+            }
+            std::cout << std::endl;
+        }
+    }
+}
+
+void stageBenchmark()
+{
+    // Each corrupt line is a valid line with a defect, so both sets have the same formatters
+    CorpusGenerator generator(seed);
+    std::mt19937 random(static_cast<std::mt19937::result_type>(seed));
+
+    std::vector<std::string> valid;
+    std::vector<std::string> corrupted;
+    std::vector<std::string> formatters;
+    std::string line;
+    for (size_t i = 0; i < lines; ++i)
+    {
+        generator.next(line);
+        valid.push_back(line);
+        corrupted.push_back(corrupt(line, random));
+        formatters.push_back(formatter(valid.back()));
+    }
+
+    const double overhead = clockOverhead();
+    std::cout << std::fixed << std::setprecision(1) << "clock overhead " << overhead << " ns, subtracted from each stage" << std::endl;
+
+    run("valid", valid, formatters, overhead);
+    run("corrupt", corrupted, formatters, overhead);
+}
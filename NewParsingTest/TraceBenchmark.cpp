@@ -0,0 +1,173 @@
+// TraceBenchmark.cpp : Records the spans of reading, framing, parsing, decoding and dispatching synthetic lines through
+// sharded parsers, writes them as a Chrome trace, and measures the cost of recording.
+//
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <Nmea/AisPosition.h>
+#include <Nmea/CorpusGenerator.h>
+#include <Nmea/LineFramer.h>
+#include <Nmea/Messages.h>
+#include <Nmea/Nmea.h>
+#include <Nmea/ShardedParser.h>
+#include <Nmea/TraceRecorder.h>
+
+#include "Benchmarks.h"
+#include "Results.h"
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    const size_t sources = 8;
+    const size_t chunkBytes = 4 << 10;
+    const size_t chunksPerSource = 64;
+
+    std::string traceFile = "trace.json";
+
+    // Reads the chunks of the sources in turn into the sharded parsers, the lines parsed per second.
+    // The queues hold all lines, so none are dropped when the parsers fall behind.
+    double run(const std::vector<std::vector<std::string>>& chunks, const std::vector<SourceId>& ids)
+    {
+        std::atomic<uint64_t> decoded{ 0 };
+        ShardedParser parser([&](size_t, std::string_view, const Nmea& nmea) {
+            if (nmea.errorCode() == ErrorCode::E000 && Ais::decodePositionReport(nmea.sentenceFields()))
+                decoded.fetch_add(1, std::memory_order_relaxed);
+        }, 2, {}, 32768);
+
+        uint64_t lines = 0;
+        const auto start = Clock::now();
+        for (size_t chunk = 0; chunk < chunksPerSource; ++chunk)
+        {
+            for (size_t i = 0; i < sources; ++i)
+            {
+                std::string_view text;
+                {
+                    TraceRecorder::Span span("read", ids[i]);
+                    text = chunks[i][chunk];
+                }
+
+                const LineOrigin origin{ ids[i], TraceRecorder::now() };
+                TraceRecorder::HandlerSpans spans;
+                spans.begin(origin.source);
+                LineFramer::split(text, [&](std::string_view line) {
+                    spans.framed();
+                    parser.submit(line, origin);
+                    ++lines;
+                    spans.handled();
+                });
+            }
+        }
+        parser.flush();
+
+        return lines / std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    // A single fragment position report of Messages.h without its tag block, as sent by the own vessel: VDO
+    std::string ownPositionReport()
+    {
+        Nmea nmea;
+        for (const auto message : GetMessages())
+        {
+            const auto sentence = message.substr(std::min(message.find('!'), message.size()));
+            nmea.parse(sentence);
+            if (nmea.errorCode() != ErrorCode::E000 || sentence.size() < 7 || sentence.substr(3, 3) != "VDM" || !Ais::decodePositionReport(nmea.sentenceFields()))
+                continue;
+
+            std::string line(sentence.substr(0, sentence.find('*')));
+            line[5] = 'O';
+            unsigned char sum = 0;
+            for (size_t i = 1; i < line.size(); ++i)
+                sum ^= static_cast<unsigned char>(line[i]);
+
+            char checksum[6];
+            std::snprintf(checksum, sizeof(checksum), "*%02X\r\n", sum);
+            return line + checksum;
+        }
+        return {};
+    }
+
+    // A session has the spans of that session only, and a decode span the formatter of its sentence
+    void checkSession()
+    {
+        const std::string line = ownPositionReport();
+        Nmea nmea;
+
+        TraceRecorder::start();
+        nmea.parse(line);
+        const bool decoded = Ais::decodePositionReport(nmea.sentenceFields()).has_value();
+        TraceRecorder::stop();
+
+        std::ostringstream json;
+        const size_t spans = TraceRecorder::writeJson(json);
+        const std::string text = json.str();
+        if (!decoded || spans != 2 || text.find("\"formatter\":\"VDO\"") == std::string::npos || text.find("VDM") != std::string::npos)
+            Results::fail("trace: " + std::to_string(spans) + " spans of the parse and decode of an own position report, " +
+                (decoded ? "decoded" : "not decoded"));
+    }
+}
+
+void setTraceFile(const std::string& path)
+{
+    traceFile = path;
+}
+
+void traceBenchmark()
+{
+    std::vector<std::vector<std::string>> chunks(sources);
+    std::vector<SourceId> ids(sources);
+    for (size_t i = 0; i < sources; ++i)
+    {
+        CorpusGenerator generator(i + 1, 0.02);
+        ids[i] = SourceInterner::global().intern("trace" + std::to_string(i));
+        chunks[i].resize(chunksPerSource);
+        for (auto& chunk : chunks[i])
+            generator.fill(chunk, chunkBytes);
+    }
+
+    TraceRecorder::setThreadName("reader");
+
+    // Alternate which run goes first, the first one warms the caches and the allocator
+    double off = 0;
+    double on = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+        if (i % 2 == 0)
+            off += run(chunks, ids);
+
+        TraceRecorder::start();
+        on += run(chunks, ids);
+        TraceRecorder::stop();
+
+        if (i % 2 == 1)
+            off += run(chunks, ids);
+    }
+
+    std::cout << std::fixed << std::setprecision(0) << off / 4 << " lines/s without recording, " << on / 4
+        << " lines/s recording" << std::endl;
+    Results::record("trace/off", "lines/s", off / 4);
+    Results::record("trace/on", "lines/s", on / 4);
+
+    std::ofstream out(traceFile);
+    const size_t spans = TraceRecorder::writeJson(out);
+    out.close();
+    if (!out)
+    {
+        std::cout << "Can't write " << traceFile << std::endl;
+        Results::fail("trace: can't write " + traceFile);
+        return;
+    }
+
+    std::cout << spans << " spans of the last run written to " << traceFile << ", open it in chrome://tracing or ui.perfetto.dev" << std::endl;
+
+    checkSession();
+}
@@ -0,0 +1,178 @@
+// UdpReceiverBenchmark.cpp : Loopback datagrams received one by one with recvfrom and in batches with the UdpReceiver.
+//
+
+#include <iostream>
+
+#include "Benchmarks.h"
+
+#if defined(__linux__)
+
+#include <chrono>
+#include <iomanip>
+#include <thread>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <Nmea/LineFramer.h>
+#include <Nmea/Messages.h>
+#include <Nmea/Nmea.h>
+#include <Nmea/UdpReceiver.h>
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    const uint16_t port = 29100;
+    const size_t datagrams = 200000;
+
+    int openReceiver()
+    {
+        const int fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+
+        const int receiveBuffer = 4 * 1024 * 1024;
+        ::setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &receiveBuffer, sizeof(receiveBuffer));
+
+        // The end of the test is detected by the socket timing out
+        timeval timeout{ 0, 100000 };
+        ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+        sockaddr_in local{};
+        local.sin_family = AF_INET;
+        local.sin_port = htons(port);
+        local.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        ::bind(fd, reinterpret_cast<sockaddr*>(&local), sizeof(local));
+
+        return fd;
+    }
+
+    void send()
+    {
+        const int fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+
+        sockaddr_in remote{};
+        remote.sin_family = AF_INET;
+        remote.sin_port = htons(port);
+        remote.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        const auto& messages = GetMessages();
+        for (size_t i = 0; i < datagrams; ++i)
+        {
+            const auto& message = messages[i % messages.size()];
+            ::sendto(fd, message.data(), message.size(), 0, reinterpret_cast<sockaddr*>(&remote), sizeof(remote));
+
+            if (i % 64 == 63)
+                std::this_thread::yield();
+        }
+
+        ::close(fd);
+    }
+
+    struct Result
+    {
+        uint64_t lines = 0;
+        uint64_t valid = 0;
+        uint64_t systemCalls = 0;
+        uint64_t stamped = 0;
+    };
+
+    void handle(Result& result, Nmea* nmea, std::string_view line, const LineOrigin& origin)
+    {
+        ++result.lines;
+        if (nmea == nullptr)
+            return;
+
+        nmea->parse(line, origin);
+        if (nmea->errorCode() == ErrorCode::E000)
+            ++result.valid;
+    }
+
+    // One recvfrom per datagram, copied to a string before parsing
+    void receiveNaive(int fd, Result& result, Nmea* nmea)
+    {
+        char buffer[2048];
+        for (;;)
+        {
+            const ssize_t count = ::recvfrom(fd, buffer, sizeof(buffer), 0, nullptr, nullptr);
+            if (count <= 0)
+                break;
+
+            ++result.systemCalls;
+            const std::string line(buffer, static_cast<size_t>(count));
+            handle(result, nmea, line, LineOrigin());
+        }
+    }
+
+    // Batches of datagrams parsed in place, with their kernel receive time
+    void receiveBatched(int fd, Result& result, Nmea* nmea)
+    {
+        UdpReceiver receiver;
+        UdpReceiver::enableTimestamps(fd);
+
+        for (;;)
+        {
+            const size_t count = receiver.receive(fd);
+            if (count == 0)
+                break;
+
+            for (size_t i = 0; i < count; ++i)
+            {
+                const LineOrigin origin{ noSource, receiver.receiveTime(i) };
+                if (origin.receiveTime != 0)
+                    ++result.stamped;
+
+                LineFramer::split(receiver.datagram(i), [&](std::string_view line) {
+                    handle(result, nmea, line, origin);
+                });
+            }
+        }
+        result.systemCalls = receiver.systemCalls();
+    }
+
+    template<typename Receive>
+    void run(const char* name, Receive receive, bool parse)
+    {
+        const int fd = openReceiver();
+        Nmea nmea;
+        Result result;
+
+        const auto start = Clock::now();
+        std::thread sender(send);
+        receive(fd, result, parse ? &nmea : nullptr);
+        sender.join();
+        // The timeout at the end is not part of the work
+        const double seconds = std::chrono::duration<double>(Clock::now() - start).count() - 0.1;
+
+        ::close(fd);
+
+        std::cout << std::fixed << std::setprecision(0)
+            << name << (parse ? "parse:  " : "count:  ") << std::setw(9) << result.lines / seconds << " datagrams/s, "
+            << result.lines << " of " << datagrams << " received, "
+            << std::setprecision(3)
+            << static_cast<double>(result.systemCalls) / (result.lines ? result.lines : 1) << " system calls per datagram, "
+            << result.stamped << " time stamped";
+        if (parse)
+            std::cout << ", " << result.valid << " valid";
+        std::cout << std::endl;
+    }
+}
+
+void udpReceiverBenchmark()
+{
+    for (bool parse : { false, true })
+    {
+        run("recvfrom, ", receiveNaive, parse);
+        run("recvmmsg, ", receiveBatched, parse);
+    }
+}
+
+#else
+
+void udpReceiverBenchmark()
+{
+    std::cout << "The UdpReceiver is only available on Linux" << std::endl;
+}
+
+#endif
@@ -0,0 +1,130 @@
+// ValidationBenchmark.cpp : The parse rate of a synthetic corpus at each validation level, and the lines each level lets through.
+//
+
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <Nmea/CorpusGenerator.h>
+#include <Nmea/LineFramer.h>
+#include <Nmea/Nmea.h>
+#include <Nmea/Validation.h>
+
+#include "Benchmarks.h"
+#include "Results.h"
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    const uint64_t seed = 20240611;
+    const size_t corpusBytes = 8 << 20;
+    const double errorRate = 0.02;
+    const int repeats = 3;
+
+    const Validation levels[] = { Validation::framing, Validation::checksum, Validation::general, Validation::full };
+
+    struct Measurement
+    {
+        double   linesPerSecond = 0;
+        uint64_t lines = 0;
+        uint64_t accepted = 0;   // Lines without error at the level
+    };
+
+    // Appends the checksum field and CR LF to a sentence, a wrong checksum has both digits wrong
+    std::string withChecksum(std::string sentence, bool correct)
+    {
+        unsigned char sum = 0;
+        for (size_t i = 1; i < sentence.size(); ++i)
+            sum ^= static_cast<unsigned char>(sentence[i]);
+
+        char field[6];
+        std::snprintf(field, sizeof(field), "*%02X\r\n", correct ? sum : sum ^ 0xFF);
+        return sentence + field;
+    }
+
+    // The error of a line parsed at a level, and whether the parser reports that level
+    ErrorCode parseAt(const std::string& line, Validation level)
+    {
+        ValidationLevels table(level);
+        Nmea nmea;
+        nmea.setValidation(&table);
+        nmea.parse(line);
+        if (nmea.validated() != level)
+            Results::fail("validation: validated() is " + std::string(ValidationLevels::name(nmea.validated())) + " at " + ValidationLevels::name(level));
+        return nmea.errorCode();
+    }
+
+    // Each level checks what it promises, and leaves the rest to the levels above
+    void checkLevels()
+    {
+        const std::string wrongChecksum = withChecksum("$GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,", false);
+        const std::string wrongLatitude = withChecksum("$GPGGA,123519,48X7.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,", true);
+
+        if (parseAt(wrongChecksum, Validation::framing) != ErrorCode::E000)
+            Results::fail("validation: framing rejects a line with a wrong checksum");
+        if (parseAt(wrongChecksum, Validation::checksum) == ErrorCode::E000)
+            Results::fail("validation: checksum accepts a line with a wrong checksum");
+        if (parseAt(wrongLatitude, Validation::general) != ErrorCode::E000)
+            Results::fail("validation: general rejects a line with an error in its specific contents");
+        if (parseAt(wrongLatitude, Validation::full) == ErrorCode::E000)
+            Results::fail("validation: full accepts a line with an error in its specific contents");
+    }
+
+    // The best of a few runs, the corpus is too short for one run to be steady
+    Measurement measure(const std::string& corpus, Validation level)
+    {
+        ValidationLevels table(level);
+        Nmea nmea;
+        nmea.setValidation(&table);
+
+        Measurement best;
+        for (int repeat = 0; repeat < repeats; ++repeat)
+        {
+            Measurement measurement;
+            const auto start = Clock::now();
+            LineFramer::split(corpus, [&](std::string_view line) {
+                nmea.parse(line);
+                ++measurement.lines;
+                if (nmea.errorCode() == ErrorCode::E000)
+                    ++measurement.accepted;
+            });
+            measurement.linesPerSecond = measurement.lines / std::chrono::duration<double>(Clock::now() - start).count();
+
+            if (measurement.linesPerSecond > best.linesPerSecond)
+                best = measurement;
+        }
+
+        return best;
+    }
+}
+
+void validationBenchmark()
+{
+    checkLevels();
+
+    std::string corpus;
+    CorpusGenerator(seed, errorRate).fill(corpus, corpusBytes);
+
+    Measurement results[std::size(levels)];
+    for (size_t i = 0; i < std::size(levels); ++i)
+        results[i] = measure(corpus, levels[i]);
+
+    const double full = results[std::size(levels) - 1].linesPerSecond;
+    std::cout << results[0].lines << " lines, " << errorRate * 100 << " % with an error" << std::endl;
+    std::cout << "  level         lines/s  vs full   accepted" << std::endl;
+    for (size_t i = 0; i < std::size(levels); ++i)
+    {
+        const auto& result = results[i];
+        const std::string name = ValidationLevels::name(levels[i]);
+        std::cout << "  " << std::left << std::setw(10) << name << std::right << std::fixed << std::setprecision(0)
+            << std::setw(11) << result.linesPerSecond << std::setprecision(2) << std::setw(8) << result.linesPerSecond / full << "x"
+            << std::setw(11) << result.accepted << std::endl;
+
+        Results::record("validation/" + name + "/rate", "lines/s", result.linesPerSecond);
+        Results::record("validation/" + name + "/speedup", "x", result.linesPerSecond / full);
+    }
+}
@@ -0,0 +1,182 @@
+﻿#include "AdaptiveValidation.h"
+
+#include <chrono>
+#include <new>
+
+namespace
+{
+    void add(std::atomic<uint64_t>& counter, uint64_t value) noexcept
+    {
+        counter.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    double mean(uint64_t total, uint64_t count) noexcept
+    {
+        return count == 0 ? 0.0 : static_cast<double>(total) / count;
+    }
+}
+
+struct AdaptiveValidation::State
+{
+    std::atomic<bool>     trusted{ false };
+    std::atomic<uint64_t> clean{ 0 };
+    std::atomic<uint64_t> sequence{ 0 };    ///< Lines of the source since it is trusted, to pick the sample
+    std::atomic<uint64_t> fullLines{ 0 };
+    std::atomic<uint64_t> fullNs{ 0 };
+    std::atomic<uint64_t> reducedLines{ 0 };
+    std::atomic<uint64_t> reducedNs{ 0 };
+    std::atomic<uint64_t> errors{ 0 };
+    std::atomic<uint64_t> demotions{ 0 };
+};
+
+struct AdaptiveValidation::Page
+{
+    std::atomic<State*> states[pageSize] = {};
+
+    ~Page()
+    {
+        for (auto& state : states)
+            delete state.load(std::memory_order_relaxed);
+    }
+};
+
+AdaptiveValidation::AdaptiveValidation() :
+    AdaptiveValidation(Options())
+{
+}
+
+AdaptiveValidation::AdaptiveValidation(const Options& options) :
+    m_Options(options),
+    m_Pages(std::make_unique<std::atomic<Page*>[]>(pages))
+{
+    if (m_Options.sampleInterval == 0)
+        m_Options.sampleInterval = 1;
+}
+
+AdaptiveValidation::~AdaptiveValidation()
+{
+    for (size_t page = 0; page < pages; ++page)
+        delete m_Pages[page].load(std::memory_order_relaxed);
+}
+
+AdaptiveValidation::State* AdaptiveValidation::state(SourceId source) noexcept
+{
+    auto& page = m_Pages[source / pageSize];
+    Page* states = page.load(std::memory_order_acquire);
+    if (states == nullptr)
+    {
+        // Threads allocating the same page at once keep the first one
+        Page* created = new (std::nothrow) Page;
+        if (created == nullptr)
+            return nullptr;
+        if (page.compare_exchange_strong(states, created, std::memory_order_acq_rel))
+            states = created;
+        else
+            delete created;
+    }
+
+    auto& slot = states->states[source % pageSize];
+    State* state = slot.load(std::memory_order_acquire);
+    if (state == nullptr)
+    {
+        State* created = new (std::nothrow) State;
+        if (created == nullptr)
+            return nullptr;
+        if (slot.compare_exchange_strong(state, created, std::memory_order_acq_rel))
+            state = created;
+        else
+            delete created;
+    }
+
+    return state;
+}
+
+Validation AdaptiveValidation::level(SourceId source) noexcept
+{
+    State* state = this->state(source);
+    if (state == nullptr || !state->trusted.load(std::memory_order_relaxed))
+        return Validation::full;
+
+    const uint64_t sequence = state->sequence.load(std::memory_order_relaxed);
+    state->sequence.store(sequence + 1, std::memory_order_relaxed);
+    return sequence % m_Options.sampleInterval == 0 ? Validation::full : m_Options.trusted;
+}
+
+void AdaptiveValidation::record(SourceId source, Validation level, ErrorCode error, int64_t ns) noexcept
+{
+    State* state = this->state(source);
+    if (state == nullptr)
+        return;
+
+    const uint64_t elapsed = ns < 0 ? 0 : static_cast<uint64_t>(ns);
+    if (level == Validation::full)
+    {
+        add(state->fullLines, 1);
+        add(state->fullNs, elapsed);
+    }
+    else
+    {
+        add(state->reducedLines, 1);
+        add(state->reducedNs, elapsed);
+    }
+
+    if (error != ErrorCode::E000)
+    {
+        add(state->errors, 1);
+        state->clean.store(0, std::memory_order_relaxed);
+        if (state->trusted.exchange(false, std::memory_order_relaxed))
+            add(state->demotions, 1);
+        return;
+    }
+
+    if (level != Validation::full)
+        return;
+
+    const uint64_t clean = state->clean.load(std::memory_order_relaxed) + 1;
+    state->clean.store(clean, std::memory_order_relaxed);
+    if (clean >= m_Options.cleanLines && !state->trusted.load(std::memory_order_relaxed))
+    {
+        // The first line of the trusted source is sampled
+        state->sequence.store(0, std::memory_order_relaxed);
+        state->trusted.store(true, std::memory_order_relaxed);
+    }
+}
+
+std::vector<AdaptiveValidation::Entry> AdaptiveValidation::snapshot() const
+{
+    std::vector<Entry> entries;
+    for (size_t page = 0; page < pages; ++page)
+    {
+        const Page* states = m_Pages[page].load(std::memory_order_acquire);
+        if (states == nullptr)
+            continue;
+
+        for (size_t i = 0; i < pageSize; ++i)
+        {
+            const State* state = states->states[i].load(std::memory_order_acquire);
+            if (state == nullptr)
+                continue;
+
+            Entry entry{};
+            entry.source = static_cast<SourceId>(page * pageSize + i);
+            entry.trusted = state->trusted.load(std::memory_order_relaxed);
+            entry.clean = state->clean.load(std::memory_order_relaxed);
+            entry.fullLines = state->fullLines.load(std::memory_order_relaxed);
+            entry.reducedLines = state->reducedLines.load(std::memory_order_relaxed);
+            entry.errors = state->errors.load(std::memory_order_relaxed);
+            entry.demotions = state->demotions.load(std::memory_order_relaxed);
+            entry.fullNs = mean(state->fullNs.load(std::memory_order_relaxed), entry.fullLines);
+            entry.reducedNs = mean(state->reducedNs.load(std::memory_order_relaxed), entry.reducedLines);
+            if (entry.fullLines != 0 && entry.fullNs > entry.reducedNs)
+                entry.savedNs = (entry.fullNs - entry.reducedNs) * entry.reducedLines;
+            entries.push_back(entry);
+        }
+    }
+
+    return entries;
+}
+
+int64_t AdaptiveValidation::now() noexcept
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
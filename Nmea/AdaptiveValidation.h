@@ -0,0 +1,99 @@
+﻿#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "ErrorCodes.h"
+#include "SourceInterner.h"
+#include "Validation.h"
+
+/// <summary>
+///        Validates the lines of clean sources less, and a sample of them fully.
+/// </summary>
+/// A source starts validated fully. After a number of clean lines in a row it is trusted: its lines are checked to
+/// a lower level, e.g. framing and checksum, and one line in a sample interval is still validated fully. The first
+/// line in error, at any level, makes the source validated fully again until it has been clean as long again.
+/// Each parse is timed, so the counters of a source tell the CPU time saved by trusting it.
+/// A source is best parsed by one thread at a time: the counters stay exact otherwise, but the clean lines in a row
+/// and the sample may be counted a little off.
+/// \code{.cpp}
+///     AdaptiveValidation adaptive;
+///     Nmea nmea;
+///     nmea.setAdaptiveValidation(&adaptive);
+/// \endcode
+class AdaptiveValidation
+{
+public:
+    struct Options
+    {
+        uint64_t   cleanLines = 10000;             ///< The clean lines in a row validated fully before trusting a source
+        uint64_t   sampleInterval = 100;           ///< One line in this many of a trusted source is validated fully
+        Validation trusted = Validation::checksum; ///< The level of the other lines of a trusted source
+    };
+
+    /// <summary>
+    ///        The counters of a source.
+    /// </summary>
+    struct Entry
+    {
+        SourceId source;
+        bool     trusted;       ///< Validated at Options::trusted now, else fully
+        uint64_t clean;         ///< Clean lines in a row validated fully
+        uint64_t fullLines;     ///< Lines validated fully, before trusting the source and sampled
+        uint64_t reducedLines;  ///< Lines validated at Options::trusted
+        uint64_t errors;        ///< Lines in error
+        uint64_t demotions;     ///< The times an error ended trusting the source
+        double   fullNs;        ///< The mean time of parsing a line validated fully
+        double   reducedNs;     ///< The mean time of parsing a line validated at Options::trusted
+        double   savedNs;       ///< The time saved by not validating the reduced lines fully
+    };
+
+    /// <summary>
+    ///        Trusts a source after 10000 clean lines, then validates 1 % of its lines fully and the others to
+    ///        their checksum.
+    /// </summary>
+    AdaptiveValidation();
+
+    explicit AdaptiveValidation(const Options& options);
+    ~AdaptiveValidation();
+
+    AdaptiveValidation(const AdaptiveValidation&) = delete;
+    AdaptiveValidation& operator=(const AdaptiveValidation&) = delete;
+
+    /// <summary>
+    ///        The level to validate the next line of a source to.
+    /// </summary>
+    Validation level(SourceId source) noexcept;
+
+    /// <summary>
+    ///        Counts a line parsed, and trusts or stops trusting its source.
+    /// </summary>
+    /// \param level [in] The level given by level(source).
+    /// \param ns [in] The time parsing took.
+    void record(SourceId source, Validation level, ErrorCode error, int64_t ns) noexcept;
+
+    /// <summary>
+    ///        The counters of the sources seen.
+    /// </summary>
+    /// \return An entry per source, sorted by source
+    std::vector<Entry> snapshot() const;
+
+    /// A steady time in nanoseconds, to time parsing
+    static int64_t now() noexcept;
+
+private:
+    struct State;
+    struct Page;
+
+    static const size_t pageSize = 256;
+    static const size_t pages = (size_t(std::numeric_limits<SourceId>::max()) + 1) / pageSize;
+
+    // The state of a source, nullptr if it can't be allocated
+    State* state(SourceId source) noexcept;
+
+    Options                               m_Options;
+    std::unique_ptr<std::atomic<Page*>[]> m_Pages;
+};
@@ -0,0 +1,135 @@
+﻿#include "AisPosition.h"
+
+#include <cmath>
+#include <limits>
+
+#include "TraceRecorder.h"
+
+namespace
+{
+    // Returns the unsigned value of the bits [start, start + length) of the payload.
+    // The caller has checked that the payload is long enough.
+    uint32_t bits(std::string_view payload, size_t start, size_t length) noexcept
+    {
+        uint32_t value = 0;
+
+        for (size_t i = start; i < start + length; ++i)
+        {
+            const uint8_t sixBits = Ais::sixBitValue(payload[i / 6]);
+            value = (value << 1) | ((sixBits >> (5 - i % 6)) & 1);
+        }
+
+        return value;
+    }
+
+    // Returns the two's complement value of the bits [start, start + length) of the payload.
+    int32_t signedBits(std::string_view payload, size_t start, size_t length) noexcept
+    {
+        const uint32_t value = bits(payload, start, length);
+        const uint32_t signBit = 1u << (length - 1);
+
+        return static_cast<int32_t>(value ^ signBit) - static_cast<int32_t>(signBit);
+    }
+
+    // Bit positions of the fields common to the position reports, ref. ITU-R M.1371
+    struct Layout
+    {
+        size_t speedOverGround;
+        size_t longitude;
+        size_t latitude;
+        size_t courseOverGround;
+        size_t trueHeading;
+    };
+
+    const Layout classA{ 50, 61, 89, 116, 128 }; // Message 1, 2 and 3
+    const Layout classB{ 46, 57, 85, 112, 124 }; // Message 18 and 19
+
+    const int32_t longitudeNotAvailable = 181 * 600000;
+    const int32_t latitudeNotAvailable = 91 * 600000;
+
+    std::optional<Ais::PositionReport> decode(std::string_view payload, unsigned fillBits)
+    {
+        const size_t numberOfBits = payload.size() * 6 - fillBits;
+
+        if (payload.size() * 6 < fillBits || numberOfBits < 38)
+            return {};
+
+        Ais::PositionReport report;
+        report.messageId = static_cast<uint8_t>(bits(payload, 0, 6));
+        report.mmsi = bits(payload, 8, 30);
+
+        const Layout* layout = nullptr;
+        switch (report.messageId)
+        {
+        case 1:
+        case 2:
+        case 3:
+            layout = &classA;
+            break;
+        case 18:
+        case 19:
+            layout = &classB;
+            break;
+        default:
+            return {};
+        }
+
+        if (numberOfBits < layout->trueHeading + 9)
+            return {};
+
+        const int32_t longitude = signedBits(payload, layout->longitude, 28);
+        const int32_t latitude = signedBits(payload, layout->latitude, 27);
+
+        if (longitude == longitudeNotAvailable || latitude == latitudeNotAvailable)
+            return {};
+
+        report.longitude = longitude / 600000.0;
+        report.latitude = latitude / 600000.0;
+
+        if (std::fabs(report.longitude) > 180.0 || std::fabs(report.latitude) > 90.0)
+            return {};
+
+        const uint32_t speedOverGround = bits(payload, layout->speedOverGround, 10);
+        report.speedOverGround = speedOverGround == 1023 ? std::numeric_limits<double>::quiet_NaN() : speedOverGround / 10.0;
+
+        const uint32_t courseOverGround = bits(payload, layout->courseOverGround, 12);
+        report.courseOverGround = courseOverGround >= 3600 ? std::numeric_limits<double>::quiet_NaN() : courseOverGround / 10.0;
+
+        report.trueHeading = static_cast<uint16_t>(bits(payload, layout->trueHeading, 9));
+
+        return report;
+    }
+}
+
+namespace Ais
+{
+    std::optional<PositionReport> decodePositionReport(std::string_view payload, unsigned fillBits)
+    {
+        // The sentence is not known, so the span has no formatter
+        TraceRecorder::Span span("decode");
+        return decode(payload, fillBits);
+    }
+
+    std::optional<PositionReport> decodePositionReport(const std::vector<std::string_view>& splitter)
+    {
+        // Header, 6 data fields and checksum
+        if (splitter.size() != 8)
+            return {};
+
+        const auto& headerField{ splitter[0] };
+        if (headerField.size() != 6 || headerField[0] != '!' || headerField[3] != 'V' || headerField[4] != 'D')
+            return {};
+
+        // Only single fragment messages carry a complete position report
+        if (splitter[1] != "1")
+            return {};
+
+        const auto& fillBitsField{ splitter[6] };
+        const unsigned fillBits = fillBitsField.size() == 1 ? static_cast<unsigned>(fillBitsField[0] - '0') : 0;
+
+        // VDM or VDO
+        TraceRecorder::Span span("decode");
+        span.setFormatter(headerField.substr(3));
+        return decode(splitter[5], fillBits);
+    }
+}
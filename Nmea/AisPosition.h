@@ -0,0 +1,54 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+namespace Ais
+{
+    /// <summary>
+    ///        The position part of an AIS position report (message 1, 2, 3, 18 and 19).
+    /// </summary>
+    struct PositionReport
+    {
+        uint8_t  messageId;
+        uint32_t mmsi;
+        double   latitude;          ///< Degrees, north is positive
+        double   longitude;         ///< Degrees, east is positive
+        double   speedOverGround;   ///< Knots, NaN if not available
+        double   courseOverGround;  ///< Degrees, NaN if not available
+        uint16_t trueHeading;       ///< Degrees, 511 if not available
+    };
+
+    /// <summary>
+    ///        Converts a character in the six-bit binary representation to its six bit value.
+    /// </summary>
+    ///    NMEA 0183 Version 4.00, 6.2.4 defines the six-bit binary representation.
+    /// \param ch [in] The character to be converted.
+    /// \pre \code{.cpp} NmeaFunctions::issixbit(ch) \endcode
+    /// \return A value in the range 0 .. 63
+    inline
+    uint8_t sixBitValue(const char ch) noexcept
+    {
+        const uint8_t value = static_cast<uint8_t>(ch - 48);
+        return value > 40 ? value - 8 : value;
+    }
+
+    /// <summary>
+    ///        Decodes the position part of a single fragment AIS message.
+    /// </summary>
+    /// \param payload [in] The encapsulated six-bit payload of a VDM or VDO sentence.
+    /// \param fillBits [in] The number of fill bits at the end of the payload.
+    /// \return The position report, or an empty optional if the payload is not a position report
+    ///         or the position is not available.
+    std::optional<PositionReport> decodePositionReport(std::string_view payload, unsigned fillBits = 0);
+
+    /// <summary>
+    ///        Decodes the position part of a parsed VDM or VDO sentence.
+    /// </summary>
+    /// \param splitter [in] The fields of the sentence, see Nmea::sentenceFields().
+    /// \return The position report, or an empty optional if the sentence is not a single fragment
+    ///         position report.
+    std::optional<PositionReport> decodePositionReport(const std::vector<std::string_view>& splitter);
+}
@@ -0,0 +1,562 @@
+﻿#include "Capture.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <system_error>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "AisPosition.h"
+#include "Nmea.h"
+
+namespace
+{
+    const char fileMagic[8] = "NMEACAP";
+    const char trailerMagic[8] = "NMEAIDX";
+
+    [[noreturn]] void throwSystemError(const char* what)
+    {
+        throw std::system_error(errno, std::generic_category(), what);
+    }
+
+    size_t padded(size_t size)
+    {
+        return (size + 7) & ~static_cast<size_t>(7);
+    }
+
+    void appendVarint(std::vector<char>& buffer, uint64_t value)
+    {
+        for (; value >= 0x80; value >>= 7)
+            buffer.push_back(static_cast<char>(value | 0x80));
+        buffer.push_back(static_cast<char>(value));
+    }
+
+    // false if the varint doesn't end before the end, or has more than 64 bits
+    bool readVarint(const char*& at, const char* end, uint64_t& value)
+    {
+        value = 0;
+        for (unsigned shift = 0; at != end && shift < 64; shift += 7)
+        {
+            const auto byte = static_cast<unsigned char>(*at++);
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if (byte < 0x80)
+                return true;
+        }
+        return false;
+    }
+
+    // A signed difference in the low bit, so small differences of either sign have short varints
+    uint64_t zigzag(int64_t value)
+    {
+        return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+    }
+
+    int64_t unzigzag(uint64_t value)
+    {
+        return static_cast<int64_t>((value >> 1) ^ (~(value & 1) + 1));
+    }
+
+    // The end of each field in one byte, if the fields follow each other as Record::fieldStart expects
+    bool compactEnds(std::string_view line, const std::vector<std::string_view>& fields, uint8_t& headerOffset, uint8_t* ends)
+    {
+        if (line.size() > Capture::RecordHeader::maxCompactLength || fields.empty() || fields[0].empty() ||
+            fields[0].data() < line.data() || fields[0].data() >= line.data() + line.size())
+            return false;
+
+        headerOffset = static_cast<uint8_t>(fields[0].data() - line.data());
+        size_t start = headerOffset;
+        for (size_t i = 0; i < fields.size(); ++i)
+        {
+            if (i > 0)
+                start = ends[i - 1] < line.size() && line[ends[i - 1]] == ',' ? ends[i - 1] + 1 : ends[i - 1];
+            if (!fields[i].empty() && fields[i].data() != line.data() + start)
+                return false;
+
+            const size_t end = start + fields[i].size();
+            if (end > line.size())
+                return false;
+            ends[i] = static_cast<uint8_t>(end);
+        }
+        return true;
+    }
+
+    uint32_t formatterCode(std::string_view formatter)
+    {
+        return static_cast<uint32_t>(static_cast<unsigned char>(formatter[0])) << 16 |
+            static_cast<uint32_t>(static_cast<unsigned char>(formatter[1])) << 8 |
+            static_cast<unsigned char>(formatter[2]);
+    }
+
+    // The formatter is the last three characters of the address field, e.g. GGA of $GPGGA
+    std::string_view formatter(std::string_view header)
+    {
+        return header.size() >= 4 ? header.substr(header.size() - 3) : std::string_view();
+    }
+
+    // The MMSI of the first fragment of a VDM or VDO sentence, bits 8 .. 37 of the payload, or 0
+    uint32_t mmsi(const std::vector<std::string_view>& fields)
+    {
+        if (fields.size() != 8)
+            return 0;
+
+        const auto code = formatter(fields[0]);
+        if ((code != "VDM" && code != "VDO") || fields[2] != "1" || fields[5].size() < 7)
+            return 0;
+
+        uint64_t bits = 0;
+        for (size_t i = 0; i < 7; ++i)
+            bits = bits << 6 | Ais::sixBitValue(fields[5][i]);
+
+        // 42 bits read, the MMSI is the 30 bits after the first 8
+        return static_cast<uint32_t>((bits >> 4) & 0x3FFFFFFF);
+    }
+
+    Capture::ChunkFooter emptyFooter(uint64_t offset)
+    {
+        Capture::ChunkFooter footer{};
+        footer.recordsOffset = offset;
+        footer.firstTime = std::numeric_limits<int64_t>::max();
+        footer.lastTime = std::numeric_limits<int64_t>::min();
+        footer.minMmsi = std::numeric_limits<uint32_t>::max();
+        return footer;
+    }
+}
+
+namespace Capture
+{
+    Writer::Writer(const std::string& path, size_t chunkRecords) :
+        m_File(std::fopen(path.c_str(), "wb")),
+        m_ChunkRecords(chunkRecords == 0 ? 1 : chunkRecords),
+        m_Chunk(),
+        m_LastTime(0),
+        m_Footer(),
+        m_Offset(sizeof(FileHeader)),
+        m_Directory(),
+        m_Records(0),
+        m_Named(),
+        m_Sources()
+    {
+        if (m_File == nullptr)
+            throwSystemError("fopen");
+
+        FileHeader header{};
+        std::memcpy(header.magic, fileMagic, sizeof(header.magic));
+        header.version = version;
+        if (std::fwrite(&header, sizeof(header), 1, m_File) != 1)
+            throwSystemError("fwrite");
+
+        m_Footer = emptyFooter(m_Offset);
+    }
+
+    Writer::~Writer()
+    {
+        try
+        {
+            close();
+        }
+        catch (const std::exception&)
+        {
+            // A destructor shall not throw, call close() to see the error
+        }
+    }
+
+    bool Writer::write(std::string_view line, const Nmea& nmea)
+    {
+        const auto& fields = nmea.sentenceFields();
+        if (nmea.errorCode() != ErrorCode::E000 || line.size() > 0xFFFF || fields.size() > 0xFF)
+            return false;
+
+        const int64_t receiveTime = nmea.origin().receiveTime;
+        const SourceId source = nmea.origin().source;
+        const size_t start = m_Chunk.size();
+
+        appendVarint(m_Chunk, zigzag(static_cast<int64_t>(static_cast<uint64_t>(receiveTime) - static_cast<uint64_t>(m_LastTime))));
+        appendVarint(m_Chunk, source);
+        appendVarint(m_Chunk, line.size());
+        m_Chunk.push_back(static_cast<char>(fields.size()));
+
+        uint8_t headerOffset;
+        uint8_t ends[0xFF];
+        if (compactEnds(line, fields, headerOffset, ends))
+        {
+            m_Chunk.push_back(static_cast<char>(headerOffset));
+            m_Chunk.insert(m_Chunk.end(), ends, ends + fields.size());
+        }
+        else
+        {
+            m_Chunk.push_back(static_cast<char>(RecordHeader::wideSpans));
+            for (const auto field : fields)
+            {
+                // Empty fields have no characters, and are given the position 0
+                FieldSpan span{};
+                if (!field.empty())
+                {
+                    if (field.data() < line.data() || field.data() + field.size() > line.data() + line.size())
+                    {
+                        m_Chunk.resize(start);
+                        return false;
+                    }
+                    span.offset = static_cast<uint16_t>(field.data() - line.data());
+                    span.length = static_cast<uint16_t>(field.size());
+                }
+                const auto bytes = reinterpret_cast<const char*>(&span);
+                m_Chunk.insert(m_Chunk.end(), bytes, bytes + sizeof(span));
+            }
+        }
+        m_Chunk.insert(m_Chunk.end(), line.begin(), line.end());
+        m_LastTime = receiveTime;
+
+        // The name of a source is kept the first time the source is written
+        if (source != noSource && (source >= m_Named.size() || !m_Named[source]))
+        {
+            const auto name = nmea.interner().name(source);
+            SourceName entry{};
+            entry.source = source;
+            entry.length = static_cast<uint8_t>(std::min(name.size(), sizeof(entry.name)));
+            std::memcpy(entry.name, name.data(), entry.length);
+            m_Sources.push_back(entry);
+
+            m_Named.resize(std::max<size_t>(m_Named.size(), size_t(source) + 1));
+            m_Named[source] = true;
+        }
+
+        // Index the record
+        ++m_Footer.records;
+        m_Footer.firstTime = std::min(m_Footer.firstTime, receiveTime);
+        m_Footer.lastTime = std::max(m_Footer.lastTime, receiveTime);
+
+        if (!fields.empty())
+        {
+            const auto code = formatter(fields[0]);
+            if (!code.empty())
+            {
+                const uint32_t value = formatterCode(code);
+                const auto end = m_Footer.formatters + std::min<size_t>(m_Footer.formatterCount, maxFormatters);
+                if (std::find(m_Footer.formatters, end, value) == end)
+                {
+                    if (m_Footer.formatterCount < maxFormatters)
+                        m_Footer.formatters[m_Footer.formatterCount++] = value;
+                    else
+                        m_Footer.formatterCount = maxFormatters + 1;
+                }
+            }
+
+            const uint32_t id = mmsi(fields);
+            if (id != 0)
+            {
+                m_Footer.minMmsi = std::min(m_Footer.minMmsi, id);
+                m_Footer.maxMmsi = std::max(m_Footer.maxMmsi, id);
+            }
+        }
+
+        ++m_Records;
+        if (m_Footer.records == m_ChunkRecords)
+            flushChunk();
+
+        return true;
+    }
+
+    void Writer::close()
+    {
+        if (m_File == nullptr)
+            return;
+
+        flushChunk();
+
+        FileTrailer trailer{};
+        trailer.directoryOffset = m_Offset;
+        trailer.chunkCount = m_Directory.size();
+        trailer.sourcesOffset = m_Offset + m_Directory.size() * sizeof(uint64_t);
+        trailer.sourceCount = m_Sources.size();
+        std::memcpy(trailer.magic, trailerMagic, sizeof(trailer.magic));
+
+        const bool written =
+            std::fwrite(m_Directory.data(), sizeof(uint64_t), m_Directory.size(), m_File) == m_Directory.size() &&
+            std::fwrite(m_Sources.data(), sizeof(SourceName), m_Sources.size(), m_File) == m_Sources.size() &&
+            std::fwrite(&trailer, sizeof(trailer), 1, m_File) == 1;
+
+        const bool closed = std::fclose(m_File) == 0;
+        m_File = nullptr;
+
+        if (!written || !closed)
+            throwSystemError("fwrite");
+    }
+
+    void Writer::flushChunk()
+    {
+        if (m_Footer.records == 0)
+            return;
+
+        if (m_Footer.minMmsi > m_Footer.maxMmsi)
+            m_Footer.minMmsi = m_Footer.maxMmsi = 0;
+
+        // The footer is aligned in the mapping of a reader
+        m_Footer.recordsEnd = m_Offset + m_Chunk.size();
+        m_Chunk.resize(padded(m_Chunk.size()));
+
+        if (std::fwrite(m_Chunk.data(), 1, m_Chunk.size(), m_File) != m_Chunk.size() ||
+            std::fwrite(&m_Footer, sizeof(m_Footer), 1, m_File) != 1)
+            throwSystemError("fwrite");
+
+        m_Offset += m_Chunk.size();
+        m_Directory.push_back(m_Offset);
+        m_Offset += sizeof(m_Footer);
+
+        m_Chunk.clear();
+        m_LastTime = 0;
+        m_Footer = emptyFooter(m_Offset);
+    }
+
+#if defined(_WIN32)
+
+    struct Reader::Mapping
+    {
+        explicit Mapping(const std::string& path) : file(INVALID_HANDLE_VALUE), mapping(nullptr), data(nullptr), size(0)
+        {
+            file = ::CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+            LARGE_INTEGER length{};
+            if (file == INVALID_HANDLE_VALUE || !::GetFileSizeEx(file, &length))
+                throw std::system_error(static_cast<int>(::GetLastError()), std::system_category(), "CreateFile");
+
+            size = static_cast<uint64_t>(length.QuadPart);
+            if (size == 0)
+                return;
+
+            mapping = ::CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (mapping != nullptr)
+                data = static_cast<const char*>(::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+            if (data == nullptr)
+            {
+                const int error = static_cast<int>(::GetLastError());
+                close();
+                throw std::system_error(error, std::system_category(), "MapViewOfFile");
+            }
+        }
+
+        ~Mapping() { close(); }
+
+        void close()
+        {
+            if (data != nullptr)
+                ::UnmapViewOfFile(data);
+            if (mapping != nullptr)
+                ::CloseHandle(mapping);
+            if (file != INVALID_HANDLE_VALUE)
+                ::CloseHandle(file);
+        }
+
+        HANDLE      file;
+        HANDLE      mapping;
+        const char* data;
+        uint64_t    size;
+    };
+
+#else
+
+    struct Reader::Mapping
+    {
+        explicit Mapping(const std::string& path) : data(nullptr), size(0)
+        {
+            const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0)
+                throwSystemError("open");
+
+            struct stat status{};
+            if (::fstat(fd, &status) < 0)
+            {
+                const int error = errno;
+                ::close(fd);
+                errno = error;
+                throwSystemError("fstat");
+            }
+
+            size = static_cast<uint64_t>(status.st_size);
+            if (size > 0)
+            {
+                void* memory = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+                if (memory == MAP_FAILED)
+                {
+                    const int error = errno;
+                    ::close(fd);
+                    errno = error;
+                    throwSystemError("mmap");
+                }
+                data = static_cast<const char*>(memory);
+            }
+
+            // The mapping keeps the file
+            ::close(fd);
+        }
+
+        ~Mapping()
+        {
+            if (data != nullptr)
+                ::munmap(const_cast<char*>(data), size);
+        }
+
+        const char* data;
+        uint64_t    size;
+    };
+
+#endif
+
+    Reader::Reader(const std::string& path, SourceInterner& interner) :
+        m_Mapping(std::make_unique<Mapping>(path)),
+        m_Data(m_Mapping->data),
+        m_Size(m_Mapping->size),
+        m_Footers(),
+        m_LatestTimes(),
+        m_Sources()
+    {
+        const auto invalid = [] { return std::runtime_error("Not a capture file"); };
+
+        if (m_Size < sizeof(FileHeader) + sizeof(FileTrailer))
+            throw invalid();
+
+        FileHeader header;
+        std::memcpy(&header, m_Data, sizeof(header));
+        if (std::memcmp(header.magic, fileMagic, sizeof(header.magic)) != 0 || header.version != version)
+            throw invalid();
+
+        FileTrailer trailer;
+        std::memcpy(&trailer, m_Data + m_Size - sizeof(trailer), sizeof(trailer));
+        if (std::memcmp(trailer.magic, trailerMagic, sizeof(trailer.magic)) != 0 ||
+            trailer.directoryOffset + trailer.chunkCount * sizeof(uint64_t) != trailer.sourcesOffset ||
+            trailer.sourcesOffset + trailer.sourceCount * sizeof(SourceName) != m_Size - sizeof(trailer))
+            throw invalid();
+
+        // The sources of the writer are interned again, a name that can't be interned is read as noSource
+        for (uint64_t i = 0; i < trailer.sourceCount; ++i)
+        {
+            SourceName entry;
+            std::memcpy(&entry, m_Data + trailer.sourcesOffset + i * sizeof(entry), sizeof(entry));
+            if (entry.length > sizeof(entry.name))
+                throw invalid();
+
+            if (entry.source >= m_Sources.size())
+                m_Sources.resize(size_t(entry.source) + 1, noSource);
+            m_Sources[entry.source] = interner.intern(std::string_view(entry.name, entry.length));
+        }
+
+        int64_t latest = std::numeric_limits<int64_t>::min();
+        for (uint64_t i = 0; i < trailer.chunkCount; ++i)
+        {
+            uint64_t offset;
+            std::memcpy(&offset, m_Data + trailer.directoryOffset + i * sizeof(uint64_t), sizeof(offset));
+            if (offset % 8 != 0 || offset + sizeof(ChunkFooter) > trailer.directoryOffset)
+                throw invalid();
+
+            // The footers are 8 byte aligned in the mapping
+            const auto footer = reinterpret_cast<const ChunkFooter*>(m_Data + offset);
+            if (footer->recordsOffset > footer->recordsEnd || footer->recordsEnd > offset)
+                throw invalid();
+
+            latest = std::max(latest, footer->lastTime);
+            m_Footers.push_back(footer);
+            m_LatestTimes.push_back(latest);
+        }
+    }
+
+    Reader::~Reader()
+    {
+    }
+
+    bool Reader::mayContain(const ChunkFooter& footer, std::string_view formatter)
+    {
+        if (footer.formatterCount > maxFormatters)
+            return true;
+        if (formatter.size() != 3)
+            return false;
+
+        const uint32_t value = formatterCode(formatter);
+        return std::find(footer.formatters, footer.formatters + footer.formatterCount, value) != footer.formatters + footer.formatterCount;
+    }
+
+    Reader::Cursor Reader::begin() const
+    {
+        return Cursor{ 0, m_Footers.empty() ? 0 : m_Footers.front()->recordsOffset, 0 };
+    }
+
+    Reader::Cursor Reader::seek(int64_t time) const
+    {
+        // The first chunk with a record at or after the time
+        const size_t chunk = std::lower_bound(m_LatestTimes.begin(), m_LatestTimes.end(), time) - m_LatestTimes.begin();
+        if (chunk == m_Footers.size())
+            return Cursor{ chunk, 0, 0 };
+
+        Cursor cursor{ chunk, m_Footers[chunk]->recordsOffset, 0 };
+        for (Cursor at = cursor; at.chunk == chunk; cursor = at)
+        {
+            Record record;
+            if (!next(at, record) || record.receiveTime >= time)
+                break;
+        }
+
+        return cursor;
+    }
+
+    bool Reader::next(Cursor& cursor, Record& record) const
+    {
+        while (cursor.chunk < m_Footers.size())
+        {
+            const uint64_t end = m_Footers[cursor.chunk]->recordsEnd;
+            if (cursor.offset < end)
+            {
+                const auto corrupt = [] { return std::runtime_error("Corrupt capture record"); };
+
+                const char* at = m_Data + cursor.offset;
+                const char* const recordsEnd = m_Data + end;
+                uint64_t time;
+                uint64_t source;
+                uint64_t lineLength;
+                if (!readVarint(at, recordsEnd, time) || !readVarint(at, recordsEnd, source) ||
+                    !readVarint(at, recordsEnd, lineLength) || recordsEnd - at < 2)
+                    throw corrupt();
+
+                const auto fieldCount = static_cast<uint8_t>(at[0]);
+                const auto headerOffset = static_cast<uint8_t>(at[1]);
+                at += 2;
+
+                const bool wide = headerOffset == RecordHeader::wideSpans;
+                const uint64_t spansSize = fieldCount * (wide ? sizeof(FieldSpan) : 1);
+                if (static_cast<uint64_t>(recordsEnd - at) < spansSize + lineLength || lineLength > 0xFFFF)
+                    throw corrupt();
+
+                record.receiveTime = static_cast<int64_t>(static_cast<uint64_t>(cursor.time) + static_cast<uint64_t>(unzigzag(time)));
+                record.source = source < m_Sources.size() ? m_Sources[source] : noSource;
+                record.fieldCount = fieldCount;
+                record.headerOffset = headerOffset;
+                record.fields = reinterpret_cast<const uint8_t*>(at);
+                record.line = std::string_view(at + spansSize, lineLength);
+
+                // Each field shall be within the line
+                if (!wide)
+                {
+                    for (size_t i = 0; i < fieldCount; ++i)
+                        if (record.fieldStart(i) > record.fields[i] || record.fields[i] > lineLength)
+                            throw corrupt();
+                }
+
+                cursor.offset = record.line.data() + lineLength - m_Data;
+                cursor.time = record.receiveTime;
+                return true;
+            }
+
+            cursor.time = 0;
+            if (++cursor.chunk < m_Footers.size())
+                cursor.offset = m_Footers[cursor.chunk]->recordsOffset;
+        }
+
+        return false;
+    }
+}
@@ -0,0 +1,260 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "SourceInterner.h"
+
+class Nmea;
+
+/// <summary>
+///        A binary capture file of validated lines, read through a memory mapping.
+/// </summary>
+/// The file is a header, a sequence of chunks, a chunk directory and a source table. A chunk is a sequence of records
+/// followed by a footer indexing the chunk. Each record holds the receive time, the source, the line and the offsets
+/// of the sentence fields, so a replay needs neither the validation nor the field splitting of Nmea::parse.
+/// A record is variable length and unaligned, the receive time is the difference to the record before it in the chunk.
+/// A line of up to 255 characters whose fields follow each other keeps one byte per field, see RecordHeader.
+/// A SourceId is only meaningful to the process that interned it, so the source table holds the name of each source
+/// of the records, and the reader interns the names again.
+/// All values are stored in the byte order of the writer, which is little endian on all supported hosts.
+namespace Capture
+{
+    const uint32_t version = 3;
+
+    /// The maximum number of different formatters listed in a chunk footer
+    const size_t maxFormatters = 32;
+
+    struct FileHeader
+    {
+        char     magic[8];  // "NMEACAP\0"
+        uint32_t version;
+        uint32_t reserved;
+    };
+
+    /// <summary>
+    ///        A sentence field, relative to the start of the line.
+    /// </summary>
+    struct FieldSpan
+    {
+        uint16_t offset;
+        uint16_t length;
+    };
+
+    /// <summary>
+    ///        The layout of a record, which is not stored as a struct.
+    /// </summary>
+    /// A record is
+    ///  - the receive time less the receive time of the record before it in the chunk, or less 0 for the first record
+    ///    of a chunk, zigzag encoded in a varint of 7 bits per byte. The receive time is nanoseconds since
+    ///    1970-01-01 UTC, 0 if unknown;
+    ///  - the source and the line length in varints;
+    ///  - the field count and the header offset in one byte each;
+    ///  - the fields: if the header offset is wideSpans, a FieldSpan per field. Otherwise the offset of the end of each
+    ///    field in one byte. The first field starts at the header offset, the next field starts at the end of the one
+    ///    before it, after the ',' if there is one. So the checksum field starts at its '*';
+    ///  - the line.
+    /// The chunk is padded to a multiple of 8 bytes after its last record.
+    struct RecordHeader
+    {
+        /// The header offset of a record with a FieldSpan per field, a header can't start at the last offset of a line
+        static const uint8_t wideSpans = 0xFF;
+
+        /// The longest line whose fields may be stored in one byte each
+        static const size_t maxCompactLength = 0xFF;
+    };
+
+    struct ChunkFooter
+    {
+        uint64_t recordsOffset;  // The file offset of the first record of the chunk
+        uint32_t records;
+        uint32_t formatterCount; // maxFormatters + 1 if the chunk has more formatters than listed
+        int64_t  firstTime;      // The earliest receive time
+        int64_t  lastTime;       // The latest receive time
+        uint32_t minMmsi;        // The MMSI range of the AIS messages, 0 .. 0 if none
+        uint32_t maxMmsi;
+        uint32_t formatters[maxFormatters];  // The three characters of each formatter, e.g. GGA
+        uint64_t recordsEnd;     // The file offset after the last record, before the padding
+    };
+
+    /// <summary>
+    ///        The name of a source as interned by the writer.
+    /// </summary>
+    struct SourceName
+    {
+        SourceId source;
+        uint8_t  length;
+        char     name[SourceInterner::maxLength];
+    };
+
+    struct FileTrailer
+    {
+        uint64_t directoryOffset; // The file offset of the offsets of the chunk footers
+        uint64_t chunkCount;
+        uint64_t sourcesOffset;   // The file offset of the source table, after the directory
+        uint64_t sourceCount;
+        char     magic[8];        // "NMEAIDX\0"
+    };
+
+    /// <summary>
+    ///        Writes validated lines to a capture file.
+    /// </summary>
+    class Writer
+    {
+    public:
+        /// <summary>
+        ///        Creates the file.
+        /// </summary>
+        /// \param path [in] The file, overwritten if it exists.
+        /// \param chunkRecords [in] The number of records per chunk, which bounds the scan after a seek.
+        /// \exception std::system_error if the file can't be created
+        explicit Writer(const std::string& path, size_t chunkRecords = 1024);
+
+        /// <summary>
+        ///        Closes the file, see close().
+        /// </summary>
+        ~Writer();
+
+        Writer(const Writer&) = delete;
+        Writer& operator=(const Writer&) = delete;
+
+        /// <summary>
+        ///        Appends a line with the result of parsing it.
+        /// </summary>
+        /// \param line [in] The line given to the last call to nmea.parse.
+        /// \param nmea [in] The parser, with the receive time and source in its origin(). The name of the source is
+        ///        looked up in nmea.interner().
+        /// \return false if the line was not valid, and has not been written
+        /// \exception std::system_error if the file can't be written
+        bool write(std::string_view line, const Nmea& nmea);
+
+        /// <summary>
+        ///        Writes the last chunk, the chunk directory and the source table, and closes the file.
+        /// </summary>
+        void close();
+
+        /// The number of records written
+        uint64_t records() const { return m_Records; }
+
+    private:
+        void flushChunk();
+
+        std::FILE*              m_File;
+        size_t                  m_ChunkRecords;
+        std::vector<char>       m_Chunk;
+        int64_t                 m_LastTime; // The receive time of the last record of the chunk, 0 if none
+        ChunkFooter             m_Footer;
+        uint64_t                m_Offset;
+        std::vector<uint64_t>   m_Directory;
+        uint64_t                m_Records;
+        std::vector<bool>       m_Named;    // Per SourceId of the records, true if in m_Sources
+        std::vector<SourceName> m_Sources;
+    };
+
+    /// <summary>
+    ///        A record of a capture file, valid as long as the Reader.
+    /// </summary>
+    struct Record
+    {
+        int64_t          receiveTime;
+        SourceId         source;       // Interned in the table given to the Reader
+        std::string_view line;
+        size_t           fieldCount;
+        uint8_t          headerOffset; // RecordHeader::wideSpans if fields holds FieldSpans
+        const uint8_t*   fields;       // The field ends or the unaligned FieldSpans, see RecordHeader
+
+        /// The sentence field i, like Nmea::sentenceFields()[i]
+        std::string_view field(size_t i) const
+        {
+            if (headerOffset == RecordHeader::wideSpans)
+            {
+                FieldSpan span;
+                std::memcpy(&span, fields + i * sizeof(FieldSpan), sizeof(span));
+                return line.substr(span.offset, span.length);
+            }
+
+            const size_t start = fieldStart(i);
+            return line.substr(start, fields[i] - start);
+        }
+
+        /// The offset of the field i of a record with one byte per field
+        size_t fieldStart(size_t i) const
+        {
+            if (i == 0)
+                return headerOffset;
+            const size_t end = fields[i - 1];
+            return end < line.size() && line[end] == ',' ? end + 1 : end;
+        }
+    };
+
+    /// <summary>
+    ///        Reads a capture file through a memory mapping.
+    /// </summary>
+    class Reader
+    {
+    public:
+        /// <summary>
+        ///        A position in the file.
+        /// </summary>
+        struct Cursor
+        {
+            size_t   chunk;
+            uint64_t offset;   // The file offset of the next record
+            int64_t  time;     // The receive time of the record before it in the chunk, 0 if none
+        };
+
+        /// <summary>
+        ///        Maps the file, reads its chunk directory and interns the names of its sources.
+        /// </summary>
+        /// \param interner [in] The table the sources of the records are interned in.
+        /// \exception std::system_error if the file can't be mapped
+        /// \exception std::runtime_error if the file is not a capture file
+        explicit Reader(const std::string& path, SourceInterner& interner = SourceInterner::global());
+        ~Reader();
+
+        Reader(const Reader&) = delete;
+        Reader& operator=(const Reader&) = delete;
+
+        /// The number of chunks
+        size_t chunks() const { return m_Footers.size(); }
+
+        /// The index of a chunk
+        const ChunkFooter& chunk(size_t i) const { return *m_Footers[i]; }
+
+        /// <summary>
+        ///        true if the chunk may have sentences with the formatter, e.g. "VDM".
+        /// </summary>
+        static bool mayContain(const ChunkFooter& footer, std::string_view formatter);
+
+        /// The position of the first record
+        Cursor begin() const;
+
+        /// <summary>
+        ///        The position of the first record received at or after a time.
+        /// </summary>
+        /// The chunk is found by a binary search of the chunk index, only the records of that chunk are scanned.
+        /// Records are expected in receive order, a record received earlier than a record before it may be skipped.
+        Cursor seek(int64_t time) const;
+
+        /// <summary>
+        ///        Reads the record at the cursor and moves the cursor to the next record.
+        /// </summary>
+        /// \return false at the end of the file
+        bool next(Cursor& cursor, Record& record) const;
+
+    private:
+        struct Mapping;
+
+        std::unique_ptr<Mapping>        m_Mapping;
+        const char*                     m_Data;
+        uint64_t                        m_Size;
+        std::vector<const ChunkFooter*> m_Footers;
+        std::vector<int64_t>            m_LatestTimes;  // The latest receive time up to and including each chunk
+        std::vector<SourceId>           m_Sources;      // The SourceId of the reader per SourceId of the writer
+    };
+}
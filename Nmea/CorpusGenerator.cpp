@@ -0,0 +1,726 @@
+﻿#include "CorpusGenerator.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <system_error>
+
+namespace
+{
+    const size_t fleetSize = 1000;
+    const size_t writeChunk = 4 << 20;
+    const char hexDigits[] = "0123456789ABCDEF";
+
+    // Appends value with at least width digits, zero padded
+    void appendUnsigned(std::string& out, uint64_t value, size_t width = 1)
+    {
+        char digits[20];
+        size_t count = 0;
+        do
+        {
+            digits[count++] = static_cast<char>('0' + value % 10);
+            value /= 10;
+        } while (value != 0);
+
+        for (; width > count; --width)
+            out += '0';
+        while (count > 0)
+            out += digits[--count];
+    }
+
+    // Appends a non-negative value with a fixed number of decimals, the integer part zero padded to width digits
+    void appendFixed(std::string& out, double value, size_t width, size_t decimals)
+    {
+        uint64_t scale = 1;
+        for (size_t i = 0; i < decimals; ++i)
+            scale *= 10;
+
+        const uint64_t scaled = static_cast<uint64_t>(std::llround(std::max(0.0, value) * static_cast<double>(scale)));
+        appendUnsigned(out, scaled / scale, width);
+        if (decimals > 0)
+        {
+            out += '.';
+            appendUnsigned(out, scaled % scale, decimals);
+        }
+    }
+
+    // Appends ddmm.mmmm or dddmm.mmmm and the hemisphere
+    void appendAngle(std::string& out, double degrees, size_t width, char positive, char negative)
+    {
+        const double magnitude = std::fabs(degrees);
+        const double whole = std::floor(magnitude);
+        appendUnsigned(out, static_cast<uint64_t>(whole), width);
+        appendFixed(out, (magnitude - whole) * 60.0, 2, 4);
+        out += ',';
+        out += degrees < 0 ? negative : positive;
+    }
+
+    void appendTime(std::string& out, int64_t time)
+    {
+        const int64_t seconds = time % 86400;
+        appendUnsigned(out, static_cast<uint64_t>(seconds / 3600), 2);
+        appendUnsigned(out, static_cast<uint64_t>(seconds / 60 % 60), 2);
+        appendUnsigned(out, static_cast<uint64_t>(seconds % 60), 2);
+        out += ".00";
+    }
+
+    uint8_t checksumOf(const std::string& line, size_t begin, size_t end)
+    {
+        uint8_t sum = 0;
+        for (size_t i = begin; i < end; ++i)
+            sum ^= static_cast<uint8_t>(line[i]);
+        return sum;
+    }
+
+    // Appends "*hh" for the characters after the start character at begin
+    void appendChecksum(std::string& line, size_t begin)
+    {
+        const uint8_t sum = checksumOf(line, begin + 1, line.size());
+        line += '*';
+        line += hexDigits[sum >> 4];
+        line += hexDigits[sum & 0x0F];
+    }
+
+    // The position of the start character of the sentence, after the tag blocks
+    size_t sentenceStart(const std::string& line)
+    {
+        const size_t lastTagBlock = line.rfind('\\');
+        return line.find_first_of("$!", lastTagBlock == std::string::npos ? 0 : lastTagBlock);
+    }
+
+    // Recomputes the checksum of the sentence, or of the tag block starting at begin
+    void fixChecksum(std::string& line, size_t begin)
+    {
+        const size_t star = line.find('*', begin);
+        if (star == std::string::npos || star + 2 >= line.size())
+            return;
+
+        const uint8_t sum = checksumOf(line, begin + 1, star);
+        line[star + 1] = hexDigits[sum >> 4];
+        line[star + 2] = hexDigits[sum & 0x0F];
+    }
+
+    // The position and length of data field index of the sentence, the header field being 0
+    bool findField(const std::string& line, size_t index, size_t& position, size_t& length)
+    {
+        const size_t start = sentenceStart(line);
+        const size_t star = line.find('*', start);
+        if (start == std::string::npos || star == std::string::npos)
+            return false;
+
+        position = start;
+        for (size_t i = 0; i < index; ++i)
+        {
+            position = line.find(',', position);
+            if (position == std::string::npos || position > star)
+                return false;
+            ++position;
+        }
+
+        const size_t end = line.find_first_of(",*", position);
+        length = end - position;
+        return true;
+    }
+
+    void replaceField(std::string& line, size_t index, const char* text)
+    {
+        size_t position, length;
+        if (findField(line, index, position, length))
+        {
+            line.replace(position, length, text);
+            fixChecksum(line, sentenceStart(line));
+        }
+    }
+
+    // Replaces the first occurrence of what in the tag block, and corrects its checksum
+    void replaceInTagBlock(std::string& line, const char* what, const char* with)
+    {
+        const size_t end = line.find('*');
+        const size_t position = line.find(what);
+        if (line.empty() || line[0] != '\\' || position == std::string::npos || position > end)
+            return;
+
+        line.replace(position, std::char_traits<char>::length(what), with);
+        fixChecksum(line, 0);
+    }
+
+    // Packs bits into the six-bit binary representation
+    class SixBitWriter
+    {
+    public:
+        void put(uint64_t value, size_t bits)
+        {
+            for (size_t i = bits; i > 0; --i)
+            {
+                m_Value = static_cast<uint8_t>(m_Value << 1 | ((value >> (i - 1)) & 1));
+                if (++m_Bits == 6)
+                    flush();
+            }
+        }
+
+        // Pads the last character, and returns the number of fill bits
+        unsigned finish()
+        {
+            const unsigned fill = m_Bits == 0 ? 0 : 6 - m_Bits;
+            put(0, fill);
+            return fill;
+        }
+
+        std::string payload;
+
+    private:
+        void flush()
+        {
+            payload += static_cast<char>(m_Value < 40 ? m_Value + 48 : m_Value + 56);
+            m_Value = 0;
+            m_Bits = 0;
+        }
+
+        uint8_t  m_Value = 0;
+        unsigned m_Bits = 0;
+    };
+}
+
+CorpusGenerator::CorpusGenerator(uint64_t seed, double errorRate) :
+    m_Random(seed),
+    m_Weights{ 2, 2, 2, 1, 6, 1 },
+    m_TagBlockRate(0.5),
+    m_ErrorRate(errorRate),
+    m_Time(1700000000),
+    m_Latitude(59.9),
+    m_Longitude(10.7),
+    m_Fleet(),
+    m_Pending(),
+    m_PendingNext(0),
+    m_PendingEnd(0),
+    m_Group(0),
+    m_SequenceId(0),
+    m_Injected(static_cast<size_t>(ErrorCode::E033) + 1, 0)
+{
+    for (size_t i = 0; i < fleetSize; ++i)
+    {
+        Vessel vessel;
+        vessel.mmsi = static_cast<uint32_t>(257000000 + below(1000000));
+        vessel.latitude = 58.0 + 4.0 * uniform();
+        vessel.longitude = 5.0 + 10.0 * uniform();
+        vessel.speed = 20.0 * uniform();
+        vessel.course = 360.0 * uniform();
+        m_Fleet.push_back(vessel);
+    }
+}
+
+void CorpusGenerator::setWeight(Kind kind, double weight)
+{
+    if (kind < Kind::count)
+        m_Weights[static_cast<size_t>(kind)] = std::max(0.0, weight);
+}
+
+CorpusGenerator::Kind CorpusGenerator::chooseKind()
+{
+    double total = 0;
+    for (double weight : m_Weights)
+        total += weight;
+
+    double choice = uniform() * total;
+    for (size_t i = 0; i < static_cast<size_t>(Kind::count); ++i)
+    {
+        if (choice < m_Weights[i])
+            return static_cast<Kind>(i);
+        choice -= m_Weights[i];
+    }
+
+    return Kind::gga;
+}
+
+void CorpusGenerator::move()
+{
+    ++m_Time;
+    m_Latitude += (uniform() - 0.5) * 1e-4;
+    m_Longitude += (uniform() - 0.5) * 1e-4;
+}
+
+ErrorCode CorpusGenerator::next(std::string& line)
+{
+    line.clear();
+
+    // The rest of a multi sentence message
+    if (m_PendingNext < m_PendingEnd)
+    {
+        line.swap(m_Pending[m_PendingNext++]);
+        line += "\r\n";
+        ++m_Injected[0];
+        return ErrorCode::E000;
+    }
+
+    ErrorCode error = ErrorCode::E000;
+    if (m_ErrorRate > 0 && uniform() < m_ErrorRate)
+        error = static_cast<ErrorCode>(1 + below(static_cast<uint64_t>(ErrorCode::E033)));
+
+    const bool tagged = error >= ErrorCode::E026 && error <= ErrorCode::E032;
+    if (error != ErrorCode::E000)
+    {
+        // Each defect is put into the kind of sentence that has the field in question
+        if (tagged || uniform() < m_TagBlockRate)
+            tagBlock(line, 0, 0, 0);
+
+        if (error == ErrorCode::E011)
+            proprietary(line);
+        else if (error == ErrorCode::E016)
+            rmc(line);
+        else if (error == ErrorCode::E022)
+            positionReport(line);
+        else
+            gga(line);
+
+        line += "\r\n";
+        inject(line, error);
+        ++m_Injected[static_cast<size_t>(error)];
+        return error;
+    }
+
+    m_PendingNext = m_PendingEnd = 0;
+
+    switch (chooseKind())
+    {
+    case Kind::gga:
+    case Kind::count:
+        if (uniform() < m_TagBlockRate)
+            tagBlock(line, 0, 0, 0);
+        gga(line);
+        break;
+    case Kind::rmc:
+        if (uniform() < m_TagBlockRate)
+            tagBlock(line, 0, 0, 0);
+        rmc(line);
+        break;
+    case Kind::gsv:
+    {
+        // A cycle of two or three sentences
+        const size_t parts = 2 + below(2);
+        reservePending(parts - 1);
+        gsv(line, 1, parts);
+        for (size_t part = 2; part <= parts; ++part)
+        {
+            m_Pending[part - 2].clear();
+            gsv(m_Pending[part - 2], part, parts);
+        }
+        break;
+    }
+    case Kind::gsa:
+        gsa(line);
+        break;
+    case Kind::proprietary:
+        proprietary(line);
+        break;
+    case Kind::vdm:
+        if (below(10) != 0)
+        {
+            if (uniform() < m_TagBlockRate)
+                tagBlock(line, 0, 0, 0);
+            positionReport(line);
+        }
+        else
+        {
+            staticReport(line);
+        }
+        break;
+    }
+
+    line += "\r\n";
+    ++m_Injected[0];
+    return ErrorCode::E000;
+}
+
+size_t CorpusGenerator::fill(std::string& buffer, size_t bytes)
+{
+    thread_local std::string line;
+
+    size_t lines = 0;
+    while (buffer.size() < bytes)
+    {
+        next(line);
+        buffer += line;
+        ++lines;
+    }
+
+    return lines;
+}
+
+uint64_t CorpusGenerator::write(const std::string& path, uint64_t bytes)
+{
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    if (file == nullptr)
+        throw std::system_error(errno, std::generic_category(), "fopen " + path);
+
+    std::string buffer;
+    buffer.reserve(writeChunk + 1024);
+
+    uint64_t lines = 0;
+    for (uint64_t written = 0; written < bytes; written += buffer.size())
+    {
+        buffer.clear();
+        lines += fill(buffer, static_cast<size_t>(std::min<uint64_t>(writeChunk, bytes - written)));
+
+        if (std::fwrite(buffer.data(), 1, buffer.size(), file) != buffer.size())
+        {
+            const int error = errno;
+            std::fclose(file);
+            throw std::system_error(error, std::generic_category(), "fwrite " + path);
+        }
+    }
+
+    if (std::fclose(file) != 0)
+        throw std::system_error(errno, std::generic_category(), "fclose " + path);
+
+    return lines;
+}
+
+void CorpusGenerator::reservePending(size_t lines)
+{
+    // The strings are kept between messages, so their buffers are reused
+    if (m_Pending.size() < lines)
+        m_Pending.resize(lines);
+    m_PendingEnd = lines;
+}
+
+void CorpusGenerator::tagBlock(std::string& line, size_t fragment, size_t fragments, uint32_t group)
+{
+    const size_t begin = line.size();
+    line += "\\s:r";
+    appendUnsigned(line, 3669961 + below(4));
+    if (fragments > 0)
+    {
+        line += ",g:";
+        appendUnsigned(line, fragment);
+        line += '-';
+        appendUnsigned(line, fragments);
+        line += '-';
+        appendUnsigned(line, group);
+    }
+    line += ",c:";
+    appendUnsigned(line, static_cast<uint64_t>(m_Time));
+    appendChecksum(line, begin);
+    line += '\\';
+}
+
+void CorpusGenerator::gga(std::string& line)
+{
+    move();
+
+    const size_t begin = line.size();
+    line += "$GPGGA,";
+    appendTime(line, m_Time);
+    line += ',';
+    appendAngle(line, m_Latitude, 2, 'N', 'S');
+    line += ',';
+    appendAngle(line, m_Longitude, 3, 'E', 'W');
+    line += ',';
+    appendUnsigned(line, 1 + below(2));
+    line += ',';
+    appendUnsigned(line, 4 + below(9), 2);
+    line += ',';
+    appendFixed(line, 0.5 + 2.0 * uniform(), 1, 1);
+    line += ',';
+    appendFixed(line, 10.0 + 50.0 * uniform(), 1, 1);
+    line += ",M,";
+    appendFixed(line, 39.0 + uniform(), 1, 1);
+    line += ",M,,";
+    appendChecksum(line, begin);
+}
+
+void CorpusGenerator::rmc(std::string& line)
+{
+    move();
+
+    const size_t begin = line.size();
+    line += "$GPRMC,";
+    appendTime(line, m_Time);
+    line += ",A,";
+    appendAngle(line, m_Latitude, 2, 'N', 'S');
+    line += ',';
+    appendAngle(line, m_Longitude, 3, 'E', 'W');
+    line += ',';
+    appendFixed(line, 12.0 * uniform(), 1, 1);
+    line += ',';
+    appendFixed(line, 360.0 * uniform(), 1, 1);
+    line += ',';
+
+    // ddmmyy
+    const int64_t days = m_Time / 86400;
+    appendUnsigned(line, static_cast<uint64_t>(days % 28 + 1), 2);
+    appendUnsigned(line, static_cast<uint64_t>(days / 28 % 12 + 1), 2);
+    appendUnsigned(line, static_cast<uint64_t>(23 + days / 336 % 10), 2);
+    line += ',';
+    appendFixed(line, 3.0 * uniform(), 1, 1);
+    line += ",E,A";
+    appendChecksum(line, begin);
+}
+
+void CorpusGenerator::gsv(std::string& line, size_t part, size_t parts)
+{
+    const size_t satellites = 4 * parts - 1;
+
+    const size_t begin = line.size();
+    line += "$GPGSV,";
+    appendUnsigned(line, parts);
+    line += ',';
+    appendUnsigned(line, part);
+    line += ',';
+    appendUnsigned(line, satellites, 2);
+
+    for (size_t i = 4 * (part - 1); i < std::min(4 * part, satellites); ++i)
+    {
+        line += ',';
+        appendUnsigned(line, 1 + i * 2, 2);
+        line += ',';
+        appendUnsigned(line, below(90), 2);
+        line += ',';
+        appendUnsigned(line, below(360), 3);
+        line += ',';
+        appendUnsigned(line, 10 + below(40), 2);
+    }
+    appendChecksum(line, begin);
+}
+
+void CorpusGenerator::gsa(std::string& line)
+{
+    const size_t begin = line.size();
+    line += "$GPGSA,A,3";
+
+    for (size_t i = 0; i < 12; ++i)
+    {
+        line += ',';
+        if (i < 8)
+            appendUnsigned(line, 1 + i * 3, 2);
+    }
+    line += ',';
+    appendFixed(line, 1.0 + uniform(), 1, 1);
+    line += ',';
+    appendFixed(line, 0.5 + uniform(), 1, 1);
+    line += ',';
+    appendFixed(line, 0.8 + uniform(), 1, 1);
+    appendChecksum(line, begin);
+}
+
+void CorpusGenerator::proprietary(std::string& line)
+{
+    // Garmin estimated position error
+    const size_t begin = line.size();
+    line += "$PGRME,";
+    appendFixed(line, 20.0 * uniform(), 1, 1);
+    line += ",M,";
+    appendFixed(line, 30.0 * uniform(), 1, 1);
+    line += ",M,";
+    appendFixed(line, 40.0 * uniform(), 1, 1);
+    line += ",M";
+    appendChecksum(line, begin);
+}
+
+void CorpusGenerator::positionReport(std::string& line)
+{
+    auto& vessel = m_Fleet[below(m_Fleet.size())];
+    vessel.latitude += (uniform() - 0.5) * 1e-3;
+    vessel.longitude += (uniform() - 0.5) * 1e-3;
+
+    SixBitWriter bits;
+    bits.put(1, 6);                                                         // Message id
+    bits.put(0, 2);                                                         // Repeat indicator
+    bits.put(vessel.mmsi, 30);
+    bits.put(0, 4);                                                         // Navigational status
+    bits.put(static_cast<uint64_t>(-128) & 0xFF, 8);                        // Rate of turn not available
+    bits.put(static_cast<uint64_t>(vessel.speed * 10.0), 10);
+    bits.put(0, 1);                                                         // Position accuracy
+    bits.put(static_cast<uint64_t>(std::llround(vessel.longitude * 600000.0)) & 0x0FFFFFFF, 28);
+    bits.put(static_cast<uint64_t>(std::llround(vessel.latitude * 600000.0)) & 0x07FFFFFF, 27);
+    bits.put(static_cast<uint64_t>(vessel.course * 10.0), 12);
+    bits.put(511, 9);                                                       // True heading not available
+    bits.put(m_Time % 60, 6);                                               // Time stamp
+    bits.put(0, 25);                                                        // Flags and radio status
+    const unsigned fill = bits.finish();
+
+    const size_t begin = line.size();
+    line += "!ABVDM,1,1,,";
+    line += below(2) == 0 ? 'A' : 'B';
+    line += ',';
+    line += bits.payload;
+    line += ',';
+    appendUnsigned(line, fill);
+    appendChecksum(line, begin);
+}
+
+void CorpusGenerator::staticReport(std::string& line)
+{
+    const auto& vessel = m_Fleet[below(m_Fleet.size())];
+
+    SixBitWriter bits;
+    bits.put(5, 6);                                                         // Message id
+    bits.put(0, 2);                                                         // Repeat indicator
+    bits.put(vessel.mmsi, 30);
+    bits.put(0, 2);                                                         // AIS version
+    bits.put(9000000 + vessel.mmsi % 1000000, 30);                          // IMO number
+    for (size_t i = 0; i < 7 + 20; ++i)                                     // Call sign and name
+        bits.put(1 + below(26), 6);
+    bits.put(70, 8);                                                        // Ship type, cargo
+    bits.put(100 + below(200), 9);                                          // Dimensions
+    bits.put(20 + below(100), 9);
+    bits.put(5 + below(20), 6);
+    bits.put(5 + below(20), 6);
+    bits.put(1, 4);                                                         // GPS
+    bits.put(below(1 << 20), 20);                                           // ETA
+    bits.put(50 + below(100), 8);                                           // Draught
+    for (size_t i = 0; i < 20; ++i)                                         // Destination
+        bits.put(1 + below(26), 6);
+    bits.put(0, 2);                                                         // DTE and spare
+    const unsigned fill = bits.finish();
+
+    // Two fragments, the second one kept for the next call
+    const std::string_view payload(bits.payload);
+    const size_t split = 60;
+    const uint32_t group = ++m_Group;
+    const uint32_t sequence = m_SequenceId = (m_SequenceId + 1) % 10;
+    const char channel = below(2) == 0 ? 'A' : 'B';
+
+    reservePending(1);
+    for (size_t fragment = 1; fragment <= 2; ++fragment)
+    {
+        std::string& out = fragment == 1 ? line : m_Pending[0];
+        if (fragment == 2)
+            out.clear();
+
+        tagBlock(out, fragment, 2, group);
+        const size_t begin = out.size();
+        out += "!ABVDM,2,";
+        appendUnsigned(out, fragment);
+        out += ',';
+        appendUnsigned(out, sequence);
+        out += ',';
+        out += channel;
+        out += ',';
+        out.append(fragment == 1 ? payload.substr(0, split) : payload.substr(split));
+        out += ',';
+        appendUnsigned(out, fragment == 1 ? 0 : fill);
+        appendChecksum(out, begin);
+    }
+}
+
+void CorpusGenerator::inject(std::string& line, ErrorCode error)
+{
+    const size_t start = sentenceStart(line);
+    const size_t star = line.find('*', start);
+
+    switch (error)
+    {
+    case ErrorCode::E001:   // Illegal start of sentence
+        line[start] = '#';
+        break;
+    case ErrorCode::E002:   // Illegal address field, one character short
+        line.erase(start + 5, 1);
+        fixChecksum(line, start);
+        break;
+    case ErrorCode::E003:   // Line ends within the checksum field
+        line.erase(star + 2);
+        break;
+    case ErrorCode::E004:   // Both checksum digits wrong
+        line[star + 1] = hexDigits[(std::string_view(hexDigits).find(line[star + 1]) + 1) % 16];
+        line[star + 2] = hexDigits[(std::string_view(hexDigits).find(line[star + 2]) + 1) % 16];
+        break;
+    case ErrorCode::E005:   // Unknown talker
+        line.replace(start + 1, 2, "ZZ");
+        fixChecksum(line, start);
+        break;
+    case ErrorCode::E006:   // Reserved character in the address field
+        line[start + 2] = '^';
+        fixChecksum(line, start);
+        break;
+    case ErrorCode::E007:   // Undefined character
+        line.insert(star, 1, '\x01');
+        break;
+    case ErrorCode::E008:   // Reserved character in a data field
+        replaceField(line, 9, "1~2");
+        break;
+    case ErrorCode::E009:   // Unknown formatter
+        line.replace(start + 3, 3, "XYZ");
+        fixChecksum(line, start);
+        break;
+    case ErrorCode::E010:   // Lower case talker
+        line[start + 1] = 'g';
+        fixChecksum(line, start);
+        break;
+    case ErrorCode::E011:   // Lower case proprietary talker
+        line[start + 2] = 'g';
+        fixChecksum(line, start);
+        break;
+    case ErrorCode::E012:   // Lower case formatter
+        line[start + 3] = 'g';
+        fixChecksum(line, start);
+        break;
+    case ErrorCode::E013:   // Fixed length field too long
+        replaceField(line, 6, "11");
+        break;
+    case ErrorCode::E014:   // A digit in a letter field
+        replaceField(line, 3, "1");
+        break;
+    case ErrorCode::E015:   // A field missing
+        line.erase(line.rfind(',', star), 1);
+        line.erase(line.rfind(',', line.find('*', start)), 1);
+        fixChecksum(line, start);
+        break;
+    case ErrorCode::E016:   // Mandatory status empty
+        replaceField(line, 2, "");
+        break;
+    case ErrorCode::E017:   // Illegal literal
+        replaceField(line, 3, "X");
+        break;
+    case ErrorCode::E018:   // Illegal number
+        replaceField(line, 8, "1.x2");
+        break;
+    case ErrorCode::E019:   // Illegal time
+        replaceField(line, 1, "14a310.00");
+        break;
+    case ErrorCode::E020:   // Time without period
+        replaceField(line, 1, "144310x00");
+        break;
+    case ErrorCode::E021:   // A letter that is not a hex digit in a number
+        replaceField(line, 14, "0A1G");
+        break;
+    case ErrorCode::E022:   // Illegal six-bit character
+        replaceField(line, 5, "1x0000000000000000000000000");
+        break;
+    case ErrorCode::E023:   // Sentence too long
+        replaceField(line, 9, "123456789012345678901234567890123456789.0");
+        break;
+    case ErrorCode::E024:   // No CR
+        line.erase(line.size() - 2, 1);
+        break;
+    case ErrorCode::E025:   // No LF
+        line.back() = ' ';
+        break;
+    case ErrorCode::E026:   // Tag block not ended
+        line.erase(line.find('\\', 1), 1);
+        break;
+    case ErrorCode::E027:   // Unknown parameter code
+        replaceInTagBlock(line, "s:", "x:");
+        break;
+    case ErrorCode::E028:   // No colon
+        replaceInTagBlock(line, "s:", "s-");
+        break;
+    case ErrorCode::E029:   // Identification too long
+        replaceInTagBlock(line, "s:r", "s:r1234567890123456");
+        break;
+    case ErrorCode::E030:   // Illegal identification
+        replaceInTagBlock(line, "s:r", "s:r_");
+        break;
+    case ErrorCode::E031:   // Not a digit
+        replaceInTagBlock(line, "c:1", "c:1a");
+        break;
+    case ErrorCode::E032:   // Illegal grouping
+        replaceInTagBlock(line, ",c:", ",g:1x2-3,c:");
+        break;
+    case ErrorCode::E033:   // Line ends within the data fields
+        line.erase(start + (star - start) / 2);
+        break;
+    default:
+        break;
+    }
+}
@@ -0,0 +1,121 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "ErrorCodes.h"
+
+/// <summary>
+///        Generates a repeatable stream of realistic NMEA and AIS lines, with errors injected at a given rate.
+/// </summary>
+/// The lines are GGA, RMC, GSV and GSA of a moving GPS receiver, VDM position reports and two fragment static
+/// reports of a fleet of AIS targets, and proprietary sentences, mixed by weight. Some lines carry a tag block
+/// with source, time and, for multi fragment messages, sentence grouping.
+/// An injected error is a defect of the kind described by one of the error codes E001 .. E033. The parser reports
+/// the same code for most defects, but some codes can't be detected as such by the parser, e.g. E002.
+/// The same seed gives the same lines on every platform.
+class CorpusGenerator
+{
+public:
+    /// <summary>
+    ///        The kinds of sentences generated.
+    /// </summary>
+    enum class Kind { gga, rmc, gsv, gsa, vdm, proprietary, count };
+
+    /// <summary>
+    ///        Creates a generator.
+    /// </summary>
+    /// \param seed [in] The seed of the random sequence.
+    /// \param errorRate [in] The fraction of lines with an injected error, 0 .. 1.
+    explicit CorpusGenerator(uint64_t seed = 1, double errorRate = 0.0);
+
+    /// <summary>
+    ///        Sets the relative weight of a kind of sentence, 0 to leave it out.
+    /// </summary>
+    /// The default mix is GGA 2, RMC 2, GSV 2, GSA 1, VDM 6 and proprietary 1.
+    void setWeight(Kind kind, double weight);
+
+    /// <summary>
+    ///        Sets the fraction of lines with a tag block, 0 .. 1. The fragments of a message always have one.
+    /// </summary>
+    void setTagBlockRate(double rate) { m_TagBlockRate = rate; }
+
+    /// <summary>
+    ///        Sets the fraction of lines with an injected error, 0 .. 1.
+    /// </summary>
+    void setErrorRate(double rate) { m_ErrorRate = rate; }
+
+    /// <summary>
+    ///        Generates the next line, ending with CR LF unless the error removes it.
+    /// </summary>
+    /// \param line [out] The line. Its capacity is reused, so no memory is allocated once it is large enough.
+    /// \return The error injected, E000 if the line is valid
+    ErrorCode next(std::string& line);
+
+    /// <summary>
+    ///        Appends lines to a buffer until it holds at least the given number of bytes.
+    /// </summary>
+    /// \return The number of lines appended
+    size_t fill(std::string& buffer, size_t bytes);
+
+    /// <summary>
+    ///        Writes lines to a file until it holds at least the given number of bytes.
+    /// </summary>
+    /// \return The number of lines written
+    /// \exception std::system_error if the file can't be written
+    uint64_t write(const std::string& path, uint64_t bytes);
+
+    /// The number of lines generated with each error code, indexed by the code, E000 for valid lines
+    const std::vector<uint64_t>& injected() const { return m_Injected; }
+
+private:
+    struct Vessel
+    {
+        uint32_t mmsi;
+        double   latitude;
+        double   longitude;
+        double   speed;      // Knots
+        double   course;     // Degrees
+    };
+
+    uint64_t below(uint64_t n) { return m_Random() % n; }
+    double uniform() { return static_cast<double>(m_Random() >> 11) * (1.0 / 9007199254740992.0); }
+
+    Kind chooseKind();
+    void move();
+
+    // Each appends a complete line without the CR LF
+    void gga(std::string& line);
+    void rmc(std::string& line);
+    void gsv(std::string& line, size_t part, size_t parts);
+    void gsa(std::string& line);
+    void proprietary(std::string& line);
+    void positionReport(std::string& line);
+    void staticReport(std::string& line);
+
+    void reservePending(size_t lines);
+    void tagBlock(std::string& line, size_t fragment, size_t fragments, uint32_t group);
+    void inject(std::string& line, ErrorCode error);
+
+    std::mt19937_64     m_Random;
+    double              m_Weights[static_cast<size_t>(Kind::count)];
+    double              m_TagBlockRate;
+    double              m_ErrorRate;
+
+    // The receiver and the fleet
+    int64_t             m_Time;        // Seconds since 1970-01-01 UTC
+    double              m_Latitude;
+    double              m_Longitude;
+    std::vector<Vessel> m_Fleet;
+
+    // The lines of a multi sentence message or a GSV cycle still to come
+    std::vector<std::string> m_Pending;
+    size_t              m_PendingNext;
+    size_t              m_PendingEnd;
+    uint32_t            m_Group;
+    uint32_t            m_SequenceId;
+
+    std::vector<uint64_t> m_Injected;
+};
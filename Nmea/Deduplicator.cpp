@@ -0,0 +1,244 @@
+﻿#include "Deduplicator.h"
+
+namespace
+{
+    // FNV-1a, ref. http://www.isthe.com/chongo/tech/comp/fnv/
+    const uint64_t fnvOffsetBasis = 14695981039346656037ull;
+    const uint64_t fnvPrime = 1099511628211ull;
+
+    void fnv1a(uint64_t& hash, std::string_view field) noexcept
+    {
+        for (auto ch : field)
+        {
+            hash ^= static_cast<uint8_t>(ch);
+            hash *= fnvPrime;
+        }
+
+        // Field separator, so that "1,23" and "12,3" differs
+        hash ^= ',';
+        hash *= fnvPrime;
+    }
+
+    // !aaccc,fragments,fragment number,sequential message id,channel,payload,fill bits*hh
+    bool isEncapsulated(const std::vector<std::string_view>& sentenceFields) noexcept
+    {
+        return sentenceFields.size() == 8 && !sentenceFields[0].empty() && sentenceFields[0][0] == '!';
+    }
+
+    // A fragment count or number, '1' .. '9'
+    bool isDigit(std::string_view field) noexcept
+    {
+        return field.size() == 1 && field[0] >= '1' && field[0] <= '9';
+    }
+
+    uint64_t messageHash(std::string_view fragments, std::string_view channel, std::string_view payload, std::string_view fillBits) noexcept
+    {
+        uint64_t h = fnvOffsetBasis;
+        fnv1a(h, fragments);
+        fnv1a(h, channel);
+        fnv1a(h, payload);
+        fnv1a(h, fillBits);
+
+        // 0 marks an empty slot
+        return h == 0 ? 1 : h;
+    }
+
+    void addReceiver(Deduplicator::Sighting& sighting, SourceId source) noexcept
+    {
+        for (uint32_t i = 0; i < sighting.numberOfReceivers; ++i)
+            if (sighting.receivers[i] == source)
+                return;
+
+        if (sighting.numberOfReceivers < Deduplicator::maxReceivers)
+            sighting.receivers[sighting.numberOfReceivers++] = source;
+    }
+}
+
+Deduplicator::Deduplicator(size_t capacity, int64_t window) :
+    m_Table(),
+    m_Mask(0),
+    m_Window(window),
+    m_Accepted(0),
+    m_Dropped(0),
+    m_Incomplete(0),
+    m_Pending(maxPending),
+    m_Held()
+{
+    size_t size = maxProbes;
+    while (size < capacity)
+        size <<= 1;
+
+    m_Table.resize(size, Sighting{});
+    m_Mask = size - 1;
+}
+
+Deduplicator::~Deduplicator()
+{
+}
+
+Deduplicator::Verdict Deduplicator::accept(std::string_view line, const std::vector<std::string_view>& sentenceFields, SourceId source, int64_t time)
+{
+    m_Held.clear();
+
+    const bool multiFragment = isEncapsulated(sentenceFields) && isDigit(sentenceFields[1]) && isDigit(sentenceFields[2]) &&
+        sentenceFields[1][0] != '1' && sentenceFields[2][0] <= sentenceFields[1][0];
+    if (!multiFragment)
+    {
+        const uint64_t h = hash(sentenceFields);
+        if (h != 0 && !record(h, source, time))
+        {
+            ++m_Dropped;
+            return Verdict::drop;
+        }
+
+        ++m_Accepted;
+        return Verdict::pass;
+    }
+
+    const auto sequence = sentenceFields[3];
+    Pending* pending = nullptr;
+    for (auto& candidate : m_Pending)
+        if (candidate.used && candidate.source == source && candidate.sequence == sequence)
+            pending = &candidate;
+
+    const char number = sentenceFields[2][0];
+    if (number == '1')
+    {
+        // A new message with the same sequential message id ends the one before
+        if (pending != nullptr)
+        {
+            pending->used = false;
+            ++m_Incomplete;
+        }
+
+        auto& message = newPending(time);
+        message.used = true;
+        message.source = source;
+        message.sequence = sequence;
+        message.firstSeen = time;
+        message.fragments = sentenceFields[1][0];
+        message.channel = sentenceFields[4];
+        message.payload = sentenceFields[5];
+        message.lines.clear();
+        message.lines.emplace_back(line);
+        return Verdict::hold;
+    }
+
+    if (pending == nullptr || !isLive(pending->firstSeen, time) || pending->fragments != sentenceFields[1][0] ||
+        pending->channel != sentenceFields[4] || number != '1' + static_cast<char>(pending->lines.size()))
+    {
+        // The message can't be put together, the fragment is passed on as it is
+        if (pending != nullptr)
+        {
+            pending->used = false;
+            ++m_Incomplete;
+        }
+
+        ++m_Accepted;
+        return Verdict::pass;
+    }
+
+    pending->payload += sentenceFields[5];
+    if (number < pending->fragments)
+    {
+        pending->lines.emplace_back(line);
+        return Verdict::hold;
+    }
+
+    pending->used = false;
+    const uint64_t fragments = pending->lines.size() + 1;
+    if (!record(messageHash(sentenceFields[1], pending->channel, pending->payload, sentenceFields[6]), source, time))
+    {
+        m_Dropped += fragments;
+        return Verdict::drop;
+    }
+
+    // The held lines are swapped, so the capacity of both is reused
+    m_Held.swap(pending->lines);
+    m_Accepted += fragments;
+    return Verdict::pass;
+}
+
+bool Deduplicator::record(uint64_t h, SourceId source, int64_t time)
+{
+    Sighting* free = nullptr;
+    Sighting* oldest = nullptr;
+
+    for (size_t i = 0; i < maxProbes; ++i)
+    {
+        auto& sighting = m_Table[(h + i) & m_Mask];
+
+        if (!isLive(sighting, time))
+        {
+            if (free == nullptr)
+                free = &sighting;
+        }
+        else if (sighting.hash == h)
+        {
+            ++sighting.count;
+            addReceiver(sighting, source);
+            return false;
+        }
+        else if (oldest == nullptr || sighting.firstSeen < oldest->firstSeen)
+        {
+            oldest = &sighting;
+        }
+    }
+
+    // Evict the oldest message if all the probed slots are in use
+    auto& sighting = free != nullptr ? *free : *oldest;
+    sighting.hash = h;
+    sighting.firstSeen = time;
+    sighting.count = 1;
+    sighting.numberOfReceivers = 0;
+    addReceiver(sighting, source);
+    return true;
+}
+
+Deduplicator::Pending& Deduplicator::newPending(int64_t time)
+{
+    Pending* oldest = nullptr;
+    for (auto& pending : m_Pending)
+    {
+        if (!pending.used)
+            return pending;
+
+        if (!isLive(pending.firstSeen, time))
+        {
+            pending.used = false;
+            ++m_Incomplete;
+            return pending;
+        }
+
+        if (oldest == nullptr || pending.firstSeen < oldest->firstSeen)
+            oldest = &pending;
+    }
+
+    oldest->used = false;
+    ++m_Incomplete;
+    return *oldest;
+}
+
+const Deduplicator::Sighting* Deduplicator::find(const std::vector<std::string_view>& sentenceFields, int64_t time) const
+{
+    const uint64_t h = hash(sentenceFields);
+    if (h == 0)
+        return nullptr;
+
+    for (size_t i = 0; i < maxProbes; ++i)
+    {
+        const auto& sighting = m_Table[(h + i) & m_Mask];
+        if (sighting.hash == h && isLive(sighting, time))
+            return &sighting;
+    }
+
+    return nullptr;
+}
+
+uint64_t Deduplicator::hash(const std::vector<std::string_view>& sentenceFields) noexcept
+{
+    if (!isEncapsulated(sentenceFields) || sentenceFields[1] != "1")
+        return 0;
+
+    return messageHash(sentenceFields[1], sentenceFields[4], sentenceFields[5], sentenceFields[6]);
+}
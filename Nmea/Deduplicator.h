@@ -0,0 +1,139 @@
+﻿#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "SourceInterner.h"
+
+/// <summary>
+///        Suppresses AIS messages received by several receivers within a time window.
+/// </summary>
+/// A message is identified by a hash of its number of fragments, channel, payload and fill bits. The fragments of
+/// a multi-fragment message are held per source and sequential message id until the last one, and the message is
+/// hashed with the payloads of all its fragments, so that its fragments are passed on or dropped together.
+/// The sequential message id and the tag block are not part of the hash, since they differ between receivers.
+/// The hashes are kept in a fixed-size table, where an entry expires when it is older than the window.
+class Deduplicator
+{
+public:
+    /// The number of receivers remembered for each message
+    static const size_t maxReceivers = 8;
+
+    /// The number of multi-fragment messages held at once
+    static const size_t maxPending = 64;
+
+    /// <summary>
+    ///        What to do with a sentence given to accept.
+    /// </summary>
+    enum class Verdict
+    {
+        pass,   ///< Pass on the sentence, after the fragments held before it, see held()
+        drop,   ///< Drop the sentence and the fragments held before it, the message is a duplicate
+        hold    ///< The sentence is a fragment of a message not received in full yet, and has been kept
+    };
+
+    /// <summary>
+    ///        What is known about a message seen within the window.
+    /// </summary>
+    struct Sighting
+    {
+        uint64_t hash;
+        int64_t  firstSeen;
+        uint32_t count;              ///< Number of times the message has been received
+        uint32_t numberOfReceivers;  ///< Number of valid elements in receivers
+        std::array<SourceId, maxReceivers> receivers;
+    };
+
+    /// <summary>
+    ///        Creates an empty deduplicator.
+    /// </summary>
+    /// \param capacity [in] The number of messages that can be remembered, rounded up to a power of two.
+    /// \param window [in] How long a message is remembered, in the unit of the time given to accept.
+    Deduplicator(size_t capacity = 8192, int64_t window = 30);
+    ~Deduplicator();
+
+    /// <summary>
+    ///        Records a received sentence and tells whether it shall be passed on.
+    /// </summary>
+    /// \param line [in] The line of the sentence, copied if the sentence is held.
+    /// \param sentenceFields [in] The fields of the sentence, see Nmea::sentenceFields().
+    /// \param source [in] The source identification of the receiver, see TagBlock::sourceId.
+    /// \param time [in] The time of reception, e.g. the c: tag block parameter in seconds.
+    /// \return Verdict::drop if the message is a duplicate of one received within the window
+    /// \note Sentences that are not encapsulated, and fragments that don't follow the fragments held of their
+    ///       message, are passed on. A message is given up when a new one with the same sequential message id
+    ///       starts, when it is older than the window, or when maxPending newer messages are held.
+    Verdict accept(std::string_view line, const std::vector<std::string_view>& sentenceFields, SourceId source, int64_t time);
+
+    /// <summary>
+    ///        The fragments held before the last fragment of the message given to accept, in fragment order.
+    /// </summary>
+    /// Valid until the next call to accept, empty unless it completed a multi-fragment message.
+    const std::vector<std::string>& held() const { return m_Held; }
+
+    /// <summary>
+    ///        Looks up a single-fragment sentence seen within the window.
+    /// </summary>
+    /// \return The sighting, or nullptr if the sentence has not been seen within the window
+    const Sighting* find(const std::vector<std::string_view>& sentenceFields, int64_t time) const;
+
+    /// The number of sentences passed on by accept
+    uint64_t accepted() const { return m_Accepted; }
+
+    /// The number of sentences dropped by accept
+    uint64_t dropped() const { return m_Dropped; }
+
+    /// The number of multi-fragment messages given up before their last fragment
+    uint64_t incomplete() const { return m_Incomplete; }
+
+    /// <summary>
+    ///        Computes the hash identifying a single-fragment encapsulated sentence.
+    /// </summary>
+    /// \return The hash, or 0 if the sentence is not an encapsulated sentence of a single fragment
+    static uint64_t hash(const std::vector<std::string_view>& sentenceFields) noexcept;
+
+private:
+    // The number of consecutive slots searched for a hash
+    static const size_t maxProbes = 8;
+
+    // The fragments received so far of a multi-fragment message
+    struct Pending
+    {
+        bool                     used = false;
+        SourceId                 source = noSource;
+        std::string              sequence;       // The sequential message id
+        int64_t                  firstSeen = 0;
+        char                     fragments = 0;  // The number of fragments, '2' .. '9'
+        std::string              channel;
+        std::string              payload;        // The payloads of the fragments so far
+        std::vector<std::string> lines;          // The lines of the fragments so far
+    };
+
+    // Records a message, true if it has not been seen within the window
+    bool record(uint64_t hash, SourceId source, int64_t time);
+
+    // The slot for a new message, giving up the oldest if all are in use
+    Pending& newPending(int64_t time);
+
+    bool isLive(int64_t firstSeen, int64_t time) const noexcept
+    {
+        return time - firstSeen <= m_Window;
+    }
+
+    bool isLive(const Sighting& sighting, int64_t time) const noexcept
+    {
+        return sighting.hash != 0 && isLive(sighting.firstSeen, time);
+    }
+
+    std::vector<Sighting>    m_Table;
+    size_t                   m_Mask;
+    int64_t                  m_Window;
+    uint64_t                 m_Accepted;
+    uint64_t                 m_Dropped;
+    uint64_t                 m_Incomplete;
+    std::vector<Pending>     m_Pending;
+    std::vector<std::string> m_Held;
+};
@@ -0,0 +1,145 @@
+﻿#include "GroupCorrelator.h"
+
+#include "Nmea.h"
+
+GroupCorrelator::GroupCorrelator(size_t capacity, int64_t timeout) :
+    m_Table(),
+    m_Mask(0),
+    m_Timeout(timeout),
+    m_Subscribers(),
+    m_Completed(0),
+    m_Expired(0)
+{
+    size_t size = maxProbes;
+    while (size < capacity)
+        size <<= 1;
+
+    m_Table.resize(size, Pending{});
+    m_Mask = size - 1;
+}
+
+GroupCorrelator::~GroupCorrelator()
+{
+}
+
+void GroupCorrelator::subscribe(Subscriber subscriber)
+{
+    m_Subscribers.push_back(std::move(subscriber));
+}
+
+bool GroupCorrelator::add(std::string_view line, const Nmea& nmea, int64_t time)
+{
+    const auto& tagBlock = nmea.tagBlock();
+    if (!tagBlock.has(TagBlock::grouping))
+        return false;
+
+    const uint32_t number = tagBlock.sentenceNumber;
+    const uint32_t total = tagBlock.totalSentences;
+    const uint32_t groupId = tagBlock.groupId;
+    if (number == 0 || number > total || total > maxMembers)
+        return false;
+
+    const SourceId source = tagBlock.sourceId;
+
+    auto pending = find(groupId, source);
+    if (pending != nullptr && (pending->group.size != total || (pending->received & (1u << (number - 1))) != 0))
+    {
+        // The group id has been reused before the previous group was completed
+        pending->inUse = false;
+        ++m_Expired;
+        pending = nullptr;
+    }
+
+    if (pending == nullptr)
+    {
+        pending = allocate(groupId, time);
+        pending->group.size = total;
+        pending->group.source = source;
+    }
+    else if (pending->group.source == noSource)
+    {
+        pending->group.source = source;
+    }
+
+    pending->group.members[number - 1] = line;
+    pending->received |= 1u << (number - 1);
+
+    if (pending->received == (1u << total) - 1)
+        deliver(*pending);
+
+    return true;
+}
+
+void GroupCorrelator::expire(int64_t time)
+{
+    for (auto& pending : m_Table)
+    {
+        if (pending.inUse && time - pending.group.firstSeen > m_Timeout)
+        {
+            pending.inUse = false;
+            ++m_Expired;
+        }
+    }
+}
+
+GroupCorrelator::Pending* GroupCorrelator::find(uint32_t groupId, SourceId source)
+{
+    for (size_t i = 0; i < maxProbes; ++i)
+    {
+        auto& pending = m_Table[(groupId + i) & m_Mask];
+
+        if (pending.inUse && pending.group.groupId == groupId &&
+            (source == noSource || pending.group.source == noSource || pending.group.source == source))
+            return &pending;
+    }
+
+    return nullptr;
+}
+
+GroupCorrelator::Pending* GroupCorrelator::allocate(uint32_t groupId, int64_t time)
+{
+    Pending* slot = nullptr;
+
+    for (size_t i = 0; i < maxProbes; ++i)
+    {
+        auto& pending = m_Table[(groupId + i) & m_Mask];
+
+        if (!pending.inUse)
+        {
+            slot = &pending;
+            break;
+        }
+
+        if (time - pending.group.firstSeen > m_Timeout)
+        {
+            pending.inUse = false;
+            ++m_Expired;
+            slot = &pending;
+            break;
+        }
+
+        if (slot == nullptr || pending.group.firstSeen < slot->group.firstSeen)
+            slot = &pending;
+    }
+
+    // Evict the oldest incomplete group if all the probed slots are in use
+    if (slot->inUse)
+        ++m_Expired;
+
+    slot->inUse = true;
+    slot->received = 0;
+    slot->group.groupId = groupId;
+    slot->group.firstSeen = time;
+    slot->group.members.fill({});
+
+    return slot;
+}
+
+void GroupCorrelator::deliver(Pending& pending)
+{
+    for (const auto& subscriber : m_Subscribers)
+        subscriber(pending.group);
+
+    pending.inUse = false;
+    ++m_Completed;
+}
@@ -0,0 +1,94 @@
+﻿#pragma once
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <string_view>
+#include <vector>
+
+#include "SourceInterner.h"
+
+class Nmea;
+
+/// <summary>
+///        Collects the lines of a tag block sentence group (g:) and delivers each complete group in one callback.
+/// </summary>
+/// A group is identified by the group id and the source. Only the first line of a group needs to carry the s: parameter,
+/// the following lines are matched by group id unless they carry a different source.
+/// The lines are not copied. The caller shall keep the characters of each line alive until the group is delivered
+/// or expired, e.g. by parsing directly from a read buffer or a memory mapped file.
+class GroupCorrelator
+{
+public:
+    /// The maximum number of lines in a group
+    static const size_t maxMembers = 8;
+
+    /// <summary>
+    ///        A complete sentence group.
+    /// </summary>
+    struct SentenceGroup
+    {
+        uint32_t         groupId;
+        SourceId         source;     ///< The s: parameter of the group, or noSource
+        int64_t          firstSeen;  ///< The time of the first received line
+        uint32_t         size;       ///< The number of lines in the group
+        std::array<std::string_view, maxMembers> members; ///< The lines ordered by sentence number
+    };
+
+    typedef std::function<void(const SentenceGroup&)> Subscriber;
+
+    /// <summary>
+    ///        Creates an empty correlator.
+    /// </summary>
+    /// \param capacity [in] The maximum number of incomplete groups, rounded up to a power of two.
+    /// \param timeout [in] How long an incomplete group is kept, in the unit of the time given to add.
+    GroupCorrelator(size_t capacity = 64, int64_t timeout = 2);
+    ~GroupCorrelator();
+
+    /// <summary>
+    ///        Adds a subscriber that is called with each complete group.
+    /// </summary>
+    void subscribe(Subscriber subscriber);
+
+    /// <summary>
+    ///        Adds a line to its group, and delivers the group to the subscribers if it is complete.
+    /// </summary>
+    /// \param line [in] The line given to nmea.parse.
+    /// \param nmea [in] The parser, after a successful parse of the line.
+    /// \param time [in] The time of reception, e.g. in seconds.
+    /// \return true if the line is a member of a sentence group, otherwise false
+    bool add(std::string_view line, const Nmea& nmea, int64_t time);
+
+    /// <summary>
+    ///        Drops the incomplete groups that are older than the timeout.
+    /// </summary>
+    void expire(int64_t time);
+
+    /// The number of groups delivered to the subscribers
+    uint64_t completed() const { return m_Completed; }
+
+    /// The number of incomplete groups dropped, by timeout or because the table was full
+    uint64_t expired() const { return m_Expired; }
+
+private:
+    // The number of consecutive slots searched for a group
+    static const size_t maxProbes = 8;
+
+    struct Pending
+    {
+        bool          inUse;
+        uint32_t      received;  // Bit i is set when sentence number i + 1 has been received
+        SentenceGroup group;
+    };
+
+    Pending* find(uint32_t groupId, SourceId source);
+    Pending* allocate(uint32_t groupId, int64_t time);
+    void deliver(Pending& pending);
+
+    std::vector<Pending>    m_Table;
+    size_t                  m_Mask;
+    int64_t                 m_Timeout;
+    std::vector<Subscriber> m_Subscribers;
+    uint64_t                m_Completed;
+    uint64_t                m_Expired;
+};
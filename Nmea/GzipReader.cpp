@@ -0,0 +1,226 @@
+﻿#include "GzipReader.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <stdexcept>
+#include <system_error>
+
+#if __has_include(<zlib.h>)
+#include <zlib.h>
+#define NMEA_ZLIB 1
+#else
+#define NMEA_ZLIB 0
+#endif
+
+#if NMEA_ZLIB
+
+struct GzipReader::Inflater
+{
+    explicit Inflater(FILE* f) :
+        file(f), stream(), input(std::make_unique<unsigned char[]>(inputSize)), finished(false), compressed(0), decompressed(0)
+    {
+        // 15 + 32: the largest window, and detection of gzip and zlib headers
+        if (::inflateInit2(&stream, 15 + 32) != Z_OK)
+            throw std::runtime_error("inflateInit2");
+    }
+
+    ~Inflater()
+    {
+        ::inflateEnd(&stream);
+        std::fclose(file);
+    }
+
+    // Fills a buffer, returns the number of bytes, 0 at the end of the file
+    size_t inflate(char* buffer, size_t size)
+    {
+        stream.next_out = reinterpret_cast<unsigned char*>(buffer);
+        stream.avail_out = static_cast<uInt>(size);
+
+        while (stream.avail_out > 0)
+        {
+            if (stream.avail_in == 0)
+            {
+                const size_t count = std::fread(input.get(), 1, inputSize, file);
+                if (count == 0)
+                {
+                    if (std::ferror(file))
+                        throw std::system_error(errno, std::generic_category(), "fread");
+                    if (!finished)
+                        throw std::runtime_error("Truncated gzip file");
+                    break;
+                }
+
+                stream.next_in = input.get();
+                stream.avail_in = static_cast<uInt>(count);
+                compressed.fetch_add(count, std::memory_order_relaxed);
+            }
+
+            if (finished)
+            {
+                // Another member follows
+                ::inflateReset(&stream);
+                finished = false;
+            }
+
+            const int result = ::inflate(&stream, Z_NO_FLUSH);
+            if (result == Z_STREAM_END)
+                finished = true;
+            else if (result != Z_OK)
+                throw std::runtime_error(stream.msg != nullptr ? stream.msg : "Invalid gzip file");
+        }
+
+        const size_t count = size - stream.avail_out;
+        decompressed.fetch_add(count, std::memory_order_relaxed);
+        return count;
+    }
+
+    static const size_t inputSize = 256 * 1024;
+
+    FILE*                            file;
+    z_stream                         stream;
+    std::unique_ptr<unsigned char[]> input;
+    bool                             finished;  // The end of a member has been reached
+    std::atomic<uint64_t>            compressed;
+    std::atomic<uint64_t>            decompressed;
+};
+
+#else
+
+struct GzipReader::Inflater
+{
+    size_t inflate(char*, size_t) { return 0; }
+
+    std::atomic<uint64_t> compressed;
+    std::atomic<uint64_t> decompressed;
+};
+
+#endif
+
+GzipReader::GzipReader(const std::string& path, size_t bufferSize) :
+    m_Inflater(),
+    m_BufferSize(bufferSize),
+    m_Buffers{ { std::make_unique<char[]>(bufferSize), 0, false }, { std::make_unique<char[]>(bufferSize), 0, false } },
+    m_Reading(0),
+    m_Handed(false),
+    m_End(false),
+    m_Stopping(false),
+    m_Error(),
+    m_Mutex(),
+    m_Changed(),
+    m_Thread()
+{
+#if NMEA_ZLIB
+    FILE* file = std::fopen(path.c_str(), "rb");
+    if (file == nullptr)
+        throw std::system_error(errno, std::generic_category(), "fopen");
+
+    try
+    {
+        m_Inflater = std::make_unique<Inflater>(file);
+    }
+    catch (...)
+    {
+        std::fclose(file);
+        throw;
+    }
+
+    m_Thread = std::thread(&GzipReader::decompress, this);
+#else
+    throw std::system_error(std::make_error_code(std::errc::not_supported), "zlib");
+#endif
+}
+
+GzipReader::~GzipReader()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Stopping = true;
+    }
+    m_Changed.notify_all();
+
+    if (m_Thread.joinable())
+        m_Thread.join();
+}
+
+bool GzipReader::available() noexcept
+{
+    return NMEA_ZLIB != 0;
+}
+
+bool GzipReader::next(std::string_view& block)
+{
+    std::unique_lock<std::mutex> lock(m_Mutex);
+
+    if (m_Handed)
+    {
+        // Give the previous block back
+        m_Buffers[m_Reading].full = false;
+        m_Reading = 1 - m_Reading;
+        m_Handed = false;
+        m_Changed.notify_all();
+    }
+
+    auto& buffer = m_Buffers[m_Reading];
+    m_Changed.wait(lock, [&] { return buffer.full || m_End || m_Error; });
+
+    if (!buffer.full)
+    {
+        if (m_Error)
+            std::rethrow_exception(m_Error);
+        return false;
+    }
+
+    m_Handed = true;
+    block = std::string_view(buffer.data.get(), buffer.size);
+    return true;
+}
+
+uint64_t GzipReader::compressedBytes() const
+{
+    return m_Inflater ? m_Inflater->compressed.load(std::memory_order_relaxed) : 0;
+}
+
+uint64_t GzipReader::decompressedBytes() const
+{
+    return m_Inflater ? m_Inflater->decompressed.load(std::memory_order_relaxed) : 0;
+}
+
+// Fills the two buffers in turn, waiting while the caller has both
+void GzipReader::decompress()
+{
+    try
+    {
+        for (size_t writing = 0;; writing = 1 - writing)
+        {
+            auto& buffer = m_Buffers[writing];
+            {
+                std::unique_lock<std::mutex> lock(m_Mutex);
+                m_Changed.wait(lock, [&] { return !buffer.full || m_Stopping; });
+                if (m_Stopping)
+                    return;
+            }
+
+            // Not under the lock, the caller works on the other buffer meanwhile
+            const size_t size = m_Inflater->inflate(buffer.data.get(), m_BufferSize);
+
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            if (size == 0)
+            {
+                m_End = true;
+                m_Changed.notify_all();
+                return;
+            }
+
+            buffer.size = size;
+            buffer.full = true;
+            m_Changed.notify_all();
+        }
+    }
+    catch (...)
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Error = std::current_exception();
+        m_Changed.notify_all();
+    }
+}
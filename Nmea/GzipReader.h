@@ -0,0 +1,98 @@
+﻿#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include "LineFramer.h"
+
+/// <summary>
+///        Reads the lines of a gzip compressed file, decompressing on a separate thread.
+/// </summary>
+/// The decompressor fills one of two buffers while the caller frames and parses the other, so only two buffers of the
+/// decompressed file are in memory at a time. Concatenated gzip members and zlib streams are read as one stream.
+/// \note Needs zlib, without it the constructor throws.
+class GzipReader
+{
+public:
+    /// <summary>
+    ///        Opens the file and starts decompressing.
+    /// </summary>
+    /// \param path [in] The compressed file.
+    /// \param bufferSize [in] The size of each of the two decompressed buffers.
+    /// \exception std::system_error if the file can't be opened, or zlib is not available
+    explicit GzipReader(const std::string& path, size_t bufferSize = 1 << 20);
+
+    /// <summary>
+    ///        Stops the decompressor and closes the file.
+    /// </summary>
+    ~GzipReader();
+
+    GzipReader(const GzipReader&) = delete;
+    GzipReader& operator=(const GzipReader&) = delete;
+
+    /// <summary>
+    ///        true if the library was built with zlib.
+    /// </summary>
+    static bool available() noexcept;
+
+    /// <summary>
+    ///        Hands over the next block of decompressed bytes, and gives the previous block back to the decompressor.
+    /// </summary>
+    /// \param block [out] The bytes, valid until the next call.
+    /// \return false at the end of the file
+    /// \exception std::runtime_error if the file is not a valid gzip file
+    bool next(std::string_view& block);
+
+    /// <summary>
+    ///        Hands out each line of the file, including its CR LF.
+    /// </summary>
+    /// The lines are framed in place in the decompressed buffers, only a line split between two buffers is copied.
+    /// \param handler [in] Called with each line. The view is valid until the handler returns.
+    template<typename Handler>
+    void forEachLine(Handler&& handler)
+    {
+        LineFramer framer;
+        std::string_view block;
+
+        while (next(block))
+            framer.feed(block, handler);
+
+        framer.finish(handler);
+    }
+
+    /// The number of compressed bytes read so far
+    uint64_t compressedBytes() const;
+
+    /// The number of bytes decompressed so far
+    uint64_t decompressedBytes() const;
+
+private:
+    struct Inflater;
+
+    void decompress();
+
+    struct Buffer
+    {
+        std::unique_ptr<char[]> data;
+        size_t                  size;
+        bool                    full;
+    };
+
+    std::unique_ptr<Inflater> m_Inflater;
+    size_t                    m_BufferSize;
+    Buffer                    m_Buffers[2];
+    size_t                    m_Reading;     // The buffer handed to the caller
+    bool                      m_Handed;      // The caller has the buffer m_Reading
+    bool                      m_End;         // The decompressor has filled its last buffer
+    bool                      m_Stopping;
+    std::exception_ptr        m_Error;
+    mutable std::mutex        m_Mutex;
+    std::condition_variable   m_Changed;
+    std::thread               m_Thread;
+};
@@ -0,0 +1,10 @@
+﻿#pragma once
+
+#include <string_view>
+
+struct IReplaySink
+{
+    virtual ~IReplaySink() {}
+
+    virtual void emit(std::string_view line) = 0;
+};
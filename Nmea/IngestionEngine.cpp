@@ -0,0 +1,865 @@
+﻿#include "IngestionEngine.h"
+
+#if defined(__linux__)
+
+#include <algorithm>
+#include <cerrno>
+#include <ctime>
+#include <future>
+#include <mutex>
+#include <system_error>
+#include <unordered_map>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "LineFramer.h"
+#include "Probes.h"
+#include "StageProfiler.h"
+#include "TraceRecorder.h"
+#include "UdpReceiver.h"
+#include "Uring.h"
+
+namespace
+{
+    // The maximum number of reads from one source per wakeup, so a busy source can't starve the others
+    const int readsPerEvent = 16;
+
+    const int udpReceiveBuffer = 4 * 1024 * 1024;
+
+    [[noreturn]] void throwSystemError(const char* what)
+    {
+        throw std::system_error(errno, std::generic_category(), what);
+    }
+
+    void setNonBlocking(int fd, bool nonBlocking = true)
+    {
+        const int flags = ::fcntl(fd, F_GETFL, 0);
+        if (flags < 0 || ::fcntl(fd, F_SETFL, nonBlocking ? flags | O_NONBLOCK : flags & ~O_NONBLOCK) < 0)
+            throwSystemError("fcntl");
+    }
+
+    // The user data of io_uring requests that are not reads of a source
+    const uint64_t epollReady = 1;
+    const uint64_t cancelled = 2;
+
+    std::unique_ptr<Uring> makeUring(IngestionEngine::Backend backend)
+    {
+        if (backend == IngestionEngine::Backend::uring && Uring::available())
+        {
+            try
+            {
+                return std::make_unique<Uring>();
+            }
+            catch (const std::system_error&)
+            {
+                // E.g. out of locked memory, fall back to epoll
+            }
+        }
+
+        return nullptr;
+    }
+
+    speed_t toSpeed(unsigned baudRate)
+    {
+        switch (baudRate)
+        {
+        case 4800: return B4800;
+        case 9600: return B9600;
+        case 19200: return B19200;
+        case 38400: return B38400;
+        case 57600: return B57600;
+        case 115200: return B115200;
+        }
+
+        errno = EINVAL;
+        throwSystemError("baud rate");
+    }
+
+    int64_t now() noexcept
+    {
+        timespec time;
+        ::clock_gettime(CLOCK_REALTIME, &time);
+        return static_cast<int64_t>(time.tv_sec) * 1000000000 + time.tv_nsec;
+    }
+}
+
+class IngestionEngine::Loop
+{
+public:
+    Loop(const LineHandler& handler, Backend backend) :
+        m_Handler(handler),
+        m_Epoll(::epoll_create1(EPOLL_CLOEXEC)),
+        m_Wakeup(::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)),
+        m_Thread(),
+        m_Running(false),
+        m_Mutex(),
+        m_Sources(),
+        m_Commands(),
+        m_Graveyard(),
+        m_Files(),
+        m_Receiver(),
+        m_Uring(makeUring(backend)),
+        m_EpollPolled(false)
+    {
+        if (m_Epoll < 0 || m_Wakeup < 0)
+            throwSystemError("epoll");
+
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.ptr = nullptr; // The wakeup descriptor
+        ::epoll_ctl(m_Epoll, EPOLL_CTL_ADD, m_Wakeup, &event);
+    }
+
+    ~Loop()
+    {
+        stop();
+
+        std::vector<SourceId> ids;
+        for (auto& [id, source] : m_Sources)
+            ids.push_back(id);
+        for (SourceId id : ids)
+            close(id);
+
+        // The kernel may still write into the framers of sources with reads in flight
+        while (!m_Graveyard.empty() && m_Uring)
+        {
+            m_Uring->wait();
+            m_Uring->complete([this](const io_uring_cqe& cqe) { completed(cqe); });
+            bury();
+        }
+
+        ::close(m_Wakeup);
+        ::close(m_Epoll);
+    }
+
+    void start()
+    {
+        if (!m_Running.exchange(true))
+            m_Thread = std::thread(&Loop::run, this);
+    }
+
+    void stop()
+    {
+        if (m_Running.exchange(false))
+        {
+            wakeup();
+            m_Thread.join();
+        }
+    }
+
+    Backend backend() const
+    {
+        return m_Uring ? Backend::uring : Backend::epoll;
+    }
+
+    void add(SourceId id, int fd, bool datagram)
+    {
+        struct stat status{};
+        ::fstat(fd, &status);
+
+        auto source = std::make_unique<Source>(id, fd, datagram);
+        source->socket = S_ISSOCK(status.st_mode);
+        source->file = S_ISREG(status.st_mode);
+        Source& added = *source;
+
+        std::lock_guard<std::mutex> lock(m_Mutex);
+
+        if (m_Uring && !datagram)
+        {
+            // io_uring waits for the data itself, a non-blocking descriptor would fail with EAGAIN instead
+            setNonBlocking(fd, false);
+            m_Sources[id] = std::move(source);
+            arm(added);
+            m_Uring->submit();
+        }
+        else if (added.file)
+        {
+            // Regular files can't be waited for with epoll, they are read whenever the loop is idle
+            m_Sources[id] = std::move(source);
+            m_Files.push_back(&added);
+            wakeup();
+        }
+        else
+        {
+            epoll_event event{};
+            event.events = EPOLLIN | EPOLLRDHUP;
+            event.data.ptr = &added;
+
+            if (::epoll_ctl(m_Epoll, EPOLL_CTL_ADD, fd, &event) < 0)
+            {
+                ::close(fd);
+                throwSystemError("epoll_ctl");
+            }
+
+            m_Sources[id] = std::move(source);
+        }
+    }
+
+    bool owns(SourceId id) const
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        return m_Sources.count(id) != 0;
+    }
+
+    bool remove(SourceId id)
+    {
+        if (!owns(id))
+            return false;
+
+        if (!m_Running || std::this_thread::get_id() == m_Thread.get_id())
+        {
+            close(id);
+            if (!m_Running)
+                bury();
+
+            return true;
+        }
+
+        // Let the loop close the source between two events, and wait for it
+        std::promise<void> done;
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Commands.push_back([this, id, &done] { close(id); done.set_value(); });
+        }
+        wakeup();
+        done.get_future().wait();
+
+        return true;
+    }
+
+    bool statistics(SourceId id, Statistics& statistics) const
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+
+        const auto found = m_Sources.find(id);
+        if (found == m_Sources.end())
+            return false;
+
+        const auto& source = *found->second;
+        statistics.bytes = source.bytes.load(std::memory_order_relaxed);
+        statistics.lines = source.lines.load(std::memory_order_relaxed);
+        statistics.overlong = source.overlong.load(std::memory_order_relaxed);
+        return true;
+    }
+
+private:
+    struct Source
+    {
+        // Datagrams are framed in the buffers of the UdpReceiver
+        Source(SourceId i, int f, bool d) :
+            id(i), fd(f), datagram(d), socket(false), file(false), closed(false), multishot(true), pending(0),
+            framer(d ? 0 : 16384), bytes(0), lines(0), overlong(0)
+        {
+        }
+
+        SourceId              id;
+        int                   fd;
+        bool                  datagram;
+        bool                  socket;
+        bool                  file;
+        bool                  closed;
+        bool                  multishot;  // Cleared if the kernel does not support multishot receives
+        unsigned              pending;    // io_uring requests in flight
+        LineFramer            framer;
+        std::atomic<uint64_t> bytes;
+        std::atomic<uint64_t> lines;
+        std::atomic<uint64_t> overlong;
+    };
+
+    void wakeup()
+    {
+        const uint64_t one = 1;
+        [[maybe_unused]] auto written = ::write(m_Wakeup, &one, sizeof(one));
+    }
+
+    // Closes a source. The source itself is kept until the current batch of events is handled.
+    void close(SourceId id)
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+
+        const auto found = m_Sources.find(id);
+        if (found == m_Sources.end())
+            return;
+
+        auto& source = *found->second;
+        if (source.pending > 0)
+        {
+            m_Uring->enqueue([&](io_uring_sqe& sqe) {
+                sqe.opcode = IORING_OP_ASYNC_CANCEL;
+                sqe.fd = -1;
+                sqe.addr = reinterpret_cast<uint64_t>(&source);
+                sqe.cancel_flags = IORING_ASYNC_CANCEL_ALL;
+                sqe.user_data = cancelled;
+            });
+            m_Uring->submit();
+        }
+        else if (source.file && !m_Uring)
+        {
+            m_Files.erase(std::find(m_Files.begin(), m_Files.end(), &source));
+        }
+        else
+        {
+            ::epoll_ctl(m_Epoll, EPOLL_CTL_DEL, source.fd, nullptr);
+        }
+        ::close(source.fd);
+        source.closed = true;
+
+        m_Graveyard.push_back(std::move(found->second));
+        m_Sources.erase(found);
+    }
+
+    // Frees the closed sources without io_uring requests in flight
+    void bury()
+    {
+        std::erase_if(m_Graveyard, [](const std::unique_ptr<Source>& source) { return source->pending == 0; });
+    }
+
+    void run()
+    {
+        TraceRecorder::setThreadName("ingestion loop");
+
+        if (m_Uring)
+            runUring();
+        else
+            runEpoll();
+    }
+
+    void runEpoll()
+    {
+        while (m_Running.load(std::memory_order_relaxed))
+        {
+            bool files;
+            {
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                files = !m_Files.empty();
+            }
+
+            handleEvents(files ? 0 : -1);
+            if (files)
+                readFiles();
+
+            bury();
+        }
+    }
+
+    void handleEvents(int timeout)
+    {
+        const int maxEvents = 64;
+        epoll_event events[maxEvents];
+
+        const int count = ::epoll_wait(m_Epoll, events, maxEvents, timeout);
+
+        for (int i = 0; i < count; ++i)
+        {
+            auto source = static_cast<Source*>(events[i].data.ptr);
+            if (source == nullptr)
+                runCommands();
+            else if (!source->closed)
+                read(*source);
+        }
+    }
+
+    void readFiles()
+    {
+        std::vector<Source*> files;
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            files = m_Files;
+        }
+
+        for (auto file : files)
+            if (!file->closed)
+                readStream(*file);
+    }
+
+    // The streams are read by io_uring, the datagrams and the wakeup are still handled by epoll
+    void runUring()
+    {
+        pollEpoll();
+
+        while (m_Running.load(std::memory_order_relaxed))
+        {
+            m_Uring->wait();
+            m_Uring->complete([this](const io_uring_cqe& cqe) { completed(cqe); });
+            bury();
+        }
+    }
+
+    void pollEpoll()
+    {
+        if (m_EpollPolled)
+            return;
+
+        // A single shot poll reports an epoll descriptor that is still ready when it is armed again
+        m_EpollPolled = true;
+        m_Uring->enqueue([this](io_uring_sqe& sqe) {
+            sqe.opcode = IORING_OP_POLL_ADD;
+            sqe.fd = m_Epoll;
+            sqe.poll32_events = POLLIN;
+            sqe.user_data = epollReady;
+        });
+    }
+
+    // Asks io_uring for the next data of a stream
+    void arm(Source& source)
+    {
+        ++source.pending;
+
+        if (source.socket)
+        {
+            // Received into a provided buffer, and framed from there
+            m_Uring->enqueue([&](io_uring_sqe& sqe) {
+                sqe.opcode = IORING_OP_RECV;
+                sqe.fd = source.fd;
+                sqe.flags = IOSQE_BUFFER_SELECT;
+                sqe.buf_group = Uring::bufferGroup;
+                sqe.ioprio = source.multishot ? IORING_RECV_MULTISHOT : 0;
+                sqe.user_data = reinterpret_cast<uint64_t>(&source);
+            });
+        }
+        else
+        {
+            // Read straight into the framer, at the file position
+            m_Uring->enqueue([&](io_uring_sqe& sqe) {
+                sqe.opcode = IORING_OP_READ;
+                sqe.fd = source.fd;
+                sqe.addr = reinterpret_cast<uint64_t>(source.framer.writePosition());
+                sqe.len = static_cast<uint32_t>(source.framer.writeSpace());
+                sqe.off = static_cast<uint64_t>(-1);
+                sqe.user_data = reinterpret_cast<uint64_t>(&source);
+            });
+        }
+    }
+
+    void completed(const io_uring_cqe& cqe)
+    {
+        if (cqe.user_data == epollReady)
+        {
+            m_EpollPolled = false;
+            handleEvents(0);
+            if (m_Running.load(std::memory_order_relaxed))
+                pollEpoll();
+            return;
+        }
+
+        if (cqe.user_data == cancelled)
+            return;
+
+        auto& source = *reinterpret_cast<Source*>(cqe.user_data);
+        const bool more = (cqe.flags & IORING_CQE_F_MORE) != 0;
+        if (!more)
+            --source.pending;
+
+        if (cqe.res > 0)
+        {
+            const LineOrigin origin{ source.id, now() };
+            StageProfiler::HandlerTimer timer;
+            TraceRecorder::HandlerSpans spans;
+            auto handler = [&](std::string_view line) {
+                source.lines.fetch_add(1, std::memory_order_relaxed);
+                timer.framed();
+                spans.framed();
+                NMEA_PROBE2(dispatch_start, origin.source, line.size());
+                m_Handler(origin, line);
+                NMEA_PROBE1(dispatch_end, origin.source);
+                timer.handled(origin.source);
+                spans.handled();
+            };
+
+            source.bytes.fetch_add(static_cast<uint64_t>(cqe.res), std::memory_order_relaxed);
+            timer.begin();
+            spans.begin(origin.source);
+            if (cqe.flags & IORING_CQE_F_BUFFER)
+            {
+                if (!source.closed)
+                    source.framer.feed(m_Uring->buffer(cqe.flags, cqe.res), handler);
+                m_Uring->recycle(cqe.flags);
+            }
+            else if (!source.closed)
+            {
+                source.framer.commit(static_cast<size_t>(cqe.res));
+                source.framer.drain(handler);
+            }
+            source.overlong.store(source.framer.overlong(), std::memory_order_relaxed);
+
+            if (!more && !source.closed)
+                arm(source);
+        }
+        else if (cqe.res == -ENOBUFS || cqe.res == -EAGAIN || cqe.res == -EINTR || cqe.res == -ECANCELED)
+        {
+            // All provided buffers in use, interrupted, or cancelled because the submitting thread exited
+            if (!more && !source.closed)
+                arm(source);
+        }
+        else if (cqe.res == -EINVAL && source.multishot && source.socket)
+        {
+            // Multishot receives need Linux 6.0
+            source.multishot = false;
+            if (!source.closed)
+                arm(source);
+        }
+        else if (!source.closed)
+        {
+            // End of stream or error, a stream may end without LF after its last line
+            if (cqe.res == 0)
+            {
+                source.framer.finish([&](std::string_view line) {
+                    source.lines.fetch_add(1, std::memory_order_relaxed);
+                    m_Handler(LineOrigin{ source.id, now() }, line);
+                });
+            }
+            close(source.id);
+        }
+    }
+
+    void runCommands()
+    {
+        uint64_t value;
+        [[maybe_unused]] auto received = ::read(m_Wakeup, &value, sizeof(value));
+
+        std::vector<std::function<void()>> commands;
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            commands.swap(m_Commands);
+        }
+
+        for (auto& command : commands)
+            command();
+    }
+
+    void read(Source& source)
+    {
+        if (source.datagram)
+            receive(source);
+        else
+            readStream(source);
+    }
+
+    void receive(Source& source)
+    {
+        for (int i = 0; i < readsPerEvent; ++i)
+        {
+            size_t count = 0;
+            try
+            {
+                TraceRecorder::Span span("read", source.id);
+                count = m_Receiver.receive(source.fd);
+            }
+            catch (const std::system_error&)
+            {
+                close(source.id);
+            }
+            if (count == 0)
+                break;
+
+            for (size_t j = 0; j < count; ++j)
+            {
+                const auto datagram = m_Receiver.datagram(j);
+                source.bytes.fetch_add(datagram.size(), std::memory_order_relaxed);
+
+                if (m_Receiver.truncated(j))
+                {
+                    source.overlong.fetch_add(datagram.size(), std::memory_order_relaxed);
+                    continue;
+                }
+
+                const LineOrigin origin{ source.id, m_Receiver.receiveTime(j) };
+                StageProfiler::HandlerTimer timer;
+                TraceRecorder::HandlerSpans spans;
+                timer.begin();
+                spans.begin(origin.source);
+                if (TraceRecorder::recording() && origin.receiveTime != 0)
+                    TraceRecorder::record("socket queue", origin.receiveTime, TraceRecorder::now(), origin.source);
+                LineFramer::split(datagram, [&](std::string_view line) {
+                    source.lines.fetch_add(1, std::memory_order_relaxed);
+                    timer.framed();
+                    spans.framed();
+                    NMEA_PROBE2(dispatch_start, origin.source, line.size());
+                    m_Handler(origin, line);
+                    NMEA_PROBE1(dispatch_end, origin.source);
+                    timer.handled(origin.source);
+                    spans.handled();
+                });
+            }
+        }
+    }
+
+    void readStream(Source& source)
+    {
+        LineOrigin origin{ source.id, 0 };
+        StageProfiler::HandlerTimer timer;
+        TraceRecorder::HandlerSpans spans;
+        auto handler = [&](std::string_view line) {
+            source.lines.fetch_add(1, std::memory_order_relaxed);
+            timer.framed();
+            spans.framed();
+            NMEA_PROBE2(dispatch_start, origin.source, line.size());
+            m_Handler(origin, line);
+            NMEA_PROBE1(dispatch_end, origin.source);
+            timer.handled(origin.source);
+            spans.handled();
+        };
+
+        for (int i = 0; i < readsPerEvent && !source.closed; ++i)
+        {
+            auto& framer = source.framer;
+            ssize_t count;
+            {
+                TraceRecorder::Span span("read", source.id);
+                count = ::read(source.fd, framer.writePosition(), framer.writeSpace());
+            }
+
+            if (count > 0)
+            {
+                // Lines completed by this read are stamped with its time
+                origin.receiveTime = now();
+                framer.commit(static_cast<size_t>(count));
+                source.bytes.fetch_add(static_cast<uint64_t>(count), std::memory_order_relaxed);
+                timer.begin();
+                spans.begin(origin.source);
+                framer.drain(handler);
+                source.overlong.store(framer.overlong(), std::memory_order_relaxed);
+            }
+            else if (count < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            else if (count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            {
+                break;
+            }
+            else
+            {
+                // End of stream or error, a stream may end without LF after its last line
+                if (count == 0)
+                {
+                    timer.begin();
+                    spans.begin(origin.source);
+                    framer.finish(handler);
+                }
+                close(source.id);
+            }
+        }
+    }
+
+    const LineHandler&                                     m_Handler;
+    int                                                    m_Epoll;
+    int                                                    m_Wakeup;
+    std::thread                                            m_Thread;
+    std::atomic<bool>                                      m_Running;
+    mutable std::mutex                                     m_Mutex;
+    std::unordered_map<SourceId, std::unique_ptr<Source>> m_Sources;
+    std::vector<std::function<void()>>                     m_Commands;
+    std::vector<std::unique_ptr<Source>>                   m_Graveyard;
+    std::vector<Source*>                                   m_Files;     // Regular files, read when idle without io_uring
+    UdpReceiver                                            m_Receiver;  // Shared by the UDP sources of the loop
+    std::unique_ptr<Uring>                                 m_Uring;     // Reads the streams, if the backend is io_uring
+    bool                                                   m_EpollPolled;
+};
+
+IngestionEngine::IngestionEngine(LineHandler handler, size_t loops, SourceInterner& interner, Backend backend) :
+    m_Handler(std::move(handler)),
+    m_Interner(interner),
+    m_Loops(),
+    m_NextLoop(0)
+{
+    for (size_t i = 0; i < (loops == 0 ? 1 : loops); ++i)
+        m_Loops.push_back(std::make_unique<Loop>(m_Handler, backend));
+}
+
+IngestionEngine::~IngestionEngine()
+{
+    stop();
+}
+
+IngestionEngine::Backend IngestionEngine::backend() const
+{
+    return m_Loops.front()->backend();
+}
+
+void IngestionEngine::start()
+{
+    for (auto& loop : m_Loops)
+        loop->start();
+}
+
+void IngestionEngine::stop()
+{
+    for (auto& loop : m_Loops)
+        loop->stop();
+}
+
+SourceId IngestionEngine::addUdpSource(std::string_view name, uint16_t port, const std::string& address)
+{
+    const int fd = ::socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        throwSystemError("socket");
+
+    const int on = 1;
+    ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+    // Room for bursts while the loop is busy with other sources, limited by net.core.rmem_max
+    const int receiveBuffer = udpReceiveBuffer;
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &receiveBuffer, sizeof(receiveBuffer));
+
+    sockaddr_in local{};
+    local.sin_family = AF_INET;
+    local.sin_port = htons(port);
+    if (::inet_pton(AF_INET, address.c_str(), &local.sin_addr) != 1)
+    {
+        ::close(fd);
+        errno = EINVAL;
+        throwSystemError("address");
+    }
+
+    const bool multicast = IN_MULTICAST(ntohl(local.sin_addr.s_addr));
+    if (multicast)
+    {
+        ip_mreq membership{};
+        membership.imr_multiaddr = local.sin_addr;
+        membership.imr_interface.s_addr = htonl(INADDR_ANY);
+        ::setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &membership, sizeof(membership));
+    }
+
+    if (::bind(fd, reinterpret_cast<sockaddr*>(&local), sizeof(local)) < 0)
+    {
+        const int error = errno;
+        ::close(fd);
+        errno = error;
+        throwSystemError("bind");
+    }
+
+    UdpReceiver::enableTimestamps(fd);
+    setNonBlocking(fd);
+    return add(name, fd, true);
+}
+
+SourceId IngestionEngine::addTcpSource(std::string_view name, const std::string& host, uint16_t port)
+{
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    addrinfo* addresses = nullptr;
+    const std::string service = std::to_string(port);
+    if (::getaddrinfo(host.c_str(), service.c_str(), &hints, &addresses) != 0)
+    {
+        errno = EHOSTUNREACH;
+        throwSystemError("getaddrinfo");
+    }
+
+    int fd = -1;
+    for (auto address = addresses; address != nullptr && fd < 0; address = address->ai_next)
+    {
+        fd = ::socket(address->ai_family, address->ai_socktype | SOCK_CLOEXEC, address->ai_protocol);
+        if (fd >= 0 && ::connect(fd, address->ai_addr, address->ai_addrlen) < 0)
+        {
+            ::close(fd);
+            fd = -1;
+        }
+    }
+    ::freeaddrinfo(addresses);
+
+    if (fd < 0)
+        throwSystemError("connect");
+
+    setNonBlocking(fd);
+    return add(name, fd, false);
+}
+
+SourceId IngestionEngine::addSerialSource(std::string_view name, const std::string& device, unsigned baudRate)
+{
+    const int fd = ::open(device.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0)
+        throwSystemError("open");
+
+    if (baudRate != 0)
+    {
+        termios settings{};
+        if (::tcgetattr(fd, &settings) == 0)
+        {
+            ::cfmakeraw(&settings);
+            settings.c_cflag |= CLOCAL | CREAD;
+            const speed_t speed = toSpeed(baudRate);
+            ::cfsetispeed(&settings, speed);
+            ::cfsetospeed(&settings, speed);
+            ::tcsetattr(fd, TCSANOW, &settings);
+        }
+    }
+
+    return add(name, fd, false);
+}
+
+SourceId IngestionEngine::addFile(std::string_view name, const std::string& path)
+{
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        throwSystemError("open");
+
+    return add(name, fd, false);
+}
+
+SourceId IngestionEngine::addDescriptor(std::string_view name, int fd)
+{
+    setNonBlocking(fd);
+    return add(name, fd, false);
+}
+
+bool IngestionEngine::removeSource(SourceId source)
+{
+    for (auto& loop : m_Loops)
+        if (loop->remove(source))
+            return true;
+
+    return false;
+}
+
+IngestionEngine::Statistics IngestionEngine::statistics(SourceId source) const
+{
+    Statistics statistics{};
+
+    for (auto& loop : m_Loops)
+        if (loop->statistics(source, statistics))
+            break;
+
+    return statistics;
+}
+
+SourceId IngestionEngine::add(std::string_view name, int fd, bool datagram)
+{
+    const SourceId id = m_Interner.intern(name);
+    if (id == noSource)
+    {
+        ::close(fd);
+        errno = EINVAL;
+        throwSystemError("source name");
+    }
+
+    for (auto& loop : m_Loops)
+    {
+        if (loop->owns(id))
+        {
+            ::close(fd);
+            errno = EEXIST;
+            throwSystemError("source name");
+        }
+    }
+
+    // Spread the sources evenly over the loops
+    auto& loop = m_Loops[m_NextLoop++ % m_Loops.size()];
+    loop->add(id, fd, datagram);
+
+    return id;
+}
+
+#endif
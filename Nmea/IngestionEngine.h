@@ -0,0 +1,148 @@
+﻿#pragma once
+
+#if defined(__linux__)
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "LineOrigin.h"
+
+/// <summary>
+///        Reads lines from many UDP, TCP, serial and file sources on a few epoll or io_uring event loop threads.
+/// </summary>
+/// Each source has its own LineFramer and is labeled with a SourceId, which is passed on with every line.
+/// The sources are spread over the event loops, and can be added and removed while the engine runs.
+/// With the io_uring backend the streams are read without a readiness wakeup per read: TCP with multishot
+/// receives into provided buffers, framed in place, other streams and files straight into the framer.
+/// The buffers are provided with IORING_OP_PROVIDE_BUFFERS rather than a registered buffer ring
+/// (IORING_REGISTER_PBUF_RING): the ring registered, but every receive into it failed with ENOBUFS on the kernels
+/// tried, so each recycled buffer costs a submission queue entry. This departs from the registered buffers first
+/// planned for the backend.
+/// \note Linux only.
+class IngestionEngine
+{
+public:
+    /// <summary>
+    ///        Called with each line, on the event loop thread owning the source.
+    /// </summary>
+    /// With more than one event loop the handler is called concurrently, so a parser shall not be shared
+    /// between the loops. The line is valid until the handler returns.
+    typedef std::function<void(const LineOrigin& origin, std::string_view line)> LineHandler;
+
+    /// <summary>
+    ///        The traffic of a source.
+    /// </summary>
+    struct Statistics
+    {
+        uint64_t bytes;
+        uint64_t lines;
+        uint64_t overlong;  ///< Bytes dropped because a line did not fit in the framer
+    };
+
+    /// <summary>
+    ///        How the event loops wait for data.
+    /// </summary>
+    enum class Backend
+    {
+        epoll,
+        uring   ///< io_uring, falls back to epoll if the kernel does not provide it
+    };
+
+    /// <summary>
+    ///        Creates an engine without sources.
+    /// </summary>
+    /// \param handler [in] Called with each line.
+    /// \param loops [in] The number of event loop threads.
+    /// \param interner [in] The table the source names are interned in.
+    /// \param backend [in] How to wait for data.
+    IngestionEngine(LineHandler handler, size_t loops = 1, SourceInterner& interner = SourceInterner::global(),
+        Backend backend = Backend::epoll);
+
+    /// <summary>
+    ///        Stops the event loops and closes all sources.
+    /// </summary>
+    ~IngestionEngine();
+
+    IngestionEngine(const IngestionEngine&) = delete;
+    IngestionEngine& operator=(const IngestionEngine&) = delete;
+
+    /// <summary>
+    ///        The backend in use, epoll if io_uring was asked for but is not available.
+    /// </summary>
+    Backend backend() const;
+
+    /// <summary>
+    ///        Starts the event loop threads.
+    /// </summary>
+    void start();
+
+    /// <summary>
+    ///        Stops the event loop threads. The sources are kept and can be started again.
+    /// </summary>
+    void stop();
+
+    /// <summary>
+    ///        Receives datagrams on a UDP port.
+    /// </summary>
+    /// \param name [in] The name of the source, at most SourceInterner::maxLength characters.
+    /// \param port [in] The local port.
+    /// \param address [in] The local address, e.g. "0.0.0.0" or a multicast group.
+    /// \return The id of the source
+    /// \exception std::system_error if the socket can't be opened
+    SourceId addUdpSource(std::string_view name, uint16_t port, const std::string& address = "0.0.0.0");
+
+    /// <summary>
+    ///        Connects to a TCP server sending lines.
+    /// </summary>
+    /// \exception std::system_error if the connection can't be made
+    SourceId addTcpSource(std::string_view name, const std::string& host, uint16_t port);
+
+    /// <summary>
+    ///        Reads a serial port or pseudo terminal.
+    /// </summary>
+    /// \param baudRate [in] The baud rate, e.g. 4800 or 38400, or 0 to leave the settings as they are.
+    /// \exception std::system_error if the device can't be opened
+    SourceId addSerialSource(std::string_view name, const std::string& device, unsigned baudRate = 4800);
+
+    /// <summary>
+    ///        Reads a file, e.g. an archive to replay, as fast as it can be read. The source is closed at its end.
+    /// </summary>
+    /// \exception std::system_error if the file can't be opened
+    SourceId addFile(std::string_view name, const std::string& path);
+
+    /// <summary>
+    ///        Reads an already opened stream, e.g. a pipe. The engine takes ownership of the descriptor.
+    /// </summary>
+    SourceId addDescriptor(std::string_view name, int fd);
+
+    /// <summary>
+    ///        Closes a source.
+    /// </summary>
+    /// When called from another thread than the loop owning the source, the handler is not called for the source
+    /// after removeSource returns.
+    /// \return true if the source was found
+    bool removeSource(SourceId source);
+
+    /// <summary>
+    ///        The traffic of a source, or zeros if the source is unknown.
+    /// </summary>
+    Statistics statistics(SourceId source) const;
+
+private:
+    class Loop;
+
+    SourceId add(std::string_view name, int fd, bool datagram);
+
+    LineHandler                        m_Handler;
+    SourceInterner&                    m_Interner;
+    std::vector<std::unique_ptr<Loop>> m_Loops;
+    std::atomic<size_t>                m_NextLoop;
+};
+
+#endif
@@ -0,0 +1,181 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string_view>
+
+/// <summary>
+///        Splits a stream of bytes into lines ending with LF.
+/// </summary>
+/// Bytes are read directly into the buffer of the framer, and each complete line is handed out as a view into
+/// the buffer, including its CR LF, so a line is copied only when an incomplete line is moved to the front.
+/// A line longer than the buffer is dropped up to and including its LF, so no part of it is handed out.
+class LineFramer
+{
+public:
+    /// <summary>
+    ///        Creates an empty framer.
+    /// </summary>
+    /// \param capacity [in] The size of the buffer, which is also the longest line that can be framed.
+    explicit LineFramer(size_t capacity = 16384) :
+        m_Buffer(std::make_unique<char[]>(capacity)),
+        m_Capacity(capacity),
+        m_Begin(0),
+        m_End(0),
+        m_Overlong(0),
+        m_Discarding(false)
+    {
+    }
+
+    /// Where to put received bytes
+    char* writePosition() noexcept { return m_Buffer.get() + m_End; }
+
+    /// The number of bytes that can be put at writePosition()
+    size_t writeSpace() const noexcept { return m_Capacity - m_End; }
+
+    /// <summary>
+    ///        Makes received bytes part of the stream.
+    /// </summary>
+    /// \pre \code{.cpp} count <= writeSpace() \endcode
+    void commit(size_t count) noexcept { m_End += count; }
+
+    /// <summary>
+    ///        Copies bytes into the stream, framing as the buffer fills up.
+    /// </summary>
+    template<typename Handler>
+    void append(const char* data, size_t size, Handler&& handler)
+    {
+        while (size > 0)
+        {
+            const size_t count = size < writeSpace() ? size : writeSpace();
+            std::memcpy(writePosition(), data, count);
+            commit(count);
+            drain(handler);
+            data += count;
+            size -= count;
+        }
+    }
+
+    /// <summary>
+    ///        Hands out each complete line and makes room for more bytes.
+    /// </summary>
+    /// \param handler [in] Called with each line. The view is valid until the handler returns.
+    template<typename Handler>
+    void drain(Handler&& handler)
+    {
+        const char* buffer = m_Buffer.get();
+
+        while (m_Begin < m_End)
+        {
+            const void* lf = std::memchr(buffer + m_Begin, '\n', m_End - m_Begin);
+            if (lf == nullptr && m_Discarding)
+            {
+                m_Overlong += m_End - m_Begin;
+                m_Begin = m_End;
+            }
+            if (lf == nullptr)
+                break;
+
+            const size_t end = static_cast<const char*>(lf) - buffer + 1;
+            if (m_Discarding)
+            {
+                // The rest of an overlong line
+                m_Overlong += end - m_Begin;
+                m_Discarding = false;
+            }
+            else
+            {
+                handler(std::string_view(buffer + m_Begin, end - m_Begin));
+            }
+            m_Begin = end;
+        }
+
+        compact();
+    }
+
+    /// <summary>
+    ///        Hands out each line of a complete text, e.g. a datagram, without copying it.
+    /// </summary>
+    /// A last line without LF is handed out as it is.
+    template<typename Handler>
+    static void split(std::string_view text, Handler&& handler)
+    {
+        while (!text.empty())
+        {
+            const size_t lf = text.find('\n');
+            const size_t end = lf == std::string_view::npos ? text.size() : lf + 1;
+            handler(text.substr(0, end));
+            text.remove_prefix(end);
+        }
+    }
+
+    /// <summary>
+    ///        Frames bytes received into another buffer, e.g. an io_uring provided buffer.
+    /// </summary>
+    /// Complete lines are handed out in place, only a line split between two buffers is copied into the framer.
+    template<typename Handler>
+    void feed(std::string_view text, Handler&& handler)
+    {
+        if (m_End > m_Begin || m_Discarding)
+        {
+            // Complete the waiting line first, or drop the rest of an overlong line
+            const size_t lf = text.find('\n');
+            const size_t end = lf == std::string_view::npos ? text.size() : lf + 1;
+            append(text.data(), end, handler);
+            text.remove_prefix(end);
+        }
+
+        const size_t last = text.rfind('\n');
+        const size_t complete = last == std::string_view::npos ? 0 : last + 1;
+        split(text.substr(0, complete), handler);
+        append(text.data() + complete, text.size() - complete, handler);
+    }
+
+    /// <summary>
+    ///        Hands out the last line of a stream ending without LF, and empties the framer.
+    /// </summary>
+    template<typename Handler>
+    void finish(Handler&& handler)
+    {
+        if (m_Discarding)
+            m_Overlong += m_End - m_Begin;
+        else if (m_End > m_Begin)
+            handler(std::string_view(m_Buffer.get() + m_Begin, m_End - m_Begin));
+
+        m_Begin = m_End = 0;
+        m_Discarding = false;
+    }
+
+    /// The number of bytes dropped because a line did not fit in the buffer
+    uint64_t overlong() const noexcept { return m_Overlong; }
+
+private:
+    void compact() noexcept
+    {
+        if (m_Begin == m_End)
+        {
+            m_Begin = m_End = 0;
+        }
+        else if (m_Begin > 0)
+        {
+            std::memmove(m_Buffer.get(), m_Buffer.get() + m_Begin, m_End - m_Begin);
+            m_End -= m_Begin;
+            m_Begin = 0;
+        }
+        else if (m_End == m_Capacity)
+        {
+            // A full buffer without a line end, drop it and the rest of the line
+            m_Overlong += m_End;
+            m_End = 0;
+            m_Discarding = true;
+        }
+    }
+
+    std::unique_ptr<char[]> m_Buffer;
+    size_t                  m_Capacity;
+    size_t                  m_Begin;
+    size_t                  m_End;
+    uint64_t                m_Overlong;
+    bool                    m_Discarding;   // Dropping the bytes up to the LF of an overlong line
+};
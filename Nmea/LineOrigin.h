@@ -0,0 +1,14 @@
+﻿#pragma once
+
+#include <cstdint>
+
+#include "SourceInterner.h"
+
+/// <summary>
+///        Where a line was received from.
+/// </summary>
+struct LineOrigin
+{
+    SourceId source;       ///< The input the line was read from, noSource if unknown
+    int64_t  receiveTime;  ///< Nanoseconds since 1970-01-01 UTC, 0 if unknown
+};
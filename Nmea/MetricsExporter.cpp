@@ -0,0 +1,223 @@
+﻿#include "MetricsExporter.h"
+
+#if defined(__linux__)
+
+#include <cerrno>
+#include <system_error>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace
+{
+    const size_t maxRequest = 8192;
+    const int requestTimeoutMs = 1000;
+
+    [[noreturn]] void throwSystemError(int fd, const char* what)
+    {
+        const int error = errno;
+        if (fd >= 0)
+            ::close(fd);
+        throw std::system_error(error, std::generic_category(), what);
+    }
+
+    // Label values escape backslash, double quote and line feed
+    void appendLabel(std::string& out, const char* name, std::string_view value)
+    {
+        out += name;
+        out += "=\"";
+        for (char ch : value)
+        {
+            if (ch == '\\' || ch == '"')
+                out += '\\';
+            if (ch == '\n')
+                out += "\\n";
+            else
+                out += ch;
+        }
+        out += '"';
+    }
+
+    void appendSamples(std::string& out, const char* metric, const char* help,
+        const std::vector<ParseCounters::Entry>& entries, const SourceInterner& interner, bool bytes)
+    {
+        out += "# HELP ";
+        out += metric;
+        out += ' ';
+        out += help;
+        out += "\n# TYPE ";
+        out += metric;
+        out += " counter\n";
+
+        for (const auto& entry : entries)
+        {
+            out += metric;
+            out += '{';
+            appendLabel(out, "source", interner.name(entry.source));
+            out += ',';
+            appendLabel(out, "talker", entry.talker);
+            out += ',';
+            appendLabel(out, "formatter", entry.formatter);
+            out += ",code=\"E";
+            const unsigned code = static_cast<unsigned>(entry.code);
+            out += static_cast<char>('0' + code / 100);
+            out += static_cast<char>('0' + code / 10 % 10);
+            out += static_cast<char>('0' + code % 10);
+            out += "\"} ";
+            out += std::to_string(bytes ? entry.bytes : entry.lines);
+            out += '\n';
+        }
+    }
+
+    bool sendAll(int fd, std::string_view data)
+    {
+        while (!data.empty())
+        {
+            const ssize_t count = ::send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+            if (count < 0 && errno == EINTR)
+                continue;
+            if (count <= 0)
+                return false;
+            data.remove_prefix(static_cast<size_t>(count));
+        }
+        return true;
+    }
+}
+
+MetricsExporter::MetricsExporter(const ParseCounters& counters, uint16_t port, const std::string& address, const SourceInterner& interner) :
+    m_Counters(counters),
+    m_Interner(interner),
+    m_Listener(-1),
+    m_Wakeup(-1),
+    m_Port(port),
+    m_Thread()
+{
+    m_Listener = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (m_Listener < 0)
+        throwSystemError(-1, "socket");
+
+    const int on = 1;
+    ::setsockopt(m_Listener, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+    sockaddr_in local{};
+    local.sin_family = AF_INET;
+    local.sin_port = htons(port);
+    if (::inet_pton(AF_INET, address.c_str(), &local.sin_addr) != 1)
+    {
+        errno = EINVAL;
+        throwSystemError(m_Listener, "address");
+    }
+
+    if (::bind(m_Listener, reinterpret_cast<sockaddr*>(&local), sizeof(local)) < 0)
+        throwSystemError(m_Listener, "bind");
+    if (::listen(m_Listener, 16) < 0)
+        throwSystemError(m_Listener, "listen");
+
+    socklen_t length = sizeof(local);
+    ::getsockname(m_Listener, reinterpret_cast<sockaddr*>(&local), &length);
+    m_Port = ntohs(local.sin_port);
+
+    m_Wakeup = ::eventfd(0, EFD_CLOEXEC);
+    if (m_Wakeup < 0)
+        throwSystemError(m_Listener, "eventfd");
+
+    m_Thread = std::thread(&MetricsExporter::run, this);
+}
+
+MetricsExporter::~MetricsExporter()
+{
+    const uint64_t one = 1;
+    [[maybe_unused]] auto written = ::write(m_Wakeup, &one, sizeof(one));
+    m_Thread.join();
+
+    ::close(m_Wakeup);
+    ::close(m_Listener);
+}
+
+std::string MetricsExporter::render(const std::vector<ParseCounters::Entry>& entries, const SourceInterner& interner)
+{
+    std::string out;
+    appendSamples(out, "nmea_lines_total", "Lines parsed, by source, talker, formatter and error code.", entries, interner, false);
+    appendSamples(out, "nmea_bytes_total", "Bytes of the lines parsed, by source, talker, formatter and error code.", entries, interner, true);
+    return out;
+}
+
+void MetricsExporter::run()
+{
+    pollfd descriptors[2]{ { m_Listener, POLLIN, 0 }, { m_Wakeup, POLLIN, 0 } };
+
+    while (true)
+    {
+        if (::poll(descriptors, 2, -1) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return;
+        }
+
+        if (descriptors[1].revents != 0)
+            return;
+
+        const int connection = ::accept4(m_Listener, nullptr, nullptr, SOCK_CLOEXEC);
+        if (connection < 0)
+            continue;
+
+        serve(connection);
+        ::close(connection);
+    }
+}
+
+void MetricsExporter::serve(int connection)
+{
+    // A slow or idle client gives up its turn after the timeout
+    timeval timeout{ requestTimeoutMs / 1000, requestTimeoutMs % 1000 * 1000 };
+    ::setsockopt(connection, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    ::setsockopt(connection, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    std::string request;
+    char buffer[1024];
+    while (request.find("\r\n\r\n") == std::string::npos && request.size() < maxRequest)
+    {
+        const ssize_t count = ::recv(connection, buffer, sizeof(buffer), 0);
+        if (count < 0 && errno == EINTR)
+            continue;
+        if (count <= 0)
+            return;
+        request.append(buffer, static_cast<size_t>(count));
+    }
+
+    const bool head = request.compare(0, 5, "HEAD ") == 0;
+    const size_t target = request.find(' ') + 1;
+    const std::string_view path = std::string_view(request).substr(target, request.find(' ', target) - target);
+
+    std::string body;
+    const char* status = "200 OK";
+    if (request.compare(0, 4, "GET ") != 0 && !head)
+    {
+        status = "405 Method Not Allowed";
+    }
+    else if (path == "/metrics" || path == "/")
+    {
+        body = render(m_Counters.snapshot(), m_Interner);
+    }
+    else
+    {
+        status = "404 Not Found";
+    }
+
+    std::string response = "HTTP/1.1 ";
+    response += status;
+    response += "\r\nContent-Type: text/plain; version=0.0.4; charset=utf-8\r\nContent-Length: ";
+    response += std::to_string(body.size());
+    response += "\r\nConnection: close\r\n\r\n";
+    if (!head)
+        response += body;
+
+    sendAll(connection, response);
+}
+
+#endif
@@ -0,0 +1,61 @@
+﻿#pragma once
+
+#if defined(__linux__)
+
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ParseCounters.h"
+
+/// <summary>
+///        Serves ParseCounters in the Prometheus text format over HTTP.
+/// </summary>
+/// GET /metrics is answered with nmea_lines_total and nmea_bytes_total, labeled with source, talker, formatter
+/// and code. Requests are served one at a time on a thread of the exporter, each connection is closed after
+/// the response. The counters are added up per request, so the parsers are not disturbed in between.
+/// \note Linux only.
+class MetricsExporter
+{
+public:
+    /// <summary>
+    ///        Starts serving.
+    /// </summary>
+    /// \param counters [in] The counters to serve, which shall outlive the exporter.
+    /// \param port [in] The TCP port, 0 for any free port, see port().
+    /// \param address [in] The local address to listen on, the loopback address by default.
+    /// \param interner [in] The table the sources are named by.
+    /// \exception std::system_error if the address can't be listened on
+    MetricsExporter(const ParseCounters& counters, uint16_t port, const std::string& address = "127.0.0.1",
+        const SourceInterner& interner = SourceInterner::global());
+
+    /// <summary>
+    ///        Stops serving.
+    /// </summary>
+    ~MetricsExporter();
+
+    MetricsExporter(const MetricsExporter&) = delete;
+    MetricsExporter& operator=(const MetricsExporter&) = delete;
+
+    /// The port listened on
+    uint16_t port() const noexcept { return m_Port; }
+
+    /// <summary>
+    ///        Formats counters in the Prometheus text exposition format.
+    /// </summary>
+    static std::string render(const std::vector<ParseCounters::Entry>& entries, const SourceInterner& interner);
+
+private:
+    void run();
+    void serve(int connection);
+
+    const ParseCounters&  m_Counters;
+    const SourceInterner& m_Interner;
+    int                   m_Listener;
+    int                   m_Wakeup;
+    uint16_t              m_Port;
+    std::thread           m_Thread;
+};
+
+#endif
@@ -1,17 +1,49 @@
 ﻿#include "Nmea.h"
 
+#include <charconv>
 #include <exception>
 #include <iostream>
+#include <limits>
 #include <string>
 
 #include "ErrorCodes.h"
 #include "NmeaFunctions.h"
 #include "HardCodedMessages.h"
 #include "Exception.h"
+#include "Probes.h"
+#include "StageProfiler.h"
+#include "TraceRecorder.h"
 
 using namespace std;
+
+namespace
+{
+    // Converts a field already checked to contain only digits, saturating on overflow
+    template<typename T>
+    T toInteger(std::string_view field)
+    {
+        T value{ 0 };
+        if (std::from_chars(field.data(), field.data() + field.size(), value).ec != std::errc())
+            value = std::numeric_limits<T>::max();
+
+        return value;
+    }
+}
+
 Nmea::Nmea() :
+    Nmea(SourceInterner::global())
+{
+}
+
+Nmea::Nmea(SourceInterner& interner) :
     m_Line(),
+    m_TagBlock(),
+    m_Origin(),
+    m_Interner(interner),
+    m_Counters(nullptr),
+    m_Levels(nullptr),
+    m_Adaptive(nullptr),
+    m_Validated(Validation::full),
     m_Error(ErrorCode::E000),
     m_Indication(nullptr)
 {
@@ -21,13 +53,59 @@ Nmea::~Nmea()
 {
 }
 
-void Nmea::parse(std::string_view line)
+void Nmea::parse(std::string_view line, const LineOrigin& origin)
 {
+    m_Origin = origin;
+    m_Validated = m_Levels != nullptr ? m_Levels->of(origin.source) : Validation::full;
+
+    // A source validated fully may be trusted, and validated less
+    AdaptiveValidation* const adaptive = m_Validated == Validation::full ? m_Adaptive : nullptr;
+    const int64_t adaptiveStart = adaptive != nullptr ? AdaptiveValidation::now() : 0;
+    if (adaptive != nullptr)
+        m_Validated = adaptive->level(origin.source);
+
+    NMEA_PROBE3(parse_start, line.data(), line.size(), origin.source);
+    TraceRecorder::Span span("parse", origin.source);
+
+    // The stage that throws is timed to the end of the exception handling
+    StageProfiler::ParseTimer timer;
+    Stage stage = Stage::mainStructure;
+
     try
     {
+        NMEA_PROBE1(stage_start, static_cast<int>(stage));
         parseMainStructure(line);
-        parseGeneralContents();
-        parseSpecificContents();
+        timer.lap(stage);
+        NMEA_PROBE2(stage_end, static_cast<int>(stage), 1);
+
+        if (m_Validated >= Validation::general)
+        {
+            stage = Stage::generalContents;
+            NMEA_PROBE1(stage_start, static_cast<int>(stage));
+            parseGeneralContents();
+            timer.lap(stage);
+            NMEA_PROBE2(stage_end, static_cast<int>(stage), 1);
+        }
+        else if (m_Line.size() > 1)
+        {
+            // The source and grouping of a line validated less are still needed by the counters and correlators
+            stage = Stage::generalContents;
+            NMEA_PROBE1(stage_start, static_cast<int>(stage));
+            parseTagBlocks();
+            timer.lap(stage);
+            NMEA_PROBE2(stage_end, static_cast<int>(stage), 1);
+        }
+
+        if (m_Validated == Validation::full)
+        {
+            stage = Stage::specificContents;
+            NMEA_PROBE1(stage_start, static_cast<int>(stage));
+            parseSpecificContents();
+            timer.lap(stage);
+            NMEA_PROBE2(stage_end, static_cast<int>(stage), 1);
+        }
+
+        stage = Stage::count;
     }
     catch (const ErrorCode& e)
     {
@@ -41,6 +119,47 @@ void Nmea::parse(std::string_view line)
     catch (...)
     {
     }
+
+    if (stage != Stage::count)
+    {
+        NMEA_PROBE2(stage_end, static_cast<int>(stage), 0);
+        NMEA_PROBE2(error, static_cast<int>(m_Error), m_Indication);
+    }
+
+    if constexpr (StageProfiler::enabled())
+    {
+        if (stage != Stage::count)
+            timer.lap(stage);
+
+        const auto& fields = sentenceFields();
+        timer.record(fields.empty() ? std::string_view() : fields[0], origin.source, m_Error);
+    }
+
+    if (adaptive != nullptr)
+        adaptive->record(origin.source, m_Validated, m_Error, AdaptiveValidation::now() - adaptiveStart);
+
+    if (m_Counters != nullptr)
+    {
+        const auto& fields = sentenceFields();
+        const SourceId source = origin.source != noSource || !m_TagBlock.has(TagBlock::source) ? origin.source : m_TagBlock.sourceId;
+        m_Counters->count(source, fields.empty() ? std::string_view() : fields[0].substr(1), m_Error, line.size());
+    }
+
+#if NMEA_PROBES
+    const auto& fields = sentenceFields();
+    NMEA_PROBE4(parse_end, static_cast<int>(m_Error), fields.empty() ? nullptr : fields[0].data(), fields.empty() ? 0 : fields[0].size(), origin.source);
+#endif
+
+    if (TraceRecorder::recording())
+    {
+        const auto& fields = sentenceFields();
+        span.setFormatter(StageProfiler::formatter(fields.empty() ? std::string_view() : fields[0]));
+    }
+}
+
+void Nmea::setCounters(ParseCounters* counters)
+{
+    m_Counters = counters != nullptr ? &counters->addShard() : nullptr;
 }
 
 ErrorCode Nmea::errorCode() const
@@ -48,8 +167,44 @@ ErrorCode Nmea::errorCode() const
     return m_Error;
 }
 
+const std::vector<std::string_view>& Nmea::sentenceFields() const
+{
+    static const std::vector<std::string_view> noFields;
+
+    if (m_Line.empty() || m_Line.back().m_LineElementType != LineElementType::sentence)
+        return noFields;
+
+    return m_Line.back().m_Splitter;
+}
+
+std::string_view Nmea::tagBlockParameter(char code) const
+{
+    for (const auto& tagBlockOrSentence : m_Line)
+    {
+        if (tagBlockOrSentence.m_LineElementType != LineElementType::tag_block)
+            continue;
+
+        // Skip the checksum field
+        const auto& splitter{ tagBlockOrSentence.m_Splitter };
+        for (size_t i = 0; i + 1 < splitter.size(); ++i)
+        {
+            const auto& tagField = splitter[i];
+            if (tagField.size() >= 2 && tagField[0] == code && tagField[1] == ':')
+                return tagField.substr(2);
+        }
+    }
+
+    return {};
+}
+
 void Nmea::parseMainStructure(std::string_view line)
 {
+    // Start with no m_Error and nothing from the previous line
+    m_Error = ErrorCode::E000;
+    m_Indication = nullptr;
+    m_Line.clear();
+    m_TagBlock = TagBlock();
+
     // Check the arguments for empty line
     if (line.length() == 0)
         throw logic_error("Empty line");
@@ -57,9 +212,6 @@ void Nmea::parseMainStructure(std::string_view line)
     auto begin = &line[0];
     auto end = begin + line.size();
 
-    // Start with no m_Error
-    m_Error = ErrorCode::E000;
-
     // Find the first character in the sentence
     for (; true; ++begin)
     {
@@ -168,6 +320,10 @@ Nmea::TagBlockOrSentence Nmea::parseMainStructureTagBlockOrSentence(const char*&
 
     appendSpan(tagBlockOrSentence.m_Splitter, start, begin);
 
+    // The checksum and the length are not checked when validating the framing only
+    if (m_Validated == Validation::framing)
+        return tagBlockOrSentence;
+
     // Check total length
     // Ref. NMEA 0183 V.4.00 5.2.4
     auto headerField{ tagBlockOrSentence.m_Splitter[0] };
@@ -185,6 +341,89 @@ Nmea::TagBlockOrSentence Nmea::parseMainStructureTagBlockOrSentence(const char*&
     return tagBlockOrSentence;
 }
 
+void Nmea::parseTagBlocks()
+{
+    for (const auto& tagBlockOrSentence : m_Line)
+        if (tagBlockOrSentence.m_LineElementType == LineElementType::tag_block)
+            parseTagBlock(tagBlockOrSentence.m_Splitter);
+}
+
+void Nmea::parseTagBlock(const std::vector<std::string_view>& splitter)
+{
+    // Check data field characters
+    for (size_t i = 0; i < splitter.size() - 1; ++i)
+    {
+        auto& tagField = splitter[i];
+        if (tagField[1] != ':')
+            throw Exception(ErrorCode::E028, &(tagField[1]));
+
+        switch (tagField[0])
+        {
+        case 'c':
+        {
+            std::string_view field{ &tagField[2], tagField.size() - 2 };
+            NmeaFunctions::checkPositivInteger(field);
+            m_TagBlock.time = toInteger<int64_t>(field);
+            m_TagBlock.present |= TagBlock::unixTime;
+            break;
+        }
+        case 'd':
+        {
+            std::string_view field{ &tagField[2], tagField.size() - 2 };
+            NmeaFunctions::checkIdentification(field);
+            m_TagBlock.destinationId = m_Interner.intern(field);
+            m_TagBlock.present |= TagBlock::destination;
+            break;
+        }
+        case 'g':
+        {
+            std::string_view field{ &tagField[2], tagField.size() - 2 };
+            NmeaFunctions::checkSentenceGrouping(field);
+
+            // The field is checked to be digits-digits-digits
+            const auto first = field.find('-');
+            const auto second = field.find('-', first + 1);
+            m_TagBlock.sentenceNumber = toInteger<uint16_t>(field.substr(0, first));
+            m_TagBlock.totalSentences = toInteger<uint16_t>(field.substr(first + 1, second - first - 1));
+            m_TagBlock.groupId = toInteger<uint32_t>(field.substr(second + 1));
+            m_TagBlock.present |= TagBlock::grouping;
+            break;
+        }
+        case 'n':
+        {
+            std::string_view field{ &tagField[2], tagField.size() - 2 };
+            NmeaFunctions::checkPositivInteger(field);
+            m_TagBlock.lineNumber = toInteger<uint32_t>(field);
+            m_TagBlock.present |= TagBlock::lineCount;
+            break;
+        }
+        case 'r':
+        {
+            std::string_view field{ &tagField[2], tagField.size() - 2 };
+            NmeaFunctions::checkPositivInteger(field);
+            m_TagBlock.relative = toInteger<uint32_t>(field);
+            m_TagBlock.present |= TagBlock::relativeTime;
+            break;
+        }
+        case 's':
+        {
+            std::string_view field{ &tagField[2], tagField.size() - 2 };
+            NmeaFunctions::checkIdentification(field);
+            m_TagBlock.sourceId = m_Interner.intern(field);
+            m_TagBlock.present |= TagBlock::source;
+            break;
+        }
+        case 't':
+            // No check necessary. The field is already checked that it contains only valid characters
+            m_TagBlock.textString = tagField.substr(2);
+            m_TagBlock.present |= TagBlock::text;
+            break;
+        default:
+            throw Exception(ErrorCode::E027, &(tagField[0]));
+        }
+    }
+}
+
 void Nmea::parseGeneralContents()
 {
     for (auto& tagBlockOrSentence : m_Line)
@@ -193,58 +432,7 @@ void Nmea::parseGeneralContents()
 
         if (tagBlockOrSentence.m_LineElementType == LineElementType::tag_block)
         {
-            // Check data field characters
-            for (size_t i = 0; i < splitter.size() - 1; ++i)
-            {
-                auto& tagField = splitter[i];
-                if (tagField[1] != ':')
-                    throw Exception(ErrorCode::E028, &(tagField[1]));
-
-                switch (tagField[0])
-                {
-                case 'c':
-                {
-                    std::string_view field{ &tagField[2], tagField.size() - 2 };
-                    NmeaFunctions::checkPositivInteger(field);
-                    break;
-                }
-                case 'd':
-                {
-                    std::string_view field{ &tagField[2], tagField.size() - 2 };
-                    NmeaFunctions::checkIdentification(field);
-                    break;
-                }
-                case 'g':
-                {
-                    std::string_view field{ &tagField[2], tagField.size() - 2 };
-                    NmeaFunctions::checkSentenceGrouping(field);
-                    break;
-                }
-                case 'n':
-                {
-                    std::string_view field{ &tagField[2], tagField.size() - 2 };
-                    NmeaFunctions::checkPositivInteger(field);
-                    break;
-                }
-                case 'r':
-                {
-                    std::string_view field{ &tagField[2], tagField.size() - 2 };
-                    NmeaFunctions::checkPositivInteger(field);
-                    break;
-                }
-                case 's':
-                {
-                    std::string_view field{ &tagField[2], tagField.size() - 2 };
-                    NmeaFunctions::checkIdentification(field);
-                    break;
-                }
-                case 't':
-                    // No check necessary. The field is already checked that it contains only valid characters
-                    break;
-                default:
-                    throw Exception(ErrorCode::E027, &(tagField[0]));
-                }
-            }
+            parseTagBlock(splitter);
         }
         else
         {
@@ -4,6 +4,11 @@
 #include <string_view>
 #include "SentenceType.h"
 #include "Exception.h"
+#include "AdaptiveValidation.h"
+#include "LineOrigin.h"
+#include "ParseCounters.h"
+#include "TagBlock.h"
+#include "Validation.h"
 #include <string_view>
 
 /// <summary>
@@ -13,15 +18,22 @@ class Nmea
 {
 public:
     Nmea();
+
+    /// <summary>
+    ///        Creates a parser interning the tag block sources in the given table instead of SourceInterner::global().
+    /// </summary>
+    explicit Nmea(SourceInterner& interner);
     ~Nmea();
 
     /// <summary>
     ///        Parse the given Nmea sentence.
     /// </summary>
     /// \param [in] sentence The Nmea sentence to parsed.
+    /// \param [in] origin Where the sentence was received from.
+    /// The line is checked to the validation level of its source, see setValidation.
     /// \post \code{.cpp} if OK then erroCode() == ErrorCode::E000 \endcode
     /// \post \code{.cpp} else erroCode() == some other error code \endcode 
-    void parse(std::string_view sentence);
+    void parse(std::string_view sentence, const LineOrigin& origin = LineOrigin());
 
     /// <summary>
     ///        The error code yielding the last call to parse.
@@ -30,6 +42,64 @@ public:
 
     const char* indication() const { return m_Indication; }
 
+    /// <summary>
+    ///        The fields of the sentence in the line given to the last call to parse.
+    /// </summary>
+    /// The fields refer to the characters of the line given to parse.
+    /// \return The header field, the data fields and the checksum field, or no fields if the line has no sentence
+    const std::vector<std::string_view>& sentenceFields() const;
+
+    /// <summary>
+    ///        The value of a tag block parameter in the line given to the last call to parse.
+    /// </summary>
+    /// \param code [in] The parameter code, e.g. 's' for the source identification.
+    /// \return The characters after the colon, or an empty string if the line has no such parameter
+    std::string_view tagBlockParameter(char code) const;
+
+    /// <summary>
+    ///        The decoded tag block parameters of the line given to the last call to parse.
+    /// </summary>
+    /// \pre errorCode() == ErrorCode::E000
+    const TagBlock& tagBlock() const { return m_TagBlock; }
+
+    /// <summary>
+    ///        Where the line given to the last call to parse was received from.
+    /// </summary>
+    const LineOrigin& origin() const { return m_Origin; }
+
+    /// <summary>
+    ///        The table the sources of origin() and of the tag blocks are interned in.
+    /// </summary>
+    const SourceInterner& interner() const { return m_Interner; }
+
+    /// <summary>
+    ///        Counts each line parsed from now on in a shard of its own.
+    /// </summary>
+    /// \param counters [in] The counters, nullptr to stop counting. Call once per parser and counters.
+    /// \pre The counters outlive the parser, or the next call to setCounters
+    void setCounters(ParseCounters* counters);
+
+    /// <summary>
+    ///        Checks the lines of each source to the level given by a table from now on.
+    /// </summary>
+    /// \param levels [in] The levels, nullptr to check every line fully.
+    /// \pre The levels outlive the parser, or the next call to setValidation
+    void setValidation(const ValidationLevels* levels) { m_Levels = levels; }
+
+    /// <summary>
+    ///        Lets the validation of the lines of clean sources adapt from now on.
+    /// </summary>
+    /// Applies to the sources validated fully by setValidation.
+    /// \param adaptive [in] The adaptive validation, nullptr to validate to the levels of setValidation only.
+    /// \pre The adaptive validation outlives the parser, or the next call to setAdaptiveValidation
+    void setAdaptiveValidation(AdaptiveValidation* adaptive) { m_Adaptive = adaptive; }
+
+    /// <summary>
+    ///        The level the line given to the last call to parse was checked to.
+    /// </summary>
+    /// Below Validation::general, the tag block parameters are decoded and checked, the sentence is not.
+    Validation validated() const { return m_Validated; }
+
 private:
     enum class LineElementType { tag_block, sentence};
     struct TagBlockOrSentence
@@ -40,6 +110,13 @@ private:
     };
 
     std::vector<TagBlockOrSentence> m_Line;
+    TagBlock                        m_TagBlock;
+    LineOrigin                      m_Origin;
+    SourceInterner&                 m_Interner;
+    ParseCounters::Shard*           m_Counters;
+    const ValidationLevels*         m_Levels;
+    AdaptiveValidation*             m_Adaptive;
+    Validation                      m_Validated;
 
     ErrorCode    m_Error;
     const char*  m_Indication;
@@ -93,9 +170,23 @@ public:
     /// </summary>
     /// \pre parseMainStructure(sentence), for some NMEA sentence
     /// \post The address field and datafields contains only legal characters
+    /// \post tagBlock() contains the decoded tag block parameters
     /// \exception Exception
     void parseGeneralContents();
 
+    /// <summary>
+    /// Decodes the tag blocks of a line validated below Validation::general, see parseTagBlock.
+    /// </summary>
+    /// \pre parseMainStructure(sentence), for some NMEA sentence
+    void parseTagBlocks();
+
+    /// <summary>
+    /// Checks the parameters of a tag block and decodes them into tagBlock().
+    /// </summary>
+    /// \param splitter [in] The parameters and the checksum field of the tag block.
+    /// \exception Exception
+    void parseTagBlock(const std::vector<std::string_view>& splitter);
+
     void parseSpecificContents();
 
     /// <summary>
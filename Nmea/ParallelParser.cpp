@@ -0,0 +1,169 @@
+﻿#include "ParallelParser.h"
+
+ParallelParser::ParallelParser(Dispatcher dispatcher, size_t workers, size_t window, SourceInterner& interner) :
+    m_Dispatcher(std::move(dispatcher)),
+    m_Slots(),
+    m_Mask(0),
+    m_Queues(),
+    m_Submitted(0),
+    m_Dispatched(0),
+    m_DispatchMutex(),
+    m_Queued(0),
+    m_Sleepers(0),
+    m_Stolen(0),
+    m_Stopping(false),
+    m_IdleMutex(),
+    m_Idle(),
+    m_Workers()
+{
+    size_t size = 1;
+    while (size < window)
+        size *= 2;
+
+    m_Mask = size - 1;
+    for (size_t i = 0; i < size; ++i)
+        m_Slots.push_back(std::make_unique<Slot>(interner));
+
+    if (workers == 0)
+        workers = std::thread::hardware_concurrency() == 0 ? 1 : std::thread::hardware_concurrency();
+
+    for (size_t i = 0; i < workers; ++i)
+        m_Queues.push_back(std::make_unique<Queue>());
+
+    for (size_t i = 0; i < workers; ++i)
+        m_Workers.emplace_back(&ParallelParser::work, this, i);
+}
+
+ParallelParser::~ParallelParser()
+{
+    flush();
+
+    {
+        std::lock_guard<std::mutex> lock(m_IdleMutex);
+        m_Stopping = true;
+    }
+    m_Idle.notify_all();
+
+    for (auto& worker : m_Workers)
+        worker.join();
+}
+
+uint64_t ParallelParser::submit(std::string_view line, const LineOrigin& origin)
+{
+    const uint64_t sequence = m_Submitted;
+
+    // Wait for the slot to be dispatched
+    for (uint64_t dispatched = m_Dispatched.load(); sequence - dispatched > m_Mask; dispatched = m_Dispatched.load())
+        m_Dispatched.wait(dispatched);
+
+    auto& free = slot(sequence);
+    free.line.assign(line.data(), line.size());
+    free.origin = origin;
+
+    auto& queue = *m_Queues[sequence % m_Queues.size()];
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.sequences.push_back(sequence);
+    }
+    ++m_Submitted;
+
+    // Either the worker going to sleep sees the line, or this thread sees the sleeper
+    m_Queued.fetch_add(1);
+    if (m_Sleepers.load() > 0)
+    {
+        { std::lock_guard<std::mutex> lock(m_IdleMutex); }
+        m_Idle.notify_one();
+    }
+
+    return sequence;
+}
+
+void ParallelParser::flush()
+{
+    for (uint64_t dispatched = m_Dispatched.load(); dispatched != m_Submitted; dispatched = m_Dispatched.load())
+        m_Dispatched.wait(dispatched);
+}
+
+void ParallelParser::work(size_t self)
+{
+    for (;;)
+    {
+        uint64_t sequence;
+        if (take(self, sequence))
+        {
+            auto& parsed = slot(sequence);
+            parsed.nmea.parse(parsed.line, parsed.origin);
+            parsed.ready.store(true, std::memory_order_release);
+            dispatch();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_IdleMutex);
+        m_Sleepers.fetch_add(1);
+        m_Idle.wait(lock, [this] { return m_Stopping || m_Queued.load() > 0; });
+        m_Sleepers.fetch_sub(1);
+
+        if (m_Stopping && m_Queued.load() == 0)
+            return;
+    }
+}
+
+// Takes the oldest line of the own queue, or else the newest line of another queue
+bool ParallelParser::take(size_t self, uint64_t& sequence)
+{
+    if (m_Queued.load() == 0)
+        return false;
+
+    for (size_t i = 0; i < m_Queues.size(); ++i)
+    {
+        auto& queue = *m_Queues[(self + i) % m_Queues.size()];
+
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.sequences.empty())
+            continue;
+
+        if (i == 0)
+        {
+            sequence = queue.sequences.front();
+            queue.sequences.pop_front();
+        }
+        else
+        {
+            sequence = queue.sequences.back();
+            queue.sequences.pop_back();
+            m_Stolen.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        m_Queued.fetch_sub(1);
+        return true;
+    }
+
+    return false;
+}
+
+// Dispatches the parsed lines at the head of the window. A worker finding the dispatcher busy leaves its line to it.
+void ParallelParser::dispatch()
+{
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_DispatchMutex, std::try_to_lock);
+            if (!lock)
+                return;
+
+            uint64_t next = m_Dispatched.load(std::memory_order_relaxed);
+            for (; slot(next).ready.load(std::memory_order_acquire); ++next)
+            {
+                auto& parsed = slot(next);
+                m_Dispatcher(next, parsed.line, parsed.nmea);
+                parsed.ready.store(false, std::memory_order_relaxed);
+                m_Dispatched.store(next + 1);
+                m_Dispatched.notify_all();
+            }
+        }
+
+        // The line at the head may have become ready after it was checked, and before the lock was released
+        if (!slot(m_Dispatched.load()).ready.load(std::memory_order_acquire))
+            return;
+    }
+}
@@ -0,0 +1,107 @@
+﻿#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "LineOrigin.h"
+#include "Nmea.h"
+
+/// <summary>
+///        Parses the lines of one stream on a pool of worker threads, and dispatches the results in the order
+///        the lines were submitted.
+/// </summary>
+/// Each line is numbered and put in a slot of a reorder window. The slot is queued on one worker, and an idle worker
+/// steals slots from the others. The parse result stays in the slot until all earlier lines have been dispatched.
+/// All parsers intern their tag block sources in the same SourceInterner.
+class ParallelParser
+{
+public:
+    /// <summary>
+    ///        Called with each parsed line, in submission order, one call at a time but not always on the same thread.
+    /// </summary>
+    /// The line and the parser are valid until the dispatcher returns.
+    typedef std::function<void(uint64_t sequence, std::string_view line, const Nmea& nmea)> Dispatcher;
+
+    /// <summary>
+    ///        Starts the workers.
+    /// </summary>
+    /// \param dispatcher [in] Called with each parsed line.
+    /// \param workers [in] The number of worker threads, 0 for one per core.
+    /// \param window [in] The maximum number of lines submitted but not dispatched, rounded up to a power of two.
+    /// \param interner [in] The table the tag block sources are interned in.
+    ParallelParser(Dispatcher dispatcher, size_t workers = 0, size_t window = 1024,
+        SourceInterner& interner = SourceInterner::global());
+
+    /// <summary>
+    ///        Parses and dispatches the lines submitted, and stops the workers.
+    /// </summary>
+    ~ParallelParser();
+
+    ParallelParser(const ParallelParser&) = delete;
+    ParallelParser& operator=(const ParallelParser&) = delete;
+
+    /// <summary>
+    ///        Copies a line into the window and queues it for parsing.
+    /// </summary>
+    /// Waits while the window is full. Shall be called from one thread at a time.
+    /// \return The sequence number of the line, counting from 0
+    uint64_t submit(std::string_view line, const LineOrigin& origin = LineOrigin());
+
+    /// <summary>
+    ///        Waits until all lines submitted have been dispatched.
+    /// </summary>
+    void flush();
+
+    /// The number of worker threads
+    size_t workers() const { return m_Queues.size(); }
+
+    /// The number of lines parsed by another worker than the one they were queued on
+    uint64_t stolen() const { return m_Stolen.load(std::memory_order_relaxed); }
+
+private:
+    struct Slot
+    {
+        explicit Slot(SourceInterner& interner) : line(), origin(), nmea(interner), ready(false) {}
+
+        std::string       line;
+        LineOrigin        origin;
+        Nmea              nmea;
+        std::atomic<bool> ready;   // Parsed, waiting for dispatch
+    };
+
+    struct Queue
+    {
+        std::mutex           mutex;
+        std::deque<uint64_t> sequences;
+    };
+
+    void work(size_t self);
+    bool take(size_t self, uint64_t& sequence);
+    void dispatch();
+
+    Slot& slot(uint64_t sequence) { return *m_Slots[sequence & m_Mask]; }
+
+    Dispatcher                          m_Dispatcher;
+    std::vector<std::unique_ptr<Slot>>  m_Slots;
+    uint64_t                            m_Mask;
+    std::vector<std::unique_ptr<Queue>> m_Queues;
+    uint64_t                            m_Submitted;
+    std::atomic<uint64_t>               m_Dispatched;  // The sequence number of the next line to dispatch
+    std::mutex                          m_DispatchMutex;
+    std::atomic<uint64_t>               m_Queued;      // Lines queued but not taken by a worker
+    std::atomic<size_t>                 m_Sleepers;
+    std::atomic<uint64_t>               m_Stolen;
+    bool                                m_Stopping;
+    std::mutex                          m_IdleMutex;
+    std::condition_variable             m_Idle;
+    std::vector<std::thread>            m_Workers;
+};
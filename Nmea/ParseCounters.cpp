@@ -0,0 +1,161 @@
+﻿#include "ParseCounters.h"
+
+#include <algorithm>
+#include <map>
+#include <tuple>
+
+namespace
+{
+    const size_t addressLength = 6;
+    const unsigned sourceShift = 48;
+    const unsigned codeShift = 42;
+
+    // The address in 7 bit characters, the error code plus one and the source, so no key is 0
+    uint64_t keyOf(SourceId source, std::string_view address, ErrorCode code) noexcept
+    {
+        uint64_t key = static_cast<uint64_t>(source) << sourceShift | (static_cast<uint64_t>(code) + 1) << codeShift;
+        const size_t length = std::min(address.size(), addressLength);
+        for (size_t i = 0; i < length; ++i)
+            key |= static_cast<uint64_t>(address[i] & 0x7F) << (7 * i);
+        return key;
+    }
+
+    bool isUpper(char ch) noexcept
+    {
+        return ch >= 'A' && ch <= 'Z';
+    }
+
+    bool isUpperOrDigit(char ch) noexcept
+    {
+        return isUpper(ch) || (ch >= '0' && ch <= '9');
+    }
+
+    // A talker and a three letter formatter, e.g. GPGGA or U1VDM, or P and a proprietary sentence
+    bool isAddress(std::string_view address) noexcept
+    {
+        if (address.size() > 1 && address[0] == 'P')
+            return std::all_of(address.begin() + 1, address.end(), isUpperOrDigit);
+
+        return address.size() == 5 && isUpperOrDigit(address[0]) && isUpperOrDigit(address[1]) &&
+            isUpper(address[2]) && isUpper(address[3]) && isUpper(address[4]);
+    }
+
+    std::string addressOf(uint64_t key)
+    {
+        std::string address;
+        for (size_t i = 0; i < addressLength; ++i)
+        {
+            const char ch = static_cast<char>((key >> (7 * i)) & 0x7F);
+            if (ch == 0)
+                break;
+            address += ch;
+        }
+        return address;
+    }
+}
+
+void ParseCounters::Shard::count(SourceId source, std::string_view address, ErrorCode code, size_t bytes) noexcept
+{
+    // A corrupted address is counted by its error code only, so corrupted lines can't fill the slots
+    const uint64_t key = keyOf(source, isAddress(address) ? address : std::string_view(), code);
+    if (m_Last != nullptr && m_Last->key.load(std::memory_order_relaxed) == key)
+    {
+        add(*m_Last, bytes);
+        return;
+    }
+
+    for (size_t i = 0, slot = (key * 0x9E3779B97F4A7C15ull) >> 54; i < slots; ++i, slot = (slot + 1) % slots)
+    {
+        auto& entry = m_Slots[slot];
+        const uint64_t found = entry.key.load(std::memory_order_relaxed);
+        if (found == 0)
+        {
+            // Counted before the key is published, so a reader never sees a key without its counts
+            add(entry, bytes);
+            entry.key.store(key, std::memory_order_release);
+        }
+        else if (found != key)
+        {
+            continue;
+        }
+        else
+        {
+            add(entry, bytes);
+        }
+
+        m_Last = &entry;
+        return;
+    }
+
+    add(m_Overflow[static_cast<size_t>(code)], bytes);
+}
+
+ParseCounters::Shard& ParseCounters::addShard()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Shards.push_back(std::make_unique<Shard>());
+    return *m_Shards.back();
+}
+
+std::vector<ParseCounters::Entry> ParseCounters::snapshot() const
+{
+    // Keyed by the labels, the address split into talker and formatter when the entries are made
+    std::map<std::tuple<SourceId, std::string, ErrorCode>, std::pair<uint64_t, uint64_t>> sums;
+
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        for (const auto& shard : m_Shards)
+        {
+            for (const auto& slot : shard->m_Slots)
+            {
+                const uint64_t key = slot.key.load(std::memory_order_acquire);
+                if (key == 0)
+                    continue;
+
+                auto& sum = sums[{ static_cast<SourceId>(key >> sourceShift), addressOf(key),
+                    static_cast<ErrorCode>(((key >> codeShift) & 0x3F) - 1) }];
+                sum.first += slot.lines.load(std::memory_order_relaxed);
+                sum.second += slot.bytes.load(std::memory_order_relaxed);
+            }
+
+            for (size_t code = 0; code <= static_cast<size_t>(ErrorCode::E033); ++code)
+            {
+                const uint64_t lines = shard->m_Overflow[code].lines.load(std::memory_order_relaxed);
+                if (lines == 0)
+                    continue;
+
+                // An address can't start with a space, so "other" can't be mistaken for a counted one
+                auto& sum = sums[{ noSource, " other", static_cast<ErrorCode>(code) }];
+                sum.first += lines;
+                sum.second += shard->m_Overflow[code].bytes.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    std::vector<Entry> entries;
+    entries.reserve(sums.size());
+    for (const auto& [labels, sum] : sums)
+    {
+        const auto& [source, address, code] = labels;
+
+        Entry entry{ source, {}, {}, code, sum.first, sum.second };
+        if (address == " other")
+            entry.formatter = "other";
+        else if (address.empty())
+            entry.formatter = "invalid";
+        else if (!address.empty() && address[0] == 'P')
+        {
+            // Proprietary, the manufacturer's mnemonic and the sentence type follow the P
+            entry.talker = "P";
+            entry.formatter = address.substr(1);
+        }
+        else if (address.size() >= 2)
+        {
+            entry.talker = address.substr(0, 2);
+            entry.formatter = address.substr(2);
+        }
+        entries.push_back(std::move(entry));
+    }
+
+    return entries;
+}
@@ -0,0 +1,99 @@
+﻿#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "ErrorCodes.h"
+#include "SourceInterner.h"
+
+/// <summary>
+///        Counts the lines and bytes parsed per source, talker, formatter and error code.
+/// </summary>
+/// Each parser counts into its own shard, so counting takes a few relaxed loads and stores and no lock or
+/// read-modify-write instruction. snapshot() adds up the shards while the parsers keep counting.
+/// \code{.cpp}
+///     ParseCounters counters;
+///     Nmea nmea;
+///     nmea.setCounters(&counters);
+/// \endcode
+class ParseCounters
+{
+public:
+    /// <summary>
+    ///        The lines and bytes of one combination of labels.
+    /// </summary>
+    struct Entry
+    {
+        SourceId    source;      ///< The source of the line origin, or else of the tag block, noSource if none
+        std::string talker;      ///< e.g. GP, P for proprietary sentences, empty if the line has no valid address
+        std::string formatter;   ///< e.g. GGA, GRME for $PGRME, "invalid" if the line has no valid address
+        ErrorCode   code;
+        uint64_t    lines;
+        uint64_t    bytes;
+    };
+
+    /// <summary>
+    ///        The counters of one parser.
+    /// </summary>
+    /// Written by one thread at a time, read by any.
+    class Shard
+    {
+    public:
+        /// <summary>
+        ///        Counts a line.
+        /// </summary>
+        /// \param address [in] The address field without the start character, e.g. GPGGA, empty if not found.
+        /// Only the first 6 characters are told apart. An address that is not a talker and three letters, or P and
+        /// letters and digits, is counted as not found.
+        void count(SourceId source, std::string_view address, ErrorCode code, size_t bytes) noexcept;
+
+    private:
+        friend class ParseCounters;
+
+        static const size_t slots = 1024;
+
+        struct Slot
+        {
+            std::atomic<uint64_t> key{ 0 };
+            std::atomic<uint64_t> lines{ 0 };
+            std::atomic<uint64_t> bytes{ 0 };
+        };
+
+        static void add(Slot& slot, size_t bytes) noexcept
+        {
+            slot.lines.store(slot.lines.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            slot.bytes.store(slot.bytes.load(std::memory_order_relaxed) + bytes, std::memory_order_relaxed);
+        }
+
+        Slot  m_Slots[slots];
+        Slot  m_Overflow[static_cast<size_t>(ErrorCode::E033) + 1];  ///< Per code, the lines of combinations that did not fit
+        Slot* m_Last = nullptr;  ///< The slot of the previous line, consecutive lines mostly share their labels
+    };
+
+    ParseCounters() = default;
+
+    ParseCounters(const ParseCounters&) = delete;
+    ParseCounters& operator=(const ParseCounters&) = delete;
+
+    /// <summary>
+    ///        Adds a shard for a parser.
+    /// </summary>
+    /// \return The shard, valid for the lifetime of the counters
+    Shard& addShard();
+
+    /// <summary>
+    ///        Adds up the shards.
+    /// </summary>
+    /// \return An entry per combination of labels counted, sorted by source, talker, formatter and code.
+    /// The lines of a shard that did not fit in its 1024 combinations are in entries with the formatter "other".
+    std::vector<Entry> snapshot() const;
+
+private:
+    mutable std::mutex                  m_Mutex;
+    std::vector<std::unique_ptr<Shard>> m_Shards;
+};
@@ -0,0 +1,43 @@
+﻿#pragma once
+
+// Static tracepoints (USDT) of the provider nmea, for bpftrace, perf and other tools reading sys/sdt.h probes.
+// A probe is a single nop until a tracer attaches, and its arguments are registers or constants, so the probes
+// are built in whenever sys/sdt.h is found. Build with NMEA_PROBES=0 to leave them out.
+//
+//   nmea:parse_start     (const char* line, size_t length, SourceId source)
+//   nmea:stage_start     (Stage stage)
+//   nmea:stage_end       (Stage stage, bool completed)
+//   nmea:error           (ErrorCode code, const char* indication)
+//   nmea:parse_end       (ErrorCode code, const char* header, size_t headerLength, SourceId source)
+//   nmea:dispatch_start  (SourceId source, size_t length)
+//   nmea:dispatch_end    (SourceId source)
+//
+// header is the header field, e.g. $GPGGA, with headerLength 0 for a line without a sentence. The dispatch probes
+// enclose the line handler of the IngestionEngine, so parse_end to dispatch_end is what the handler does after
+// parsing. See Tools/*.bt for examples.
+
+#if !defined(NMEA_PROBES)
+#if defined(__linux__) && __has_include(<sys/sdt.h>)
+#define NMEA_PROBES 1
+#else
+#define NMEA_PROBES 0
+#endif
+#endif
+
+#if NMEA_PROBES
+
+#include <sys/sdt.h>
+
+#define NMEA_PROBE1(name, a) DTRACE_PROBE1(nmea, name, a)
+#define NMEA_PROBE2(name, a, b) DTRACE_PROBE2(nmea, name, a, b)
+#define NMEA_PROBE3(name, a, b, c) DTRACE_PROBE3(nmea, name, a, b, c)
+#define NMEA_PROBE4(name, a, b, c, d) DTRACE_PROBE4(nmea, name, a, b, c, d)
+
+#else
+
+#define NMEA_PROBE1(name, a) ((void)0)
+#define NMEA_PROBE2(name, a, b) ((void)0)
+#define NMEA_PROBE3(name, a, b, c) ((void)0)
+#define NMEA_PROBE4(name, a, b, c, d) ((void)0)
+
+#endif
@@ -0,0 +1,411 @@
+﻿#include "Publisher.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "AisPosition.h"
+#include "Nmea.h"
+
+namespace
+{
+    const size_t maxSpare = 64;
+
+    uint32_t formatterCode(std::string_view formatter)
+    {
+        return static_cast<uint32_t>(static_cast<unsigned char>(formatter[0])) << 16 |
+            static_cast<uint32_t>(static_cast<unsigned char>(formatter[1])) << 8 |
+            static_cast<unsigned char>(formatter[2]);
+    }
+
+    // The formatter is the last three characters of the address field, e.g. GGA of $GPGGA
+    std::string_view formatter(const std::vector<std::string_view>& fields)
+    {
+        if (fields.empty() || fields[0].size() < 4)
+            return std::string_view();
+
+        return fields[0].substr(fields[0].size() - 3);
+    }
+}
+
+struct Publisher::Queue
+{
+    struct Entry
+    {
+        Delivery delivery;
+        uint64_t key;
+        int      priority;
+        bool     alarm;
+    };
+
+    typedef std::deque<Entry>::iterator Iterator;
+
+    Queue(Subscriber s, const Options& options) :
+        subscriber(std::move(s)),
+        capacity(std::max<size_t>(1, options.capacity)),
+        policy(options.policy),
+        validation(options.validation),
+        filter(),
+        key(options.key),
+        priorities(),
+        entries(),
+        latest(),
+        spare(),
+        waiting(false),
+        busy(false),
+        stopping(false),
+        statistics{}
+    {
+        for (const auto& [name, priority] : options.priorities)
+            if (name.size() == 3)
+                priorities[formatterCode(name)] = priority;
+
+        if (!options.addresses.empty())
+        {
+            filter = std::make_unique<SentenceFilter>();
+            for (const auto& address : options.addresses)
+                if (!filter->subscribe(address))
+                    throw std::invalid_argument("Can't subscribe to " + address);
+        }
+
+        thread = std::thread(&Queue::run, this);
+    }
+
+    ~Queue()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wakeup.notify_one();
+        thread.join();
+    }
+
+    int priorityOf(std::string_view code) const
+    {
+        if (priorities.empty() || code.size() != 3)
+            return 0;
+
+        const auto found = priorities.find(formatterCode(code));
+        return found == priorities.end() ? 0 : found->second;
+    }
+
+    // The line to drop for a line published to a full queue, or entries.end() to drop the line published
+    Iterator victim(bool alarm, int priority)
+    {
+        switch (policy)
+        {
+        case DropPolicy::dropNewest:
+            if (alarm)
+            {
+                for (auto i = entries.end(); i != entries.begin();)
+                    if (!(--i)->alarm)
+                        return i;
+            }
+            return entries.end();
+
+        case DropPolicy::byPriority:
+        {
+            auto lowest = entries.end();
+            for (auto i = entries.begin(); i != entries.end(); ++i)
+                if (!i->alarm && (lowest == entries.end() || i->priority < lowest->priority))
+                    lowest = i;
+
+            if (lowest != entries.end() && !alarm && lowest->priority > priority)
+                return entries.end();
+            return lowest;
+        }
+
+        default:
+            return std::find_if(entries.begin(), entries.end(), [](const Entry& entry) { return !entry.alarm; });
+        }
+    }
+
+    void remove(Iterator i)
+    {
+        if (i == entries.begin())
+        {
+            forget(*i);
+            entries.pop_front();
+            return;
+        }
+
+        entries.erase(i);
+
+        // Erasing in the middle moves the entries, find them again
+        if (!latest.empty())
+        {
+            latest.clear();
+            for (auto& entry : entries)
+                if (entry.key != 0)
+                    latest[entry.key] = &entry;
+        }
+    }
+
+    void forget(const Entry& entry)
+    {
+        if (entry.key == 0)
+            return;
+
+        const auto found = latest.find(entry.key);
+        if (found != latest.end() && found->second == &entry)
+            latest.erase(found);
+    }
+
+    void publish(std::string_view line, const Nmea& nmea, const std::vector<std::pair<uint16_t, uint16_t>>& spans,
+        std::string_view code, bool alarm)
+    {
+        if (filter && !filter->passes(line))
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ++statistics.published;
+            ++statistics.filtered;
+            return;
+        }
+
+        if (validation && (nmea.errorCode() != ErrorCode::E000 || nmea.validated() < *validation))
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ++statistics.published;
+            ++statistics.rejected;
+            return;
+        }
+
+        const uint64_t lineKey = policy == DropPolicy::latestPerKey && !alarm ? key(nmea) : 0;
+        const int priority = policy == DropPolicy::byPriority ? priorityOf(code) : 0;
+
+        bool wake;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ++statistics.published;
+
+            if (lineKey != 0)
+            {
+                const auto found = latest.find(lineKey);
+                if (found != latest.end())
+                {
+                    // The line takes the place of the line replaced in the queue
+                    fill(*found->second, line, nmea, spans);
+                    ++statistics.replaced;
+                    return;
+                }
+            }
+
+            if (entries.size() >= capacity)
+            {
+                const auto i = victim(alarm, priority);
+                if (i != entries.end())
+                {
+                    remove(i);
+                    ++statistics.dropped;
+                }
+                else if (!alarm)
+                {
+                    ++statistics.dropped;
+                    return;
+                }
+                // else the queue holds alarms only, and grows beyond its capacity
+            }
+
+            if (spare.empty())
+            {
+                entries.emplace_back();
+            }
+            else
+            {
+                entries.push_back(std::move(spare.back()));
+                spare.pop_back();
+            }
+
+            auto& entry = entries.back();
+            fill(entry, line, nmea, spans);
+            entry.key = lineKey;
+            entry.priority = priority;
+            entry.alarm = alarm;
+            if (lineKey != 0)
+                latest[lineKey] = &entry;
+
+            if (alarm)
+                ++statistics.alarms;
+            statistics.maxQueued = std::max(statistics.maxQueued, entries.size());
+            wake = waiting;
+        }
+
+        if (wake)
+            wakeup.notify_one();
+    }
+
+    static void fill(Entry& entry, std::string_view line, const Nmea& nmea, const std::vector<std::pair<uint16_t, uint16_t>>& spans)
+    {
+        entry.delivery.line.assign(line.data(), line.size());
+        entry.delivery.origin = nmea.origin();
+        entry.delivery.spans = spans;
+    }
+
+    void run()
+    {
+        Entry current;
+
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;)
+        {
+            waiting = true;
+            wakeup.wait(lock, [this] { return !entries.empty() || stopping; });
+            waiting = false;
+
+            if (entries.empty())
+                return;
+
+            forget(entries.front());
+            current = std::move(entries.front());
+            entries.pop_front();
+            busy = true;
+
+            lock.unlock();
+            subscriber(current.delivery);
+            lock.lock();
+
+            busy = false;
+            ++statistics.delivered;
+
+            // The buffers of the line delivered are used for a later line
+            if (spare.size() < maxSpare)
+                spare.push_back(std::move(current));
+
+            if (entries.empty())
+                drained.notify_all();
+        }
+    }
+
+    Subscriber                   subscriber;
+    size_t                       capacity;
+    DropPolicy                   policy;
+    std::optional<Validation>    validation;
+    std::unique_ptr<SentenceFilter> filter;   // nullptr for all lines
+    KeyFunction                  key;
+    std::unordered_map<uint32_t, int> priorities;
+
+    // Guarded by the mutex
+    std::deque<Entry>            entries;
+    std::unordered_map<uint64_t, Entry*> latest;   // The entry of each key, for DropPolicy::latestPerKey
+    std::vector<Entry>           spare;
+    bool                         waiting;
+    bool                         busy;
+    bool                         stopping;
+    Statistics                   statistics;
+
+    mutable std::mutex           mutex;
+    std::condition_variable      wakeup;
+    std::condition_variable      drained;
+    std::thread                  thread;
+};
+
+Publisher::Publisher() :
+    m_Queues(),
+    m_Filter()
+{
+}
+
+Publisher::~Publisher()
+{
+}
+
+size_t Publisher::subscribe(Subscriber subscriber, const Options& options)
+{
+    m_Queues.push_back(std::make_unique<Queue>(std::move(subscriber), options));
+
+    if (options.addresses.empty())
+        m_Filter.subscribe("*");
+    for (const auto& address : options.addresses)
+        m_Filter.subscribe(address);
+
+    return m_Queues.size() - 1;
+}
+
+size_t Publisher::subscribe(Subscriber subscriber)
+{
+    return subscribe(std::move(subscriber), Options());
+}
+
+void Publisher::publish(std::string_view line, const Nmea& nmea)
+{
+    const auto& fields = nmea.sentenceFields();
+
+    thread_local std::vector<std::pair<uint16_t, uint16_t>> spans;
+    spans.clear();
+    for (const auto& field : fields)
+    {
+        // Empty fields have no characters, and are given the position 0
+        if (field.empty())
+            spans.emplace_back(uint16_t(0), uint16_t(0));
+        else
+            spans.emplace_back(static_cast<uint16_t>(field.data() - line.data()), static_cast<uint16_t>(field.size()));
+    }
+
+    const auto code = formatter(fields);
+    const bool alarm = isAlarm(code);
+
+    for (auto& queue : m_Queues)
+        queue->publish(line, nmea, spans, code, alarm);
+}
+
+void Publisher::flush()
+{
+    for (auto& queue : m_Queues)
+    {
+        std::unique_lock<std::mutex> lock(queue->mutex);
+        queue->drained.wait(lock, [&] { return queue->entries.empty() && !queue->busy; });
+    }
+}
+
+Publisher::Statistics Publisher::statistics(size_t i) const
+{
+    const auto& queue = *m_Queues[i];
+
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    Statistics statistics = queue.statistics;
+    statistics.queued = queue.entries.size();
+    return statistics;
+}
+
+Validation Publisher::validation() const
+{
+    Validation deepest = Validation::framing;
+    for (const auto& queue : m_Queues)
+        if (queue->validation && *queue->validation > deepest)
+            deepest = *queue->validation;
+
+    return deepest;
+}
+
+bool Publisher::isAlarm(std::string_view formatter) noexcept
+{
+    return formatter == "ALR" || formatter == "ALF" || formatter == "ACN" || formatter == "ARC";
+}
+
+uint64_t Publisher::byFormatter(const Nmea& nmea)
+{
+    const auto code = formatter(nmea.sentenceFields());
+    return code.empty() ? 0 : formatterCode(code);
+}
+
+uint64_t Publisher::byMmsi(const Nmea& nmea)
+{
+    const auto& fields = nmea.sentenceFields();
+    const auto code = formatter(fields);
+
+    if (fields.size() == 8 && (code == "VDM" || code == "VDO") && fields[2] == "1" && fields[5].size() >= 7)
+    {
+        uint64_t bits = 0;
+        for (size_t i = 0; i < 7; ++i)
+            bits = bits << 6 | Ais::sixBitValue(fields[5][i]);
+
+        // 42 bits read, the MMSI is the 30 bits after the first 8, kept apart from the formatter keys
+        return 1ull << 32 | ((bits >> 4) & 0x3FFFFFFF);
+    }
+
+    // The later fragments of a multi fragment message have no MMSI, they are never replaced
+    if (code == "VDM" || code == "VDO")
+        return 0;
+
+    return byFormatter(nmea);
+}
@@ -0,0 +1,171 @@
+﻿#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "LineOrigin.h"
+#include "SentenceFilter.h"
+#include "Validation.h"
+
+class Nmea;
+
+/// <summary>
+///        Delivers parsed lines to subscribers, each through its own bounded queue and thread.
+/// </summary>
+/// Publishing never waits for a subscriber. When the queue of a slow subscriber is full, lines are shed by the
+/// drop policy of the subscriber and counted. Alarm sentences (ALR, ALF, ACN and ARC) are never shed: they are queued
+/// even if the queue is full, and other lines are dropped to make room for them.
+class Publisher
+{
+public:
+    /// <summary>
+    ///        What to drop when the queue of a subscriber is full.
+    /// </summary>
+    enum class DropPolicy
+    {
+        dropOldest,    ///< The oldest line queued, the subscriber sees the most recent lines
+        dropNewest,    ///< The line published, the subscriber sees the lines up to the first drop
+        latestPerKey,  ///< A line replaces the line queued with the same key, e.g. of the same MMSI, else dropOldest
+        byPriority     ///< The oldest line of the lowest priority, the line published if its priority is lower
+    };
+
+    /// <summary>
+    ///        A line delivered to a subscriber.
+    /// </summary>
+    struct Delivery
+    {
+        std::string line;
+        LineOrigin  origin;
+        std::vector<std::pair<uint16_t, uint16_t>> spans;  ///< The offset and length of each sentence field
+
+        /// Sentence field i, see Nmea::sentenceFields()
+        std::string_view field(size_t i) const { return std::string_view(line).substr(spans[i].first, spans[i].second); }
+
+        /// The number of sentence fields, 0 if the line has no sentence
+        size_t fields() const { return spans.size(); }
+    };
+
+    /// <summary>
+    ///        Called on the thread of the subscriber with each line delivered.
+    /// </summary>
+    typedef std::function<void(const Delivery& delivery)> Subscriber;
+
+    /// <summary>
+    ///        The key of a line for DropPolicy::latestPerKey. Lines with key 0 are never replaced.
+    /// </summary>
+    typedef std::function<uint64_t(const Nmea& nmea)> KeyFunction;
+
+    /// <summary>
+    ///        How the lines of a subscriber are queued.
+    /// </summary>
+    struct Options
+    {
+        size_t      capacity = 1024;
+        DropPolicy  policy = DropPolicy::dropOldest;
+        KeyFunction key = byFormatter;                       ///< For DropPolicy::latestPerKey
+        std::unordered_map<std::string, int> priorities;     ///< For DropPolicy::byPriority, formatter to priority,
+                                                             ///< higher is more important, 0 if not listed
+        std::optional<Validation> validation;                ///< If set, only lines checked without error to at least
+                                                             ///< this level are delivered, see Nmea::validated()
+        std::vector<std::string> addresses;                  ///< The sentences delivered, see SentenceFilter::subscribe,
+                                                             ///< e.g. GGA or AIVDM, all if empty
+    };
+
+    /// <summary>
+    ///        The counters of a subscriber.
+    /// </summary>
+    struct Statistics
+    {
+        uint64_t published;  ///< Lines published while subscribed
+        uint64_t delivered;  ///< Lines handed to the subscriber
+        uint64_t dropped;    ///< Lines shed because the queue was full
+        uint64_t replaced;   ///< Lines replaced by a later line with the same key
+        uint64_t alarms;     ///< Alarm lines queued
+        uint64_t rejected;   ///< Lines not checked to the validation level of the subscriber, or in error
+        uint64_t filtered;   ///< Lines not matching the addresses of the subscriber
+        size_t   queued;     ///< Lines in the queue now
+        size_t   maxQueued;  ///< The longest the queue has been
+    };
+
+    Publisher();
+
+    /// <summary>
+    ///        Delivers the lines queued, and stops the subscriber threads.
+    /// </summary>
+    ~Publisher();
+
+    Publisher(const Publisher&) = delete;
+    Publisher& operator=(const Publisher&) = delete;
+
+    /// <summary>
+    ///        Adds a subscriber with its own queue and thread.
+    /// </summary>
+    /// \pre Not called concurrently with publish
+    /// \return The index of the subscriber, for statistics()
+    /// \exception std::invalid_argument An address of the options can't be subscribed
+    size_t subscribe(Subscriber subscriber, const Options& options);
+
+    /// <summary>
+    ///        Adds a subscriber with the default Options, a queue of 1024 lines dropping the oldest.
+    /// </summary>
+    size_t subscribe(Subscriber subscriber);
+
+    /// <summary>
+    ///        Queues a line for each subscriber.
+    /// </summary>
+    /// May be called from any number of threads, and never waits for a subscriber.
+    /// \param line [in] The line given to nmea.parse.
+    /// \param nmea [in] The parser, after parsing the line.
+    void publish(std::string_view line, const Nmea& nmea);
+
+    /// <summary>
+    ///        Waits until the subscribers have been handed all lines queued.
+    /// </summary>
+    void flush();
+
+    /// The counters of subscriber i
+    Statistics statistics(size_t i) const;
+
+    /// The number of subscribers
+    size_t subscribers() const { return m_Queues.size(); }
+
+    /// <summary>
+    ///        The deepest validation level of the subscribers, to set the level of the sources parsed for them.
+    /// </summary>
+    /// \return Validation::framing if no subscriber sets a level
+    Validation validation() const;
+
+    /// <summary>
+    ///        Passes the lines wanted by any subscriber, to drop the others before parsing them.
+    /// </summary>
+    /// \code{.cpp}
+    ///     parser.setFilter(&publisher.filter());
+    /// \endcode
+    const SentenceFilter& filter() const { return m_Filter; }
+
+    /// true for the formatters of alarm sentences, which are never shed
+    static bool isAlarm(std::string_view formatter) noexcept;
+
+    /// A KeyFunction keeping the latest line of each formatter, e.g. the latest GGA
+    static uint64_t byFormatter(const Nmea& nmea);
+
+    /// A KeyFunction keeping the latest AIS message of each MMSI, and of each formatter for other lines
+    static uint64_t byMmsi(const Nmea& nmea);
+
+private:
+    struct Queue;
+
+    std::vector<std::unique_ptr<Queue>> m_Queues;
+    SentenceFilter                      m_Filter;
+};
@@ -0,0 +1,177 @@
+﻿#include "ReplayEngine.h"
+
+#include <algorithm>
+#include <charconv>
+#include <string>
+#include <thread>
+
+namespace
+{
+    const int64_t nanosecondsPerSecond = 1000000000;
+
+    // The c: parameter of a tag block at the start of the line, in nanoseconds
+    bool tagBlockTime(std::string_view line, int64_t& time)
+    {
+        if (line.empty() || line[0] != '\\')
+            return false;
+
+        const size_t end = line.find('\\', 1);
+        if (end == std::string_view::npos)
+            return false;
+
+        // The parameters are separated by commas and end with the checksum
+        const std::string_view tagBlock = line.substr(1, end - 1);
+        for (size_t begin = 0; begin < tagBlock.size();)
+        {
+            size_t next = tagBlock.find_first_of(",*", begin);
+            if (next == std::string_view::npos)
+                next = tagBlock.size();
+
+            const auto parameter = tagBlock.substr(begin, next - begin);
+            if (parameter.size() > 2 && parameter[0] == 'c' && parameter[1] == ':')
+            {
+                int64_t seconds = 0;
+                const auto result = std::from_chars(parameter.data() + 2, parameter.data() + parameter.size(), seconds);
+                if (result.ec != std::errc() || seconds > INT64_MAX / nanosecondsPerSecond)
+                    return false;
+
+                time = seconds * nanosecondsPerSecond;
+                return true;
+            }
+
+            if (next < tagBlock.size() && tagBlock[next] == '*')
+                break;
+            begin = next + 1;
+        }
+
+        return false;
+    }
+}
+
+ReplayEngine::ReplayEngine(IReplaySink& sink, double speed) :
+    m_Sink(sink),
+    m_Speed(speed),
+    m_SpinTime(std::chrono::microseconds(200)),
+    m_Stopping(false),
+    m_Start(),
+    m_LastDue(),
+    m_FirstTime(0),
+    m_HasFirstTime(false),
+    m_Lines(0),
+    m_ErrorSum(0),
+    m_MaxError(0),
+    m_ErrorHistogram()
+{
+}
+
+ReplayEngine::Statistics ReplayEngine::replay(const Capture::Reader& reader, Capture::Reader::Cursor from)
+{
+    begin();
+
+    Capture::Record record;
+    while (!m_Stopping.load(std::memory_order_relaxed) && reader.next(from, record))
+        emit(record.line, record.receiveTime, record.receiveTime != 0);
+
+    return end();
+}
+
+ReplayEngine::Statistics ReplayEngine::replay(std::istream& text)
+{
+    begin();
+
+    std::string line;
+    while (!m_Stopping.load(std::memory_order_relaxed) && std::getline(text, line))
+    {
+        int64_t time = 0;
+        const bool timed = tagBlockTime(line, time);
+
+        // getline drops the LF, the sink gets the line as it was recorded
+        line += '\n';
+        emit(line, time, timed);
+    }
+
+    return end();
+}
+
+void ReplayEngine::begin()
+{
+    m_Stopping.store(false, std::memory_order_relaxed);
+    m_Start = Clock::now();
+    m_LastDue = m_Start;
+    m_FirstTime = 0;
+    m_HasFirstTime = false;
+    m_Lines = 0;
+    m_ErrorSum = 0;
+    m_MaxError = 0;
+    m_ErrorHistogram.fill(0);
+}
+
+void ReplayEngine::emit(std::string_view line, int64_t time, bool timed)
+{
+    if (timed && !m_HasFirstTime)
+    {
+        // The first timed line sets the origin of the replay
+        m_FirstTime = time;
+        m_HasFirstTime = true;
+        m_Start = m_LastDue = Clock::now();
+    }
+
+    int64_t error = 0;
+    if (timed && m_Speed > 0)
+    {
+        const auto offset = std::chrono::nanoseconds(static_cast<int64_t>(static_cast<double>(time - m_FirstTime) / m_Speed));
+        // A line recorded before the line before it is due right away
+        const auto due = std::max(m_Start + offset, m_LastDue);
+        m_LastDue = due;
+
+        auto now = Clock::now();
+        if (due - now > m_SpinTime)
+        {
+            std::this_thread::sleep_for(due - now - m_SpinTime);
+            now = Clock::now();
+        }
+        while (now < due)
+            now = Clock::now();
+
+        error = std::chrono::duration_cast<std::chrono::nanoseconds>(now - due).count();
+    }
+
+    m_Sink.emit(line);
+
+    ++m_Lines;
+    m_ErrorSum += static_cast<double>(error);
+    m_MaxError = std::max(m_MaxError, error);
+
+    size_t bucket = 0;
+    while (bucket + 1 < m_ErrorHistogram.size() && (int64_t(1) << bucket) <= error)
+        ++bucket;
+    ++m_ErrorHistogram[bucket];
+}
+
+ReplayEngine::Statistics ReplayEngine::end() const
+{
+    Statistics statistics{};
+    statistics.lines = m_Lines;
+    statistics.seconds = std::chrono::duration<double>(Clock::now() - m_Start).count();
+    statistics.rate = statistics.seconds > 0 ? m_Lines / statistics.seconds : 0;
+
+    if (m_Lines > 0)
+    {
+        statistics.meanError = m_ErrorSum / static_cast<double>(m_Lines) / 1000;
+        statistics.maxError = static_cast<double>(m_MaxError) / 1000;
+
+        // The bucket holding the 99th percentile
+        uint64_t count = 0;
+        for (size_t i = 0; i < m_ErrorHistogram.size(); ++i)
+        {
+            count += m_ErrorHistogram[i];
+            if (count * 100 >= m_Lines * 99)
+            {
+                statistics.p99Error = std::min(static_cast<double>(int64_t(1) << i) / 1000, statistics.maxError);
+                break;
+            }
+        }
+    }
+
+    return statistics;
+}
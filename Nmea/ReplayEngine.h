@@ -0,0 +1,87 @@
+﻿#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <istream>
+#include <string_view>
+
+#include "Capture.h"
+#include "IReplaySink.h"
+
+/// <summary>
+///        Replays recorded lines to a sink at the pace they were received, or faster.
+/// </summary>
+/// The time of a line is the receive time of a capture record, or the c: parameter of the tag block of a text line.
+/// Text lines without c: are emitted right after the line before. Each line is emitted when its time, relative to
+/// the first line and divided by the speed, has passed: the engine sleeps until shortly before, and spins the rest,
+/// as a sleep alone overshoots by the timer slack of the operating system.
+class ReplayEngine
+{
+public:
+    /// The speed that emits the lines without waiting
+    static constexpr double asFastAsPossible = 0.0;
+
+    /// <summary>
+    ///        The outcome of a replay.
+    /// </summary>
+    struct Statistics
+    {
+        uint64_t lines;
+        double   seconds;      ///< Wall clock time of the replay
+        double   rate;         ///< Lines per second achieved
+        double   meanError;    ///< Mean lateness of the lines, in microseconds
+        double   p99Error;     ///< 99th percentile lateness, in microseconds, rounded up to a power of two nanoseconds
+        double   maxError;     ///< Maximum lateness, in microseconds
+    };
+
+    /// <summary>
+    ///        Creates an engine emitting to a sink.
+    /// </summary>
+    /// \param sink [in] Where the lines go, it shall outlive the engine.
+    /// \param speed [in] 1 for real time, 10 for ten times faster, asFastAsPossible for no pacing.
+    explicit ReplayEngine(IReplaySink& sink, double speed = 1.0);
+
+    /// <summary>
+    ///        How long before a line the engine stops sleeping and starts spinning. 0 sleeps only.
+    /// </summary>
+    void setSpinTime(std::chrono::nanoseconds spinTime) { m_SpinTime = spinTime; }
+
+    /// <summary>
+    ///        Replays the records of a capture file, from a cursor to the end.
+    /// </summary>
+    Statistics replay(const Capture::Reader& reader, Capture::Reader::Cursor from);
+
+    /// <summary>
+    ///        Replays a text log, one line per line of the stream.
+    /// </summary>
+    Statistics replay(std::istream& text);
+
+    /// <summary>
+    ///        Ends a replay running on another thread after the line being emitted.
+    /// </summary>
+    void stop() { m_Stopping.store(true, std::memory_order_relaxed); }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    void begin();
+    void emit(std::string_view line, int64_t time, bool timed);
+    Statistics end() const;
+
+    IReplaySink&             m_Sink;
+    double                   m_Speed;
+    std::chrono::nanoseconds m_SpinTime;
+    std::atomic<bool>        m_Stopping;
+
+    // The state of the current replay
+    Clock::time_point        m_Start;
+    Clock::time_point        m_LastDue;
+    int64_t                  m_FirstTime;
+    bool                     m_HasFirstTime;
+    uint64_t                 m_Lines;
+    double                   m_ErrorSum;
+    int64_t                  m_MaxError;
+    std::array<uint64_t, 64> m_ErrorHistogram;   // Bucket i counts the errors below 2^i nanoseconds
+};
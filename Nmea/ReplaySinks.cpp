@@ -0,0 +1,105 @@
+﻿#include "ReplaySinks.h"
+
+#if defined(__linux__)
+
+#include <cerrno>
+#include <cstdlib>
+#include <system_error>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <termios.h>
+#include <unistd.h>
+
+namespace
+{
+    [[noreturn]] void throwSystemError(const char* what)
+    {
+        throw std::system_error(errno, std::generic_category(), what);
+    }
+}
+
+UdpSink::UdpSink(const std::string& address, uint16_t port) :
+    m_Fd(::socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0)),
+    m_Dropped(0)
+{
+    if (m_Fd < 0)
+        throwSystemError("socket");
+
+    sockaddr_in remote{};
+    remote.sin_family = AF_INET;
+    remote.sin_port = htons(port);
+    if (::inet_pton(AF_INET, address.c_str(), &remote.sin_addr) != 1)
+    {
+        ::close(m_Fd);
+        errno = EINVAL;
+        throwSystemError("address");
+    }
+
+    // Connected, so each line is a plain send
+    if (::connect(m_Fd, reinterpret_cast<sockaddr*>(&remote), sizeof(remote)) < 0)
+    {
+        const int error = errno;
+        ::close(m_Fd);
+        errno = error;
+        throwSystemError("connect");
+    }
+}
+
+UdpSink::~UdpSink()
+{
+    ::close(m_Fd);
+}
+
+void UdpSink::emit(std::string_view line)
+{
+    // A receiver that is not listening yet is not an error of the replay
+    if (::send(m_Fd, line.data(), line.size(), 0) < 0)
+        ++m_Dropped;
+}
+
+PtySink::PtySink() :
+    m_Master(::posix_openpt(O_RDWR | O_NOCTTY | O_CLOEXEC)),
+    m_Device()
+{
+    if (m_Master < 0 || ::grantpt(m_Master) < 0 || ::unlockpt(m_Master) < 0)
+    {
+        const int error = errno;
+        if (m_Master >= 0)
+            ::close(m_Master);
+        errno = error;
+        throwSystemError("posix_openpt");
+    }
+
+    m_Device = ::ptsname(m_Master);
+
+    // Raw, so the line discipline neither echoes nor translates CR LF
+    termios settings{};
+    if (::tcgetattr(m_Master, &settings) == 0)
+    {
+        ::cfmakeraw(&settings);
+        ::tcsetattr(m_Master, TCSANOW, &settings);
+    }
+}
+
+PtySink::~PtySink()
+{
+    ::close(m_Master);
+}
+
+void PtySink::emit(std::string_view line)
+{
+    for (size_t written = 0; written < line.size();)
+    {
+        const ssize_t count = ::write(m_Master, line.data() + written, line.size() - written);
+        if (count < 0 && errno == EINTR)
+            continue;
+        if (count <= 0)
+            return;
+        written += static_cast<size_t>(count);
+    }
+}
+
+#endif
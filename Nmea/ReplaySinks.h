@@ -0,0 +1,81 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+
+#include "IReplaySink.h"
+
+/// <summary>
+///        Hands each replayed line to a function.
+/// </summary>
+class CallbackSink : public IReplaySink
+{
+public:
+    explicit CallbackSink(std::function<void(std::string_view line)> callback) : m_Callback(std::move(callback)) {}
+
+    void emit(std::string_view line) override { m_Callback(line); }
+
+private:
+    std::function<void(std::string_view line)> m_Callback;
+};
+
+#if defined(__linux__)
+
+/// <summary>
+///        Sends each replayed line as a UDP datagram, e.g. to a receiver on the loopback interface.
+/// </summary>
+/// \note Linux only.
+class UdpSink : public IReplaySink
+{
+public:
+    /// <summary>
+    ///        Opens the socket.
+    /// </summary>
+    /// \param address [in] The IPv4 address of the receiver, e.g. "127.0.0.1" or a multicast group.
+    /// \exception std::system_error if the socket can't be opened or the address is invalid
+    UdpSink(const std::string& address, uint16_t port);
+    ~UdpSink();
+
+    UdpSink(const UdpSink&) = delete;
+    UdpSink& operator=(const UdpSink&) = delete;
+
+    void emit(std::string_view line) override;
+
+    /// The number of lines the socket did not accept
+    uint64_t dropped() const { return m_Dropped; }
+
+private:
+    int      m_Fd;
+    uint64_t m_Dropped;
+};
+
+/// <summary>
+///        Writes each replayed line to a pseudo terminal, which a program under test opens as if it were a serial port.
+/// </summary>
+/// \note Linux only.
+class PtySink : public IReplaySink
+{
+public:
+    /// <summary>
+    ///        Creates the pseudo terminal.
+    /// </summary>
+    /// \exception std::system_error if no pseudo terminal is available
+    PtySink();
+    ~PtySink();
+
+    PtySink(const PtySink&) = delete;
+    PtySink& operator=(const PtySink&) = delete;
+
+    /// The device to open, e.g. /dev/pts/3
+    const std::string& device() const { return m_Device; }
+
+    void emit(std::string_view line) override;
+
+private:
+    int         m_Master;
+    std::string m_Device;
+};
+
+#endif
@@ -0,0 +1,148 @@
+﻿#include "SentenceFilter.h"
+
+namespace
+{
+    const size_t invalid = static_cast<size_t>(-1);
+
+    // The index of upper case letters in base 26, invalid if a character is not an upper case letter
+    size_t letterIndex(std::string_view letters) noexcept
+    {
+        size_t index = 0;
+        for (const char c : letters)
+        {
+            if (c < 'A' || c > 'Z')
+                return invalid;
+            index = index * 26 + static_cast<size_t>(c - 'A');
+        }
+        return index;
+    }
+
+    void assign(std::atomic<uint64_t>* bits, size_t bit, bool value) noexcept
+    {
+        const uint64_t mask = uint64_t(1) << (bit % 64);
+        if (value)
+            bits[bit / 64].fetch_or(mask, std::memory_order_relaxed);
+        else
+            bits[bit / 64].fetch_and(~mask, std::memory_order_relaxed);
+    }
+
+    size_t words(size_t bits)
+    {
+        return (bits + 63) / 64;
+    }
+}
+
+SentenceFilter::SentenceFilter() :
+    m_AnyTalker(std::make_unique<Word[]>(words(formatters))),
+    m_SomeTalker(std::make_unique<Word[]>(words(formatters))),
+    m_Proprietary(std::make_unique<Word[]>(words(formatters))),
+    m_Pairs(nullptr),
+    m_All(false),
+    m_Mutex(),
+    m_Subscriptions()
+{
+}
+
+SentenceFilter::~SentenceFilter()
+{
+    delete[] m_Pairs.load(std::memory_order_relaxed);
+}
+
+bool SentenceFilter::subscribe(std::string_view address)
+{
+    // A talker never starts with P, which starts the address of proprietary sentences
+    const bool valid = address == "*" ||
+        (address.size() == 3 && letterIndex(address) != invalid) ||
+        (address.size() == 4 && address[0] == 'P' && letterIndex(address) != invalid) ||
+        (address.size() == 5 && address[0] != 'P' && letterIndex(address) != invalid);
+    if (!valid)
+        return false;
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    ++m_Subscriptions[std::string(address)];
+    update(address);
+    return true;
+}
+
+void SentenceFilter::unsubscribe(std::string_view address)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    const auto found = m_Subscriptions.find(std::string(address));
+    if (found == m_Subscriptions.end())
+        return;
+
+    if (--found->second == 0)
+        m_Subscriptions.erase(found);
+    update(address);
+}
+
+void SentenceFilter::update(std::string_view address)
+{
+    const bool subscribed = m_Subscriptions.count(std::string(address)) != 0;
+
+    if (address == "*")
+    {
+        m_All.store(subscribed, std::memory_order_relaxed);
+    }
+    else if (address.size() == 3)
+    {
+        assign(m_AnyTalker.get(), letterIndex(address), subscribed);
+    }
+    else if (address.size() == 4)
+    {
+        assign(m_Proprietary.get(), letterIndex(address.substr(1)), subscribed);
+    }
+    else
+    {
+        Word* pairs = m_Pairs.load(std::memory_order_relaxed);
+        if (pairs == nullptr)
+        {
+            pairs = new Word[words(formatters * talkers)]();
+            m_Pairs.store(pairs, std::memory_order_release);
+        }
+
+        const size_t formatter = letterIndex(address.substr(2));
+        assign(pairs, formatter * talkers + letterIndex(address.substr(0, 2)), subscribed);
+
+        // The formatter is looked up in the pairs while any of its talkers is subscribed
+        bool some = false;
+        for (const auto& [other, count] : m_Subscriptions)
+            some = some || (other.size() == 5 && other.compare(2, 3, address.substr(2)) == 0);
+        assign(m_SomeTalker.get(), formatter, some);
+    }
+}
+
+bool SentenceFilter::passes(std::string_view line) const noexcept
+{
+    if (m_All.load(std::memory_order_relaxed))
+        return true;
+
+    // Skip the characters before the first tag block or sentence, as Nmea::parseMainStructure, and the tag blocks
+    size_t start = line.find_first_of("$!\\");
+    while (start != std::string_view::npos && line[start] == '\\')
+    {
+        const size_t end = line.find('\\', start + 1);
+        start = end == std::string_view::npos || end + 1 >= line.size() ? std::string_view::npos : end + 1;
+    }
+
+    if (start == std::string_view::npos || (line[start] != '$' && line[start] != '!'))
+        return true;
+
+    const auto address = line.substr(start + 1, 5);
+    if (line[start] == '$' && !address.empty() && address[0] == 'P')
+    {
+        const size_t manufacturer = address.size() >= 4 ? letterIndex(address.substr(1, 3)) : invalid;
+        return manufacturer == invalid || test(m_Proprietary.get(), manufacturer);
+    }
+
+    const size_t talker = address.size() == 5 ? letterIndex(address.substr(0, 2)) : invalid;
+    const size_t formatter = address.size() == 5 ? letterIndex(address.substr(2)) : invalid;
+    if (talker == invalid || formatter == invalid || test(m_AnyTalker.get(), formatter))
+        return true;
+
+    if (!test(m_SomeTalker.get(), formatter))
+        return false;
+
+    const Word* pairs = m_Pairs.load(std::memory_order_acquire);
+    return pairs != nullptr && test(pairs, formatter * talkers + talker);
+}
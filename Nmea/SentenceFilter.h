@@ -0,0 +1,80 @@
+﻿#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+/// <summary>
+///        Tells from the address field alone whether a line is wanted by a subscription.
+/// </summary>
+/// passes() skips the tag blocks and reads the talker and formatter of the address field, e.g. GP and GGA of $GPGGA,
+/// and looks them up in bitmaps of the subscribed formatters, so the lines nobody wants can be dropped before their
+/// checksum and fields are checked. Subscriptions can be added and removed while other threads call passes().
+/// A line whose address can't be read passes, so its error is still found by Nmea::parse.
+/// \code{.cpp}
+///     SentenceFilter filter;
+///     filter.subscribe("GGA");     // Any talker
+///     filter.subscribe("AIVDM");   // One talker
+///     filter.subscribe("PGRM");    // A proprietary manufacturer
+///     if (filter.passes(line))
+///         nmea.parse(line);
+/// \endcode
+class SentenceFilter
+{
+public:
+    /// <summary>
+    ///        Creates a filter passing no sentence.
+    /// </summary>
+    SentenceFilter();
+    ~SentenceFilter();
+
+    SentenceFilter(const SentenceFilter&) = delete;
+    SentenceFilter& operator=(const SentenceFilter&) = delete;
+
+    /// <summary>
+    ///        Passes the sentences of an address.
+    /// </summary>
+    /// \param address [in] A formatter of any talker, e.g. GGA, a talker and formatter, e.g. GPGGA, a proprietary
+    ///        manufacturer, e.g. PGRM, or * for all sentences. Subscriptions are counted, so each needs its unsubscribe.
+    /// \return false if the address is not made of upper case letters as above
+    bool subscribe(std::string_view address);
+
+    /// <summary>
+    ///        Removes a subscription added with subscribe.
+    /// </summary>
+    void unsubscribe(std::string_view address);
+
+    /// <summary>
+    ///        Tells whether a line is wanted.
+    /// </summary>
+    /// \param line [in] A line as given to Nmea::parse.
+    bool passes(std::string_view line) const noexcept;
+
+private:
+    static const size_t letters = 26;
+    static const size_t formatters = letters * letters * letters;
+    static const size_t talkers = letters * letters;
+
+    typedef std::atomic<uint64_t> Word;
+
+    static bool test(const Word* bits, size_t bit) noexcept
+    {
+        return (bits[bit / 64].load(std::memory_order_relaxed) >> (bit % 64) & 1) != 0;
+    }
+
+    // Sets the bits of an address from the subscriptions, with the mutex locked
+    void update(std::string_view address);
+
+    std::unique_ptr<Word[]> m_AnyTalker;     ///< Per formatter, subscribed for any talker
+    std::unique_ptr<Word[]> m_SomeTalker;    ///< Per formatter, subscribed for some talkers, see m_Pairs
+    std::unique_ptr<Word[]> m_Proprietary;   ///< Per manufacturer
+    std::atomic<Word*>      m_Pairs;         ///< Per formatter and talker, allocated by the first talker subscription
+    std::atomic<bool>       m_All;
+
+    std::mutex                         m_Mutex;
+    std::map<std::string, size_t>      m_Subscriptions;  ///< The number of subscriptions of each address
+};
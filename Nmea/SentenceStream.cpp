@@ -0,0 +1,224 @@
+﻿#include "SentenceStream.h"
+
+#include <utility>
+
+namespace
+{
+    bool isPositionReport(const Nmea& nmea)
+    {
+        return Ais::decodePositionReport(nmea.sentenceFields()).has_value();
+    }
+}
+
+StreamTask& StreamTask::operator=(StreamTask&& other) noexcept
+{
+    if (this != &other)
+    {
+        if (m_Handle)
+            m_Handle.destroy();
+        m_Handle = std::exchange(other.m_Handle, nullptr);
+    }
+    return *this;
+}
+
+StreamTask::~StreamTask()
+{
+    if (m_Handle)
+        m_Handle.destroy();
+}
+
+void StreamTask::rethrow() const
+{
+    if (m_Handle && m_Handle.done() && m_Handle.promise().error)
+        std::rethrow_exception(m_Handle.promise().error);
+}
+
+bool SentenceStream::NextPositionReport::await_suspend(std::coroutine_handle<> handle)
+{
+    for (;;)
+    {
+        if (m_Stream.wait(handle, isPositionReport))
+            return true;
+
+        // Lines arrived after await_ready
+        if (decode())
+            return false;
+    }
+}
+
+std::optional<Ais::PositionReport> SentenceStream::NextPositionReport::await_resume()
+{
+    // Resumed with the report handed over in place, or at the end of the stream
+    if (!m_Report)
+        decode();
+
+    return m_Report;
+}
+
+bool SentenceStream::NextPositionReport::decode()
+{
+    while (m_Stream.ready())
+    {
+        const Nmea* nmea = m_Stream.take();
+        if (nmea == nullptr)
+            return true;
+
+        m_Report = Ais::decodePositionReport(nmea->sentenceFields());
+        if (m_Report)
+            return true;
+    }
+
+    return false;
+}
+
+SentenceStream::SentenceStream(SourceId source, size_t capacity, SourceInterner& interner) :
+    m_Source(source),
+    m_Nmea(interner),
+    m_Ring(capacity == 0 ? 1 : capacity),
+    m_Head(0),
+    m_Count(0),
+    m_Line(),
+    m_Parsed(false),
+    m_Waiting(),
+    m_Accept(nullptr),
+    m_Closed(false),
+    m_Dropped(0),
+    m_Mutex()
+{
+}
+
+uint64_t SentenceStream::dropped() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Dropped;
+}
+
+void SentenceStream::deliver(const LineOrigin& origin, std::string_view line)
+{
+    std::coroutine_handle<> waiting;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        if (m_Closed)
+            return;
+
+        if (m_Waiting)
+        {
+            // The coroutine is suspended, so the parser is free, and the line is parsed in place
+            m_Nmea.parse(line, origin);
+            if (m_Accept == nullptr || m_Accept(m_Nmea))
+            {
+                waiting = std::exchange(m_Waiting, nullptr);
+                m_Parsed = true;
+            }
+        }
+        else if (m_Count == m_Ring.size())
+        {
+            ++m_Dropped;
+        }
+        else
+        {
+            // The buffers of the slots are reused, nothing is allocated once the longest line has been seen
+            auto& slot = m_Ring[(m_Head + m_Count) % m_Ring.size()];
+            slot.line.assign(line.data(), line.size());
+            slot.origin = origin;
+            ++m_Count;
+        }
+    }
+
+    // The coroutine runs until it waits again, while the line is still valid
+    if (waiting)
+        waiting.resume();
+}
+
+void SentenceStream::close()
+{
+    std::coroutine_handle<> waiting;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Closed = true;
+        waiting = std::exchange(m_Waiting, nullptr);
+    }
+
+    if (waiting)
+        waiting.resume();
+}
+
+bool SentenceStream::ready()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Parsed || m_Count > 0 || m_Closed;
+}
+
+bool SentenceStream::wait(std::coroutine_handle<> handle, Accept accept)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    if (m_Parsed || m_Count > 0 || m_Closed)
+        return false;
+
+    m_Waiting = handle;
+    m_Accept = accept;
+    return true;
+}
+
+const Nmea* SentenceStream::take()
+{
+    LineOrigin origin;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        if (m_Parsed)
+        {
+            m_Parsed = false;
+            return &m_Nmea;
+        }
+
+        if (m_Count == 0)
+            return nullptr;
+
+        auto& slot = m_Ring[m_Head];
+        std::swap(m_Line, slot.line);
+        origin = slot.origin;
+        m_Head = (m_Head + 1) % m_Ring.size();
+        --m_Count;
+    }
+
+    // Only the coroutine uses the parser while it runs
+    m_Nmea.parse(m_Line, origin);
+    return &m_Nmea;
+}
+
+StreamRouter::StreamRouter(size_t capacity, SourceInterner& interner) :
+    m_Capacity(capacity),
+    m_Interner(interner),
+    m_Streams(65536)
+{
+}
+
+StreamRouter::~StreamRouter()
+{
+}
+
+SentenceStream& StreamRouter::stream(SourceId source)
+{
+    auto& stream = m_Streams[source];
+    if (!stream)
+        stream.reset(new SentenceStream(source, m_Capacity, m_Interner));
+
+    return *stream;
+}
+
+bool StreamRouter::route(const LineOrigin& origin, std::string_view line)
+{
+    const auto& stream = m_Streams[origin.source];
+    if (!stream)
+        return false;
+
+    stream->deliver(origin, line);
+    return true;
+}
+
+void StreamRouter::close()
+{
+    for (auto& stream : m_Streams)
+        if (stream)
+            stream->close();
+}
@@ -0,0 +1,219 @@
+﻿#pragma once
+
+#include <coroutine>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "AisPosition.h"
+#include "LineOrigin.h"
+#include "Nmea.h"
+
+/// <summary>
+///        A coroutine consuming sentence streams, started when it is called and run by whoever resumes it.
+/// </summary>
+/// \code{.cpp}
+///     StreamTask track(SentenceStream& stream)
+///     {
+///         while (const Nmea* nmea = co_await stream.next())
+///             ...
+///     }
+/// \endcode
+class StreamTask
+{
+public:
+    struct promise_type
+    {
+        StreamTask get_return_object() { return StreamTask(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { error = std::current_exception(); }
+
+        std::exception_ptr error;
+    };
+
+    StreamTask(StreamTask&& other) noexcept : m_Handle(other.m_Handle) { other.m_Handle = nullptr; }
+    StreamTask& operator=(StreamTask&& other) noexcept;
+
+    /// <summary>
+    ///        Destroys the coroutine.
+    /// </summary>
+    /// \pre done(), or the streams it waits for are closed
+    ~StreamTask();
+
+    /// true when the coroutine has returned
+    bool done() const noexcept { return !m_Handle || m_Handle.done(); }
+
+    /// <summary>
+    ///        Throws the exception the coroutine ended with, if any.
+    /// </summary>
+    void rethrow() const;
+
+private:
+    explicit StreamTask(std::coroutine_handle<promise_type> handle) noexcept : m_Handle(handle) {}
+
+    std::coroutine_handle<promise_type> m_Handle;
+};
+
+class StreamRouter;
+
+/// <summary>
+///        The lines of one source, awaited by a coroutine.
+/// </summary>
+/// A line arriving while the coroutine waits in next() is parsed and handed over in place, by resuming the coroutine
+/// on the thread delivering the line, e.g. the event loop thread of an IngestionEngine. A line arriving while the
+/// coroutine is busy is copied into a ring of lines allocated once, or dropped and counted if the ring is full.
+/// Nothing is allocated per line awaited, the coroutine frame and the awaiters live as long as the coroutine.
+class SentenceStream
+{
+public:
+    /// <summary>
+    ///        The awaiter of next(), resuming with the parsed line, or nullptr at the end of the stream.
+    /// </summary>
+    class Next
+    {
+    public:
+        explicit Next(SentenceStream& stream) noexcept : m_Stream(stream) {}
+
+        bool await_ready() noexcept { return m_Stream.ready(); }
+        bool await_suspend(std::coroutine_handle<> handle) { return m_Stream.wait(handle, nullptr); }
+        const Nmea* await_resume() { return m_Stream.take(); }
+
+    private:
+        SentenceStream& m_Stream;
+    };
+
+    /// <summary>
+    ///        The awaiter of nextPositionReport(), skipping the lines that are not AIS position reports.
+    /// </summary>
+    /// The lines skipped while the coroutine waits do not resume it.
+    class NextPositionReport
+    {
+    public:
+        explicit NextPositionReport(SentenceStream& stream) noexcept : m_Stream(stream), m_Report() {}
+
+        bool await_ready() { return decode(); }
+        bool await_suspend(std::coroutine_handle<> handle);
+        std::optional<Ais::PositionReport> await_resume();
+
+    private:
+        // Takes the lines available, true when a report is decoded or the stream has ended
+        bool decode();
+
+        SentenceStream&                    m_Stream;
+        std::optional<Ais::PositionReport> m_Report;
+    };
+
+    SentenceStream(const SentenceStream&) = delete;
+    SentenceStream& operator=(const SentenceStream&) = delete;
+
+    /// <summary>
+    ///        Waits for the next line of the source.
+    /// </summary>
+    /// \return An awaitable resuming with the parser, after parsing the line, or nullptr when the stream is closed.
+    ///         The parser and the line it refers to are valid until the next co_await on the stream.
+    Next next() noexcept { return Next(*this); }
+
+    /// <summary>
+    ///        Waits for the next AIS position report of the source.
+    /// </summary>
+    /// \return An awaitable resuming with the report, or an empty optional when the stream is closed.
+    NextPositionReport nextPositionReport() noexcept { return NextPositionReport(*this); }
+
+    /// The source of the stream
+    SourceId source() const noexcept { return m_Source; }
+
+    /// The number of lines dropped because the coroutine was busy and the ring was full
+    uint64_t dropped() const;
+
+private:
+    friend class StreamRouter;
+
+    SentenceStream(SourceId source, size_t capacity, SourceInterner& interner);
+
+    // Called by the router with each line of the source
+    void deliver(const LineOrigin& origin, std::string_view line);
+    void close();
+
+    // Selects the lines that resume a waiting coroutine, checked on the delivering thread
+    typedef bool (*Accept)(const Nmea& nmea);
+
+    // true if a line can be taken, or the stream has ended
+    bool ready();
+
+    // Suspends the coroutine until a line is accepted, false if a line can be taken without waiting
+    bool wait(std::coroutine_handle<> handle, Accept accept);
+
+    // The next line, parsed, or nullptr if the stream has ended
+    const Nmea* take();
+
+    struct Slot
+    {
+        std::string line;
+        LineOrigin  origin;
+    };
+
+    SourceId                m_Source;
+    Nmea                    m_Nmea;
+    std::vector<Slot>       m_Ring;
+    size_t                  m_Head;      // The next line to take
+    size_t                  m_Count;     // The lines in the ring
+    std::string             m_Line;      // The line taken from the ring
+    bool                    m_Parsed;    // m_Nmea holds a line handed over in place, not taken yet
+    std::coroutine_handle<> m_Waiting;
+    Accept                  m_Accept;
+    bool                    m_Closed;
+    uint64_t                m_Dropped;
+    mutable std::mutex      m_Mutex;
+};
+
+/// <summary>
+///        Routes the lines of many sources to their SentenceStream, e.g. as the handler of an IngestionEngine.
+/// </summary>
+/// \code{.cpp}
+///     StreamRouter router;
+///     IngestionEngine engine([&](const LineOrigin& origin, std::string_view line) { router.route(origin, line); });
+/// \endcode
+class StreamRouter
+{
+public:
+    /// <summary>
+    ///        Creates a router without streams.
+    /// </summary>
+    /// \param capacity [in] The number of lines each stream keeps while its coroutine is busy.
+    /// \param interner [in] The table the tag block sources are interned in.
+    explicit StreamRouter(size_t capacity = 64, SourceInterner& interner = SourceInterner::global());
+    ~StreamRouter();
+
+    StreamRouter(const StreamRouter&) = delete;
+    StreamRouter& operator=(const StreamRouter&) = delete;
+
+    /// <summary>
+    ///        The stream of a source, created on first use.
+    /// </summary>
+    /// \pre Not called concurrently with route
+    SentenceStream& stream(SourceId source);
+
+    /// <summary>
+    ///        Hands a line to the stream of its source, resuming the coroutine waiting for it.
+    /// </summary>
+    /// \return false if the source has no stream
+    bool route(const LineOrigin& origin, std::string_view line);
+
+    /// <summary>
+    ///        Ends all streams, resuming the waiting coroutines with the end of their stream.
+    /// </summary>
+    /// Call after the lines have stopped, e.g. after IngestionEngine::stop.
+    void close();
+
+private:
+    size_t                                       m_Capacity;
+    SourceInterner&                              m_Interner;
+    std::vector<std::unique_ptr<SentenceStream>> m_Streams;   // Indexed by SourceId
+};
@@ -0,0 +1,332 @@
+﻿#include "ShardedParser.h"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+#include "TraceRecorder.h"
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#elif defined(_WIN32)
+#include <windows.h>
+#endif
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    const size_t maxShards = 256;
+
+    bool pin(std::thread& thread, int cpu)
+    {
+#if defined(__linux__)
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        return ::pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set) == 0;
+#elif defined(_WIN32)
+        return cpu < 64 && ::SetThreadAffinityMask(thread.native_handle(), DWORD_PTR(1) << cpu) != 0;
+#else
+        (void)thread;
+        (void)cpu;
+        return false;
+#endif
+    }
+}
+
+struct ShardedParser::Shard
+{
+    Shard(size_t i, size_t queueSize, SourceInterner& interner) :
+        index(i), cpu(-1), nmea(interner), slots(queueSize), head(0), tail(0), waiting(false), stopping(false),
+        lines(0), dropped(0), busy(0), sourceLines(), filtered(0), filteredReported(0)
+    {
+    }
+
+    struct Slot
+    {
+        std::string line;
+        LineOrigin  origin;
+    };
+
+    size_t                  index;
+    int                     cpu;
+    Nmea                    nmea;
+    std::vector<Slot>       slots;
+    uint64_t                head;      // The next line to parse
+    uint64_t                tail;      // The next slot to fill
+    bool                    waiting;
+    bool                    stopping;
+    std::mutex              mutex;
+    std::condition_variable wakeup;
+    std::condition_variable drained;
+
+    // The load since the monitor looked last, guarded by the mutex
+    uint64_t                lines;
+    uint64_t                dropped;
+    Clock::duration         busy;
+    std::unordered_map<SourceId, uint64_t> sourceLines;
+
+    std::atomic<uint64_t>   filtered;          // Counted by submit without the mutex
+    uint64_t                filteredReported;  // By the monitor
+
+    std::thread             thread;
+
+    void run(const LineHandler& handler)
+    {
+        std::unordered_map<SourceId, uint64_t> parsed;
+        TraceRecorder::setThreadName("shard " + std::to_string(index));
+
+        for (;;)
+        {
+            uint64_t begin;
+            uint64_t end;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                waiting = true;
+                wakeup.wait(lock, [this] { return head != tail || stopping; });
+                waiting = false;
+
+                if (head == tail)
+                    return;
+
+                begin = head;
+                end = tail;
+            }
+
+            // The slots from head to tail are not touched by submit until head is moved
+            const auto start = Clock::now();
+            for (uint64_t i = begin; i < end; ++i)
+            {
+                auto& slot = slots[i % slots.size()];
+                if (TraceRecorder::recording() && slot.origin.receiveTime != 0)
+                    TraceRecorder::record("queued", slot.origin.receiveTime, TraceRecorder::now(), slot.origin.source);
+
+                nmea.parse(slot.line, slot.origin);
+                {
+                    TraceRecorder::Span span("dispatch", slot.origin.source);
+                    handler(index, slot.line, nmea);
+                }
+                ++parsed[slot.origin.source];
+            }
+            const auto elapsed = Clock::now() - start;
+
+            std::lock_guard<std::mutex> lock(mutex);
+            head = end;
+            lines += end - begin;
+            busy += elapsed;
+            for (auto& [source, count] : parsed)
+                sourceLines[source] += count;
+            parsed.clear();
+            drained.notify_all();
+        }
+    }
+};
+
+ShardedParser::ShardedParser(LineHandler handler, size_t shards, std::vector<int> cpus, size_t queueSize, SourceInterner& interner) :
+    m_Handler(std::move(handler)),
+    m_Shards(),
+    m_Assignment(std::make_unique<std::atomic<uint8_t>[]>(65536)),
+    m_Filter(nullptr),
+    m_Rebalancer(),
+    m_Interval(1000),
+    m_Change(0.25),
+    m_PreviousBusy(),
+    m_Stopping(false),
+    m_MonitorMutex(),
+    m_MonitorWakeup(),
+    m_Monitor()
+{
+    const size_t cores = std::max<size_t>(1, std::thread::hardware_concurrency());
+    if (shards == 0)
+        shards = cores;
+    shards = std::min(shards, maxShards);
+
+    for (size_t source = 0; source < 65536; ++source)
+        m_Assignment[source].store(static_cast<uint8_t>(source % shards), std::memory_order_relaxed);
+
+    for (size_t i = 0; i < shards; ++i)
+        m_Shards.push_back(std::make_unique<Shard>(i, queueSize == 0 ? 1 : queueSize, interner));
+
+    m_PreviousBusy.assign(shards, 0.0);
+
+    for (size_t i = 0; i < shards; ++i)
+    {
+        auto& shard = *m_Shards[i];
+        shard.thread = std::thread(&Shard::run, &shard, std::cref(m_Handler));
+
+        const int cpu = i < cpus.size() ? cpus[i] : static_cast<int>(i % cores);
+        if (pin(shard.thread, cpu))
+            shard.cpu = cpu;
+    }
+}
+
+ShardedParser::~ShardedParser()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_MonitorMutex);
+        m_Stopping = true;
+    }
+    m_MonitorWakeup.notify_all();
+    if (m_Monitor.joinable())
+        m_Monitor.join();
+
+    for (auto& shard : m_Shards)
+    {
+        {
+            std::lock_guard<std::mutex> lock(shard->mutex);
+            shard->stopping = true;
+        }
+        shard->wakeup.notify_one();
+    }
+
+    for (auto& shard : m_Shards)
+        shard->thread.join();
+}
+
+bool ShardedParser::submit(std::string_view line, const LineOrigin& origin)
+{
+    auto& shard = *m_Shards[m_Assignment[origin.source].load(std::memory_order_relaxed)];
+
+    const SentenceFilter* filter = m_Filter.load(std::memory_order_acquire);
+    if (filter != nullptr && !filter->passes(line))
+    {
+        shard.filtered.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    bool wakeup;
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        if (shard.tail - shard.head == shard.slots.size())
+        {
+            ++shard.dropped;
+            return false;
+        }
+
+        auto& slot = shard.slots[shard.tail % shard.slots.size()];
+        slot.line.assign(line.data(), line.size());
+        slot.origin = origin;
+        ++shard.tail;
+
+        wakeup = shard.waiting;
+    }
+
+    if (wakeup)
+        shard.wakeup.notify_one();
+
+    return true;
+}
+
+void ShardedParser::assign(SourceId source, size_t shard)
+{
+    if (shard < m_Shards.size())
+        m_Assignment[source].store(static_cast<uint8_t>(shard), std::memory_order_relaxed);
+}
+
+uint64_t ShardedParser::filtered() const
+{
+    uint64_t total = 0;
+    for (const auto& shard : m_Shards)
+        total += shard->filtered.load(std::memory_order_relaxed);
+    return total;
+}
+
+size_t ShardedParser::shardOf(SourceId source) const
+{
+    return m_Assignment[source].load(std::memory_order_relaxed);
+}
+
+void ShardedParser::flush()
+{
+    for (auto& shard : m_Shards)
+    {
+        std::unique_lock<std::mutex> lock(shard->mutex);
+        shard->drained.wait(lock, [&] { return shard->head == shard->tail; });
+    }
+}
+
+void ShardedParser::setRebalancer(Rebalancer rebalancer, std::chrono::milliseconds interval, double change)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_MonitorMutex);
+        m_Rebalancer = std::move(rebalancer);
+        m_Interval = interval;
+        m_Change = change;
+    }
+
+    if (!m_Monitor.joinable())
+        m_Monitor = std::thread(&ShardedParser::monitor, this);
+}
+
+void ShardedParser::moveBusiestSource(ShardedParser& parser, const std::vector<ShardLoad>& loads)
+{
+    const auto byBusy = [](const ShardLoad& a, const ShardLoad& b) { return a.busy < b.busy; };
+    const auto busiest = std::max_element(loads.begin(), loads.end(), byBusy);
+    const auto idlest = std::min_element(loads.begin(), loads.end(), byBusy);
+
+    if (busiest == loads.end() || busiest == idlest || busiest->sources.size() < 2)
+        return;
+
+    parser.assign(busiest->sources.front().first, idlest->shard);
+}
+
+void ShardedParser::monitor()
+{
+    auto last = Clock::now();
+
+    std::unique_lock<std::mutex> lock(m_MonitorMutex);
+    while (!m_Stopping)
+    {
+        m_MonitorWakeup.wait_for(lock, m_Interval);
+        if (m_Stopping)
+            break;
+
+        const auto now = Clock::now();
+        const double interval = std::chrono::duration<double>(now - last).count();
+        last = now;
+
+        std::vector<ShardLoad> loads;
+        bool changed = false;
+        for (size_t i = 0; i < m_Shards.size(); ++i)
+        {
+            auto& shard = *m_Shards[i];
+
+            ShardLoad load{};
+            load.shard = i;
+            load.cpu = shard.cpu;
+            {
+                std::lock_guard<std::mutex> shardLock(shard.mutex);
+                load.lines = shard.lines;
+                load.dropped = shard.dropped;
+                load.busy = std::min(1.0, std::chrono::duration<double>(shard.busy).count() / interval);
+                load.sources.assign(shard.sourceLines.begin(), shard.sourceLines.end());
+
+                shard.lines = 0;
+                shard.dropped = 0;
+                shard.busy = Clock::duration::zero();
+                shard.sourceLines.clear();
+            }
+
+            const uint64_t filtered = shard.filtered.load(std::memory_order_relaxed);
+            load.filtered = filtered - shard.filteredReported;
+            shard.filteredReported = filtered;
+
+            std::sort(load.sources.begin(), load.sources.end(), [](const auto& a, const auto& b) { return a.second > b.second; });
+
+            // A full queue is a sharp change as well, the busy time of a shard dropping lines can't grow
+            changed = changed || std::fabs(load.busy - m_PreviousBusy[i]) >= m_Change || load.dropped > 0;
+            m_PreviousBusy[i] = load.busy;
+            loads.push_back(std::move(load));
+        }
+
+        if (changed && m_Rebalancer)
+        {
+            const auto rebalancer = m_Rebalancer;
+            lock.unlock();
+            rebalancer(*this, loads);
+            lock.lock();
+        }
+    }
+}
@@ -0,0 +1,144 @@
+﻿#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "LineOrigin.h"
+#include "Nmea.h"
+#include "SentenceFilter.h"
+
+/// <summary>
+///        Parses the lines of many sources on shard threads, each source on one shard.
+/// </summary>
+/// Each shard has its own thread, pinned to a CPU, its own parser and its own bounded queue of lines, so a noisy
+/// source fills only the queue of its own shard. When a queue is full the line is dropped instead of blocking
+/// the caller, which may be reading the other sources.
+/// A monitor measures the load of each shard, and calls a rebalancing hook when the load of a shard changes sharply.
+/// The hook may move sources between shards.
+class ShardedParser
+{
+public:
+    /// <summary>
+    ///        Called on the shard thread with each parsed line. The line is valid until the handler returns.
+    /// </summary>
+    typedef std::function<void(size_t shard, std::string_view line, const Nmea& nmea)> LineHandler;
+
+    /// <summary>
+    ///        The load of a shard during the last monitoring interval.
+    /// </summary>
+    struct ShardLoad
+    {
+        size_t   shard;
+        int      cpu;       ///< The CPU the shard thread is pinned to, -1 if it is not pinned
+        uint64_t lines;     ///< Lines parsed
+        uint64_t dropped;   ///< Lines dropped because the queue was full
+        uint64_t filtered;  ///< Lines not queued because the filter did not pass them
+        double   busy;      ///< The fraction of the interval spent parsing, 0 .. 1
+        std::vector<std::pair<SourceId, uint64_t>> sources; ///< Lines parsed per source, the busiest first
+    };
+
+    /// <summary>
+    ///        Called on the monitor thread when the load of a shard changes sharply.
+    /// </summary>
+    typedef std::function<void(ShardedParser& parser, const std::vector<ShardLoad>& loads)> Rebalancer;
+
+    /// <summary>
+    ///        Starts the shard threads.
+    /// </summary>
+    /// \param handler [in] Called with each parsed line.
+    /// \param shards [in] The number of shards, 0 for one per core.
+    /// \param cpus [in] The CPU of each shard, empty for shard i on CPU i modulo the number of cores.
+    /// \param queueSize [in] The number of lines each shard can hold.
+    /// \param interner [in] The table the tag block sources are interned in.
+    ShardedParser(LineHandler handler, size_t shards = 0, std::vector<int> cpus = {}, size_t queueSize = 4096,
+        SourceInterner& interner = SourceInterner::global());
+
+    /// <summary>
+    ///        Parses the lines queued, and stops the threads.
+    /// </summary>
+    ~ShardedParser();
+
+    ShardedParser(const ShardedParser&) = delete;
+    ShardedParser& operator=(const ShardedParser&) = delete;
+
+    /// <summary>
+    ///        Queues a line on the shard of its source.
+    /// </summary>
+    /// May be called from any number of threads.
+    /// Lines the filter does not pass are counted and not queued.
+    /// \return false if the queue of the shard is full and the line has been dropped
+    bool submit(std::string_view line, const LineOrigin& origin);
+
+    /// <summary>
+    ///        Queues only the lines a filter passes from now on, e.g. Publisher::filter().
+    /// </summary>
+    /// \param filter [in] The filter, nullptr to queue every line.
+    /// \pre The filter outlives the parser, or the next call to setFilter
+    void setFilter(const SentenceFilter* filter) { m_Filter.store(filter, std::memory_order_release); }
+
+    /// The number of lines the filter did not pass
+    uint64_t filtered() const;
+
+    /// <summary>
+    ///        Moves a source to a shard. The lines already queued are parsed by the previous shard.
+    /// </summary>
+    void assign(SourceId source, size_t shard);
+
+    /// The shard of a source
+    size_t shardOf(SourceId source) const;
+
+    /// The number of shards
+    size_t shards() const { return m_Shards.size(); }
+
+    /// <summary>
+    ///        Waits until all lines queued have been parsed.
+    /// </summary>
+    void flush();
+
+    /// <summary>
+    ///        Installs the rebalancing hook.
+    /// </summary>
+    /// \param rebalancer [in] The hook, e.g. ShardedParser::moveBusiestSource.
+    /// \param interval [in] The monitoring interval.
+    /// \param change [in] The change of the busy fraction of a shard from one interval to the next that calls the hook,
+    ///        e.g. 0.25.
+    void setRebalancer(Rebalancer rebalancer, std::chrono::milliseconds interval = std::chrono::milliseconds(1000),
+        double change = 0.25);
+
+    /// <summary>
+    ///        A rebalancing hook moving the busiest source of the busiest shard to the least busy shard,
+    ///        if the busiest shard has other sources.
+    /// </summary>
+    static void moveBusiestSource(ShardedParser& parser, const std::vector<ShardLoad>& loads);
+
+private:
+    struct Shard;
+
+    void monitor();
+
+    LineHandler                         m_Handler;
+    std::vector<std::unique_ptr<Shard>> m_Shards;
+    std::unique_ptr<std::atomic<uint8_t>[]> m_Assignment;   // The shard of each SourceId
+    std::atomic<const SentenceFilter*>  m_Filter;
+
+    // The monitor
+    Rebalancer                          m_Rebalancer;
+    std::chrono::milliseconds           m_Interval;
+    double                              m_Change;
+    std::vector<double>                 m_PreviousBusy;
+    bool                                m_Stopping;
+    std::mutex                          m_MonitorMutex;
+    std::condition_variable             m_MonitorWakeup;
+    std::thread                         m_Monitor;
+};
@@ -0,0 +1,126 @@
+﻿#include "SourceInterner.h"
+
+#include <cassert>
+#include <cstring>
+#include <thread>
+
+SourceInterner::SourceInterner(size_t capacity) :
+    m_Slots(),
+    m_Mask(0)
+{
+    assert(capacity <= 32768);
+
+    size_t size = 1;
+    while (size < capacity)
+        size <<= 1;
+
+    m_Slots = std::make_unique<Slot[]>(size);
+    m_Mask = size - 1;
+}
+
+SourceInterner::~SourceInterner()
+{
+}
+
+SourceId SourceInterner::intern(std::string_view name) noexcept
+{
+    if (name.empty() || name.size() > maxLength)
+        return noSource;
+
+    const uint32_t h = hash(name);
+
+    for (size_t i = 0; i <= m_Mask; ++i)
+    {
+        const size_t index = (h + i) & m_Mask;
+        auto& slot = m_Slots[index];
+
+        uint32_t state = slot.state.load(std::memory_order_acquire);
+        if (state == empty)
+        {
+            // Claim the slot, or see what another thread has claimed it for
+            if (slot.state.compare_exchange_strong(state, writing, std::memory_order_acq_rel))
+            {
+                slot.hash = h;
+                slot.length = static_cast<uint32_t>(name.size());
+                std::memcpy(slot.name, name.data(), name.size());
+                slot.name[name.size()] = '\0';
+                slot.state.store(ready, std::memory_order_release);
+
+                return static_cast<SourceId>(index + 1);
+            }
+        }
+
+        // Another thread is writing the slot, which is rare and short
+        while (state == writing)
+        {
+            std::this_thread::yield();
+            state = slot.state.load(std::memory_order_acquire);
+        }
+
+        if (slot.hash == h && std::string_view(slot.name, slot.length) == name)
+            return static_cast<SourceId>(index + 1);
+    }
+
+    // The table is full
+    return noSource;
+}
+
+SourceId SourceInterner::find(std::string_view name) const noexcept
+{
+    if (name.empty() || name.size() > maxLength)
+        return noSource;
+
+    const uint32_t h = hash(name);
+
+    for (size_t i = 0; i <= m_Mask; ++i)
+    {
+        const size_t index = (h + i) & m_Mask;
+        const auto& slot = m_Slots[index];
+
+        uint32_t state = slot.state.load(std::memory_order_acquire);
+        while (state == writing)
+        {
+            std::this_thread::yield();
+            state = slot.state.load(std::memory_order_acquire);
+        }
+
+        if (state == empty)
+            return noSource;
+
+        if (slot.hash == h && std::string_view(slot.name, slot.length) == name)
+            return static_cast<SourceId>(index + 1);
+    }
+
+    return noSource;
+}
+
+std::string_view SourceInterner::name(SourceId id) const noexcept
+{
+    if (id == noSource || id > m_Mask + 1)
+        return {};
+
+    const auto& slot = m_Slots[id - 1];
+    if (slot.state.load(std::memory_order_acquire) != ready)
+        return {};
+
+    return std::string_view(slot.name, slot.length);
+}
+
+SourceInterner& SourceInterner::global()
+{
+    static SourceInterner interner;
+    return interner;
+}
+
+uint32_t SourceInterner::hash(std::string_view name) noexcept
+{
+    // FNV-1a
+    uint32_t h = 2166136261u;
+    for (auto ch : name)
+    {
+        h ^= static_cast<uint8_t>(ch);
+        h *= 16777619u;
+    }
+
+    return h;
+}
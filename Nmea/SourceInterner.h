@@ -0,0 +1,76 @@
+﻿#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+
+/// <summary>
+///        A small integer identifying a tag block source or destination (s: and d:).
+/// </summary>
+typedef uint16_t SourceId;
+
+/// The SourceId of a line without a source
+const SourceId noSource = 0;
+
+/// <summary>
+///        A lock-free table mapping identification strings to small integers.
+/// </summary>
+/// Any number of threads may intern and look up names concurrently. An interned name is never removed,
+/// so a SourceId stays valid and the view returned by name() stays valid for the lifetime of the table.
+class SourceInterner
+{
+public:
+    /// The longest identification, ref. NmeaFunctions::checkIdentification
+    static const size_t maxLength = 15;
+
+    /// <summary>
+    ///        Creates an empty table.
+    /// </summary>
+    /// \param capacity [in] The maximum number of names, rounded up to a power of two.
+    /// \pre \code{.cpp} capacity <= 32768 \endcode
+    explicit SourceInterner(size_t capacity = 4096);
+    ~SourceInterner();
+
+    SourceInterner(const SourceInterner&) = delete;
+    SourceInterner& operator=(const SourceInterner&) = delete;
+
+    /// <summary>
+    ///        Returns the id of a name, adding the name if it is new.
+    /// </summary>
+    /// \return The id, or noSource if the name is empty, too long or the table is full
+    SourceId intern(std::string_view name) noexcept;
+
+    /// <summary>
+    ///        Returns the id of a name without adding it.
+    /// </summary>
+    /// \return The id, or noSource if the name has not been interned
+    SourceId find(std::string_view name) const noexcept;
+
+    /// <summary>
+    ///        Returns the name of an id.
+    /// </summary>
+    /// \return The name, or an empty string for noSource and unknown ids
+    std::string_view name(SourceId id) const noexcept;
+
+    /// <summary>
+    ///        The table shared by all parsers that are not given one.
+    /// </summary>
+    static SourceInterner& global();
+
+private:
+    enum State : uint32_t { empty, writing, ready };
+
+    struct Slot
+    {
+        std::atomic<uint32_t> state;
+        uint32_t              hash;
+        uint32_t              length;
+        char                  name[maxLength + 1];
+    };
+
+    static uint32_t hash(std::string_view name) noexcept;
+
+    std::unique_ptr<Slot[]> m_Slots;
+    size_t                  m_Mask;
+};
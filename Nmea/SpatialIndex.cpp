@@ -0,0 +1,250 @@
+﻿#include "SpatialIndex.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace
+{
+    const double pi = 3.14159265358979323846;
+    const double earthRadius = 3440.065; // Nautical miles
+    const double degreesToRadians = pi / 180.0;
+}
+
+SpatialIndex::SpatialIndex(double cellSize) :
+    m_CellSize(cellSize),
+    m_Rows(static_cast<uint32_t>(std::ceil(180.0 / cellSize))),
+    m_Columns(static_cast<uint32_t>(std::ceil(360.0 / cellSize))),
+    m_Targets(),
+    m_FreeSlots(),
+    m_SlotByMmsi(),
+    m_CellHeads()
+{
+    // The cell key row * m_Columns + column must fit in 32 bits
+    assert(0.01 <= cellSize && cellSize <= 90.0);
+}
+
+SpatialIndex::~SpatialIndex()
+{
+}
+
+bool SpatialIndex::update(uint32_t mmsi, double latitude, double longitude)
+{
+    // NaN would make an undefined cell
+    if (!std::isfinite(latitude) || !std::isfinite(longitude))
+        return false;
+
+    const uint32_t cell = row(latitude) * m_Columns + column(longitude);
+
+    const auto found = m_SlotByMmsi.find(mmsi);
+    if (found != m_SlotByMmsi.end())
+    {
+        auto& target = m_Targets[found->second];
+        target.latitude = latitude;
+        target.longitude = longitude;
+
+        // Most updates stay within the same cell
+        if (target.cell != cell)
+        {
+            unlink(found->second);
+            link(found->second, cell);
+        }
+
+        return true;
+    }
+
+    uint32_t slot;
+    if (m_FreeSlots.empty())
+    {
+        slot = static_cast<uint32_t>(m_Targets.size());
+        m_Targets.emplace_back();
+    }
+    else
+    {
+        slot = m_FreeSlots.back();
+        m_FreeSlots.pop_back();
+    }
+
+    auto& target = m_Targets[slot];
+    target.mmsi = mmsi;
+    target.latitude = latitude;
+    target.longitude = longitude;
+
+    link(slot, cell);
+    m_SlotByMmsi.emplace(mmsi, slot);
+    return true;
+}
+
+bool SpatialIndex::remove(uint32_t mmsi)
+{
+    const auto found = m_SlotByMmsi.find(mmsi);
+    if (found == m_SlotByMmsi.end())
+        return false;
+
+    unlink(found->second);
+    m_FreeSlots.push_back(found->second);
+    m_SlotByMmsi.erase(found);
+
+    return true;
+}
+
+void SpatialIndex::queryBox(double south, double west, double north, double east, std::vector<uint32_t>& result) const
+{
+    result.clear();
+    if (!std::isfinite(south) || !std::isfinite(west) || !std::isfinite(north) || !std::isfinite(east))
+        return;
+
+    const uint32_t firstRow = row(south);
+    const uint32_t lastRow = row(north);
+
+    if (west <= east)
+    {
+        auto inside = [=](const Target& t) {
+            return south <= t.latitude && t.latitude <= north && west <= t.longitude && t.longitude <= east;
+        };
+
+        visitCells(firstRow, lastRow, column(west), column(east), inside, result);
+    }
+    else
+    {
+        // The box crosses the antimeridian
+        auto inside = [=](const Target& t) {
+            return south <= t.latitude && t.latitude <= north && (west <= t.longitude || t.longitude <= east);
+        };
+
+        visitCells(firstRow, lastRow, column(west), m_Columns - 1, inside, result);
+        visitCells(firstRow, lastRow, 0, column(east), inside, result);
+    }
+}
+
+void SpatialIndex::queryRadius(double latitude, double longitude, double radius, std::vector<uint32_t>& result) const
+{
+    result.clear();
+    if (!std::isfinite(latitude) || !std::isfinite(longitude) || std::isnan(radius))
+        return;
+
+    auto inside = [=](const Target& t) {
+        return distance(latitude, longitude, t.latitude, t.longitude) <= radius;
+    };
+
+    // One minute of latitude is one nautical mile
+    const double deltaLatitude = radius / 60.0;
+    const double south = std::max(-90.0, latitude - deltaLatitude);
+    const double north = std::min(90.0, latitude + deltaLatitude);
+    const uint32_t firstRow = row(south);
+    const uint32_t lastRow = row(north);
+
+    // The widest part of the circle in longitude is at the latitude closest to a pole
+    const double maxLatitude = std::max(std::fabs(south), std::fabs(north));
+    const double cosine = std::cos(maxLatitude * degreesToRadians);
+    const double deltaLongitude = cosine > 0.0 ? deltaLatitude / cosine : 360.0;
+
+    if (maxLatitude >= 90.0 || deltaLongitude >= 180.0)
+    {
+        visitCells(firstRow, lastRow, 0, m_Columns - 1, inside, result);
+        return;
+    }
+
+    double west = longitude - deltaLongitude;
+    double east = longitude + deltaLongitude;
+    if (west < -180.0)
+        west += 360.0;
+    if (east > 180.0)
+        east -= 360.0;
+
+    if (west <= east)
+    {
+        visitCells(firstRow, lastRow, column(west), column(east), inside, result);
+    }
+    else
+    {
+        visitCells(firstRow, lastRow, column(west), m_Columns - 1, inside, result);
+        visitCells(firstRow, lastRow, 0, column(east), inside, result);
+    }
+}
+
+double SpatialIndex::distance(double latitude1, double longitude1, double latitude2, double longitude2) noexcept
+{
+    // Haversine formula
+    const double sinHalfDeltaLatitude = std::sin((latitude2 - latitude1) * degreesToRadians / 2.0);
+    const double sinHalfDeltaLongitude = std::sin((longitude2 - longitude1) * degreesToRadians / 2.0);
+    const double a = sinHalfDeltaLatitude * sinHalfDeltaLatitude +
+        std::cos(latitude1 * degreesToRadians) * std::cos(latitude2 * degreesToRadians) * sinHalfDeltaLongitude * sinHalfDeltaLongitude;
+
+    return 2.0 * earthRadius * std::asin(std::min(1.0, std::sqrt(a)));
+}
+
+uint32_t SpatialIndex::row(double latitude) const noexcept
+{
+    const double r = std::floor((latitude + 90.0) / m_CellSize);
+    return static_cast<uint32_t>(std::clamp(r, 0.0, static_cast<double>(m_Rows - 1)));
+}
+
+uint32_t SpatialIndex::column(double longitude) const noexcept
+{
+    const double c = std::floor((longitude + 180.0) / m_CellSize);
+    return static_cast<uint32_t>(std::clamp(c, 0.0, static_cast<double>(m_Columns - 1)));
+}
+
+void SpatialIndex::link(uint32_t slot, uint32_t cell)
+{
+    auto& target = m_Targets[slot];
+    target.cell = cell;
+    target.previous = npos;
+
+    const auto [head, inserted] = m_CellHeads.try_emplace(cell, slot);
+    if (inserted)
+    {
+        target.next = npos;
+    }
+    else
+    {
+        target.next = head->second;
+        m_Targets[head->second].previous = slot;
+        head->second = slot;
+    }
+}
+
+void SpatialIndex::unlink(uint32_t slot)
+{
+    const auto& target = m_Targets[slot];
+
+    if (target.next != npos)
+        m_Targets[target.next].previous = target.previous;
+
+    if (target.previous != npos)
+    {
+        m_Targets[target.previous].next = target.next;
+    }
+    else if (target.next != npos)
+    {
+        m_CellHeads[target.cell] = target.next;
+    }
+    else
+    {
+        // The cell is empty
+        m_CellHeads.erase(target.cell);
+    }
+}
+
+template<typename Predicate>
+void SpatialIndex::visitCells(uint32_t firstRow, uint32_t lastRow, uint32_t firstColumn, uint32_t lastColumn,
+                              Predicate predicate, std::vector<uint32_t>& result) const
+{
+    for (uint32_t r = firstRow; r <= lastRow; ++r)
+    {
+        for (uint32_t c = firstColumn; c <= lastColumn; ++c)
+        {
+            const auto head = m_CellHeads.find(r * m_Columns + c);
+            if (head == m_CellHeads.end())
+                continue;
+
+            for (uint32_t slot = head->second; slot != npos; slot = m_Targets[slot].next)
+            {
+                const auto& target = m_Targets[slot];
+                if (predicate(target))
+                    result.push_back(target.mmsi);
+            }
+        }
+    }
+}
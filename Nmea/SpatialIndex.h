@@ -0,0 +1,97 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+/// <summary>
+///        An incrementally maintained uniform grid over the positions of live AIS targets.
+/// </summary>
+/// Each target is linked into an intrusive doubly linked list of the grid cell containing its position, and only
+/// the occupied cells have a list head, in a hash map. Moving a target within its cell costs no lookup of the head;
+/// moving it to another cell is an average O(1) hash lookup, plus an allocation when the new cell was empty and
+/// a deallocation when the old cell becomes empty. A range query only visits the cells it overlaps.
+class SpatialIndex
+{
+public:
+    /// <summary>
+    ///        Creates an empty index.
+    /// </summary>
+    /// \param cellSize [in] The side of a grid cell in degrees.
+    /// \pre \code{.cpp} 0.01 <= cellSize && cellSize <= 90.0 \endcode
+    explicit SpatialIndex(double cellSize = 0.1);
+    ~SpatialIndex();
+
+    /// <summary>
+    ///        Inserts a target or moves it to a new position.
+    /// </summary>
+    /// \param mmsi [in] The identity of the target.
+    /// \param latitude [in] Degrees, in the range -90 .. 90.
+    /// \param longitude [in] Degrees, in the range -180 .. 180.
+    /// \return false if a coordinate is not a finite number, and the target has been left as it was
+    bool update(uint32_t mmsi, double latitude, double longitude);
+
+    /// <summary>
+    ///        Removes a target.
+    /// </summary>
+    /// \return true if the target was in the index, otherwise false
+    bool remove(uint32_t mmsi);
+
+    /// <summary>
+    ///        The number of targets in the index.
+    /// </summary>
+    std::size_t size() const { return m_SlotByMmsi.size(); }
+
+    /// <summary>
+    ///        Finds the targets inside a bounding box.
+    /// </summary>
+    /// The box crosses the antimeridian if \c west > \c east. A box with a coordinate that is not a finite number is empty.
+    /// \param result [out] The MMSI of each target inside the box, in no particular order.
+    void queryBox(double south, double west, double north, double east, std::vector<uint32_t>& result) const;
+
+    /// <summary>
+    ///        Finds the targets within a distance of a point.
+    /// </summary>
+    /// A point that is not finite, or a distance that is NaN, has no targets within.
+    /// \param radius [in] The distance in nautical miles.
+    /// \param result [out] The MMSI of each target within the distance, in no particular order.
+    void queryRadius(double latitude, double longitude, double radius, std::vector<uint32_t>& result) const;
+
+    /// <summary>
+    ///        The great circle distance in nautical miles between two positions.
+    /// </summary>
+    static double distance(double latitude1, double longitude1, double latitude2, double longitude2) noexcept;
+
+private:
+    static const uint32_t npos = UINT32_MAX;
+
+    struct Target
+    {
+        uint32_t mmsi;
+        double   latitude;
+        double   longitude;
+        uint32_t cell;
+        uint32_t previous;
+        uint32_t next;
+    };
+
+    uint32_t row(double latitude) const noexcept;
+    uint32_t column(double longitude) const noexcept;
+
+    void link(uint32_t slot, uint32_t cell);
+    void unlink(uint32_t slot);
+
+    template<typename Predicate>
+    void visitCells(uint32_t firstRow, uint32_t lastRow, uint32_t firstColumn, uint32_t lastColumn,
+                    Predicate predicate, std::vector<uint32_t>& result) const;
+
+    double   m_CellSize;
+    uint32_t m_Rows;
+    uint32_t m_Columns;
+
+    std::vector<Target>                    m_Targets;
+    std::vector<uint32_t>                  m_FreeSlots;
+    std::unordered_map<uint32_t, uint32_t> m_SlotByMmsi;
+    std::unordered_map<uint32_t, uint32_t> m_CellHeads;
+};
@@ -0,0 +1,423 @@
+﻿#include "StageProfiler.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <limits>
+
+#if NMEA_PROFILING
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#endif
+
+namespace
+{
+    const size_t stageCount = static_cast<size_t>(Stage::count);
+    const unsigned subBucketBits = 3;
+    const unsigned maxExponent = 35;
+
+    static_assert(LatencyHistogram::subBuckets == 1u << subBucketBits);
+    static_assert(LatencyHistogram::buckets == (maxExponent - subBucketBits + 2) * LatencyHistogram::subBuckets);
+
+#if NMEA_PROFILING
+    void merge(StageProfiler::StageHistograms& into, const StageProfiler::StageHistograms& from)
+    {
+        for (size_t stage = 0; stage < stageCount; ++stage)
+            into[stage].merge(from[stage]);
+    }
+
+    // Histograms written by one thread and read by any, without read-modify-write instructions
+    struct AtomicHistogram
+    {
+        std::atomic<uint64_t> counts[LatencyHistogram::buckets] = {};
+
+        void record(int64_t ns) noexcept
+        {
+            auto& count = counts[LatencyHistogram::bucketOf(ns < 0 ? 0 : static_cast<uint64_t>(ns))];
+            count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+
+        void mergeInto(LatencyHistogram& histogram) const noexcept
+        {
+            for (size_t bucket = 0; bucket < LatencyHistogram::buckets; ++bucket)
+            {
+                const uint64_t count = counts[bucket].load(std::memory_order_relaxed);
+                if (count != 0)
+                    histogram.add(bucket, count);
+            }
+        }
+    };
+
+    struct StageSet
+    {
+        AtomicHistogram stages[stageCount];
+
+        void mergeInto(StageProfiler::StageHistograms& histograms) const noexcept
+        {
+            for (size_t stage = 0; stage < stageCount; ++stage)
+                stages[stage].mergeInto(histograms[stage]);
+        }
+    };
+
+    // Up to 7 characters and their number plus one, so 0 is a free slot and "" is not
+    uint64_t formatterKey(std::string_view formatter) noexcept
+    {
+        const size_t length = formatter.size() < 7 ? formatter.size() : 7;
+        uint64_t key = length + 1;
+        for (size_t i = 0; i < length; ++i)
+            key |= static_cast<uint64_t>(static_cast<uint8_t>(formatter[i])) << (8 * (i + 1));
+        return key;
+    }
+
+    // Three letters, or P and the up to 6 letters and digits of a proprietary sentence
+    bool isFormatter(std::string_view formatter) noexcept
+    {
+        const bool proprietary = formatter.size() > 1 && formatter.size() <= 7 && formatter[0] == 'P';
+        if (formatter.size() != 3 && !proprietary)
+            return false;
+
+        for (const char c : formatter)
+            if (!(c >= 'A' && c <= 'Z') && !(proprietary && c >= '0' && c <= '9'))
+                return false;
+        return true;
+    }
+
+    std::string formatterName(uint64_t key)
+    {
+        std::string name;
+        for (size_t i = 0; i + 1 < (key & 0xFF); ++i)
+            name += static_cast<char>(key >> (8 * (i + 1)));
+        return name;
+    }
+
+    const size_t formatterSlots = 64;
+    const size_t pageSize = 256;
+    const size_t pages = (size_t(std::numeric_limits<SourceId>::max()) + 1) / pageSize;
+
+    // The histograms of one thread. Slots are filled by the thread only: the histograms are published
+    // before the key or page pointer, so a reader seeing either sees initialized histograms.
+    struct ThreadHistograms
+    {
+        struct FormatterSlot
+        {
+            std::atomic<uint64_t>  key{ 0 };
+            std::atomic<StageSet*> histograms{ nullptr };
+        };
+
+        struct SourcePage
+        {
+            std::atomic<StageSet*> sources[pageSize] = {};
+        };
+
+        ThreadHistograms() = default;
+
+        ~ThreadHistograms()
+        {
+            for (auto& slot : formatters)
+                delete slot.histograms.load(std::memory_order_relaxed);
+
+            for (auto& page : sourcePages)
+            {
+                const SourcePage* sources = page.load(std::memory_order_relaxed);
+                if (sources == nullptr)
+                    continue;
+
+                for (auto& source : sources->sources)
+                    delete source.load(std::memory_order_relaxed);
+                delete sources;
+            }
+        }
+
+        ThreadHistograms(const ThreadHistograms&) = delete;
+        ThreadHistograms& operator=(const ThreadHistograms&) = delete;
+
+        // The histograms of a formatter, nullptr if the table is full
+        StageSet* forFormatter(std::string_view formatter)
+        {
+            const uint64_t key = formatterKey(formatter);
+            for (size_t i = 0, slot = (key * 0x9E3779B97F4A7C15ull) >> 58; i < formatterSlots; ++i, slot = (slot + 1) % formatterSlots)
+            {
+                auto& entry = formatters[slot];
+                const uint64_t found = entry.key.load(std::memory_order_relaxed);
+                if (found == key)
+                    return entry.histograms.load(std::memory_order_relaxed);
+
+                if (found == 0)
+                {
+                    auto histograms = new StageSet;
+                    entry.histograms.store(histograms, std::memory_order_release);
+                    entry.key.store(key, std::memory_order_release);
+                    return histograms;
+                }
+            }
+
+            return nullptr;
+        }
+
+        StageSet* forSource(SourceId source)
+        {
+            auto& page = sourcePages[source / pageSize];
+            SourcePage* sources = page.load(std::memory_order_relaxed);
+            if (sources == nullptr)
+            {
+                sources = new SourcePage;
+                page.store(sources, std::memory_order_release);
+            }
+
+            auto& slot = sources->sources[source % pageSize];
+            StageSet* histograms = slot.load(std::memory_order_relaxed);
+            if (histograms == nullptr)
+            {
+                histograms = new StageSet;
+                slot.store(histograms, std::memory_order_release);
+            }
+
+            return histograms;
+        }
+
+        void mergeInto(StageProfiler::Snapshot& snapshot) const
+        {
+            total.mergeInto(snapshot.stages);
+
+            for (const auto& slot : formatters)
+            {
+                const uint64_t key = slot.key.load(std::memory_order_acquire);
+                if (key != 0)
+                    slot.histograms.load(std::memory_order_acquire)->mergeInto(snapshot.formatters[formatterName(key)]);
+            }
+
+            for (size_t page = 0; page < pages; ++page)
+            {
+                const SourcePage* sources = sourcePages[page].load(std::memory_order_acquire);
+                if (sources == nullptr)
+                    continue;
+
+                for (size_t i = 0; i < pageSize; ++i)
+                {
+                    const StageSet* histograms = sources->sources[i].load(std::memory_order_acquire);
+                    if (histograms != nullptr)
+                        histograms->mergeInto(snapshot.sources[static_cast<SourceId>(page * pageSize + i)]);
+                }
+            }
+        }
+
+        StageSet                  total;
+        FormatterSlot             formatters[formatterSlots];
+        std::atomic<SourcePage*>  sourcePages[pages] = {};
+
+        // The last line parsed, used by HandlerTimer
+        int64_t                   parseEnd = 0;
+        StageSet*                 parsedFormatter = nullptr;
+    };
+
+    // The histograms of the running threads, and of the threads that have exited
+    struct Registry
+    {
+        std::mutex                     mutex;
+        std::vector<ThreadHistograms*> threads;
+        StageProfiler::Snapshot        exited;
+    };
+
+    Registry& registry()
+    {
+        // Never destroyed, so threads exiting after main can still unregister
+        static Registry* const instance = new Registry;
+        return *instance;
+    }
+
+    struct ThreadRegistration
+    {
+        ThreadRegistration() :
+            histograms(std::make_unique<ThreadHistograms>())
+        {
+            auto& threads = registry();
+            std::lock_guard<std::mutex> lock(threads.mutex);
+            threads.threads.push_back(histograms.get());
+        }
+
+        ~ThreadRegistration()
+        {
+            auto& threads = registry();
+            std::lock_guard<std::mutex> lock(threads.mutex);
+            histograms->mergeInto(threads.exited);
+            std::erase(threads.threads, histograms.get());
+        }
+
+        std::unique_ptr<ThreadHistograms> histograms;
+    };
+
+    ThreadHistograms& threadHistograms()
+    {
+        thread_local ThreadRegistration registration;
+        return *registration.histograms;
+    }
+#endif
+}
+
+size_t LatencyHistogram::bucketOf(uint64_t ns) noexcept
+{
+    if (ns < subBuckets)
+        return static_cast<size_t>(ns);
+
+    const unsigned exponent = static_cast<unsigned>(std::bit_width(ns)) - 1;
+    if (exponent > maxExponent)
+        return buckets - 1;
+
+    return (exponent - subBucketBits + 1) * subBuckets + ((ns >> (exponent - subBucketBits)) & (subBuckets - 1));
+}
+
+uint64_t LatencyHistogram::lowerBound(size_t bucket) noexcept
+{
+    if (bucket < subBuckets)
+        return bucket;
+
+    const unsigned exponent = static_cast<unsigned>(bucket / subBuckets) + subBucketBits - 1;
+    return (subBuckets + bucket % subBuckets) << (exponent - subBucketBits);
+}
+
+uint64_t LatencyHistogram::upperBound(size_t bucket) noexcept
+{
+    return bucket + 1 < buckets ? lowerBound(bucket + 1) - 1 : std::numeric_limits<uint64_t>::max();
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) noexcept
+{
+    for (size_t bucket = 0; bucket < buckets; ++bucket)
+        m_Counts[bucket] += other.m_Counts[bucket];
+    m_Count += other.m_Count;
+}
+
+uint64_t LatencyHistogram::percentile(double fraction) const noexcept
+{
+    if (m_Count == 0)
+        return 0;
+
+    const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(fraction * m_Count)));
+    uint64_t below = 0;
+    for (size_t bucket = 0; bucket < buckets; ++bucket)
+    {
+        below += m_Counts[bucket];
+        if (below >= rank)
+            return bucket + 1 < buckets ? upperBound(bucket) : lowerBound(bucket);
+    }
+
+    return lowerBound(buckets - 1);
+}
+
+double LatencyHistogram::mean() const noexcept
+{
+    if (m_Count == 0)
+        return 0;
+
+    double sum = 0;
+    for (size_t bucket = 0; bucket + 1 < buckets; ++bucket)
+        sum += m_Counts[bucket] * (lowerBound(bucket) + upperBound(bucket)) / 2.0;
+    sum += m_Counts[buckets - 1] * static_cast<double>(lowerBound(buckets - 1));
+
+    return sum / m_Count;
+}
+
+const char* StageProfiler::name(Stage stage) noexcept
+{
+    switch (stage)
+    {
+    case Stage::framing: return "framing";
+    case Stage::mainStructure: return "main structure";
+    case Stage::generalContents: return "general contents";
+    case Stage::specificContents: return "specific contents";
+    case Stage::dispatch: return "dispatch";
+    case Stage::count: break;
+    }
+
+    return "unknown";
+}
+
+std::string_view StageProfiler::formatter(std::string_view header) noexcept
+{
+    if (header.size() < 4)
+        return {};
+
+    // The manufacturer's mnemonic and the sentence type of a proprietary sentence
+    if (header[0] == '$' && header[1] == 'P')
+        return header.substr(1);
+
+    return header.substr(header.size() - 3);
+}
+
+StageProfiler::Snapshot StageProfiler::snapshot()
+{
+    Snapshot snapshot;
+
+#if NMEA_PROFILING
+    auto& threads = registry();
+    std::lock_guard<std::mutex> lock(threads.mutex);
+
+    ::merge(snapshot.stages, threads.exited.stages);
+    for (const auto& [name, histograms] : threads.exited.formatters)
+        ::merge(snapshot.formatters[name], histograms);
+    for (const auto& [source, histograms] : threads.exited.sources)
+        ::merge(snapshot.sources[source], histograms);
+
+    for (const ThreadHistograms* histograms : threads.threads)
+        histograms->mergeInto(snapshot);
+#endif
+
+    return snapshot;
+}
+
+#if NMEA_PROFILING
+
+void StageProfiler::ParseTimer::record(std::string_view header, SourceId source, ErrorCode error) noexcept
+{
+    auto& local = threadHistograms();
+    const std::string_view name = StageProfiler::formatter(header);
+    StageSet* formatter = local.forFormatter(error == ErrorCode::E000 && isFormatter(name) ? name : "error");
+    StageSet* sourceHistograms = source == noSource ? nullptr : local.forSource(source);
+
+    for (size_t stage = 0; stage < stageCount; ++stage)
+    {
+        if ((m_Lapped & (1u << stage)) == 0)
+            continue;
+
+        local.total.stages[stage].record(m_Ns[stage]);
+        if (formatter != nullptr)
+            formatter->stages[stage].record(m_Ns[stage]);
+        if (sourceHistograms != nullptr)
+            sourceHistograms->stages[stage].record(m_Ns[stage]);
+    }
+
+    local.parseEnd = m_Last;
+    local.parsedFormatter = formatter;
+}
+
+void StageProfiler::HandlerTimer::handled(SourceId source) noexcept
+{
+    const int64_t end = now();
+    auto& local = threadHistograms();
+    StageSet* sourceHistograms = source == noSource ? nullptr : local.forSource(source);
+
+    const int64_t framing = m_Framed - m_Start;
+    local.total.stages[static_cast<size_t>(Stage::framing)].record(framing);
+    if (sourceHistograms != nullptr)
+        sourceHistograms->stages[static_cast<size_t>(Stage::framing)].record(framing);
+
+    // The formatter is known only if the handler parsed the line
+    if (local.parseEnd >= m_Framed)
+    {
+        const int64_t dispatch = end - local.parseEnd;
+        local.total.stages[static_cast<size_t>(Stage::dispatch)].record(dispatch);
+        if (sourceHistograms != nullptr)
+            sourceHistograms->stages[static_cast<size_t>(Stage::dispatch)].record(dispatch);
+        if (local.parsedFormatter != nullptr)
+        {
+            local.parsedFormatter->stages[static_cast<size_t>(Stage::framing)].record(framing);
+            local.parsedFormatter->stages[static_cast<size_t>(Stage::dispatch)].record(dispatch);
+        }
+    }
+
+    m_Start = end;
+}
+
+#endif
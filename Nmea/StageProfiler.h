@@ -0,0 +1,187 @@
+﻿#pragma once
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+
+#include "ErrorCodes.h"
+#include "LineOrigin.h"
+
+// Build with NMEA_PROFILING=1 to time the stages of each line. Otherwise the timers are empty classes and
+// their calls compile to nothing.
+#if !defined(NMEA_PROFILING)
+#define NMEA_PROFILING 0
+#endif
+
+#if NMEA_PROFILING
+#include <chrono>
+#endif
+
+/// <summary>
+///        The stages a line goes through from the bytes received to the subscribers.
+/// </summary>
+enum class Stage
+{
+    framing,            ///< Finding the end of the line in the received bytes
+    mainStructure,      ///< Nmea::parseMainStructure
+    generalContents,    ///< Nmea::parseGeneralContents
+    specificContents,   ///< Nmea::parseSpecificContents
+    dispatch,           ///< What the line handler does after parsing, e.g. publishing
+    count
+};
+
+/// <summary>
+///        A log-linear histogram of latencies in nanoseconds.
+/// </summary>
+/// Each power of two is divided into 8 linear buckets, so a latency is known within 12.5 %, from 1 ns to 68 s.
+class LatencyHistogram
+{
+public:
+    static const size_t subBuckets = 8;
+    static const size_t buckets = 272;
+
+    /// The bucket counting a latency, the last bucket counts everything longer
+    static size_t bucketOf(uint64_t ns) noexcept;
+
+    /// The shortest latency counted by a bucket
+    static uint64_t lowerBound(size_t bucket) noexcept;
+
+    /// The longest latency counted by a bucket
+    static uint64_t upperBound(size_t bucket) noexcept;
+
+    void add(size_t bucket, uint64_t count) noexcept { m_Counts[bucket] += count; m_Count += count; }
+
+    /// Adds the counts of another histogram, e.g. of another thread
+    void merge(const LatencyHistogram& other) noexcept;
+
+    uint64_t count() const noexcept { return m_Count; }
+    uint64_t count(size_t bucket) const noexcept { return m_Counts[bucket]; }
+
+    /// <summary>
+    ///        The latency below which a fraction of the latencies are.
+    /// </summary>
+    /// \param fraction [in] 0 .. 1, e.g. 0.99.
+    /// \return The upper bound of the bucket holding the latency, 0 if the histogram is empty
+    uint64_t percentile(double fraction) const noexcept;
+
+    /// The mean latency, taking each latency at the middle of its bucket
+    double mean() const noexcept;
+
+private:
+    std::array<uint64_t, buckets> m_Counts{};
+    uint64_t                      m_Count = 0;
+};
+
+/// <summary>
+///        Latency histograms of the stages of each line, per thread, per sentence formatter and per source.
+/// </summary>
+/// Each thread records into its own histograms without locking or atomic read-modify-write instructions.
+/// snapshot() merges the histograms of all threads while they keep recording, so the counts of a snapshot
+/// are those of some moment during the call. The histograms of a thread that exits are kept.
+/// The histograms of a source are allocated the first time a thread records a line of that source. A thread
+/// keeps up to 64 formatters, the lines of further formatters are counted in the stages and sources only. The lines
+/// in error and those whose header is not that of a sentence are kept under one formatter, "error", so corrupted
+/// headers can't fill the table.
+class StageProfiler
+{
+public:
+    typedef std::array<LatencyHistogram, static_cast<size_t>(Stage::count)> StageHistograms;
+
+    /// <summary>
+    ///        The merged histograms of all threads.
+    /// </summary>
+    struct Snapshot
+    {
+        StageHistograms                         stages;
+        std::map<std::string, StageHistograms>  formatters;  ///< "GGA", "VDM", "PGRME", "error" for lines in error
+        std::map<SourceId, StageHistograms>     sources;
+    };
+
+    /// true if the library was built with NMEA_PROFILING=1
+    static constexpr bool enabled() { return NMEA_PROFILING != 0; }
+
+    /// The name of a stage
+    static const char* name(Stage stage) noexcept;
+
+    /// <summary>
+    ///        Merges the histograms of all threads.
+    /// </summary>
+    /// \return Empty histograms if profiling is compiled out
+    static Snapshot snapshot();
+
+    /// The formatter of a header field, e.g. GGA of $GPGGA and PGRME of $PGRME
+    static std::string_view formatter(std::string_view header) noexcept;
+
+#if NMEA_PROFILING
+    /// <summary>
+    ///        Times the parsing stages of one line.
+    /// </summary>
+    class ParseTimer
+    {
+    public:
+        ParseTimer() noexcept : m_Last(now()), m_Lapped(0), m_Ns{} {}
+
+        /// Ends a stage, which started when the previous one ended
+        void lap(Stage stage) noexcept
+        {
+            const int64_t time = now();
+            m_Ns[static_cast<size_t>(stage)] = time - m_Last;
+            m_Lapped |= 1u << static_cast<unsigned>(stage);
+            m_Last = time;
+        }
+
+        /// <summary>
+        ///        Records the stages ended.
+        /// </summary>
+        /// \param header [in] The header field of the sentence, empty if not found.
+        /// \param error [in] The result of the parse, the line is recorded under "error" if not E000.
+        void record(std::string_view header, SourceId source, ErrorCode error) noexcept;
+
+    private:
+        int64_t  m_Last;
+        unsigned m_Lapped;
+        int64_t  m_Ns[static_cast<size_t>(Stage::count)];
+    };
+
+    /// <summary>
+    ///        Times the framing of each line and what the line handler does after parsing it.
+    /// </summary>
+    /// Lives while the lines of one read are handed out: begin() when the bytes are received, framed() when a
+    /// line is found, handled() when the handler returns. The formatter is that of the line parsed by the handler.
+    class HandlerTimer
+    {
+    public:
+        HandlerTimer() noexcept : m_Start(0), m_Framed(0) {}
+
+        void begin() noexcept { m_Start = now(); }
+        void framed() noexcept { m_Framed = now(); }
+        void handled(SourceId source) noexcept;
+
+    private:
+        int64_t m_Start;
+        int64_t m_Framed;
+    };
+
+    static int64_t now() noexcept
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+#else
+    class ParseTimer
+    {
+    public:
+        void lap(Stage) noexcept {}
+        void record(std::string_view, SourceId, ErrorCode) noexcept {}
+    };
+
+    class HandlerTimer
+    {
+    public:
+        void begin() noexcept {}
+        void framed() noexcept {}
+        void handled(SourceId) noexcept {}
+    };
+#endif
+};
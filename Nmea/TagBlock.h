@@ -0,0 +1,36 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+#include "SourceInterner.h"
+
+/// <summary>
+///        The decoded parameters of the tag blocks of a line.
+/// </summary>
+/// Ref. NMEA 0183 Version 4.00, 7.
+struct TagBlock
+{
+    enum Parameter : uint8_t {
+        unixTime     = 0x01,  // c:
+        destination  = 0x02,  // d:
+        grouping     = 0x04,  // g:
+        lineCount    = 0x08,  // n:
+        relativeTime = 0x10,  // r:
+        source       = 0x20,  // s:
+        text         = 0x40   // t:
+    };
+
+    uint8_t          present;         ///< The parameters in the line, a combination of Parameter
+    int64_t          time;            ///< c: UNIX time
+    uint32_t         lineNumber;      ///< n:
+    uint32_t         relative;        ///< r:
+    uint16_t         sentenceNumber;  ///< g: first number
+    uint16_t         totalSentences;  ///< g: second number
+    uint32_t         groupId;         ///< g: third number
+    SourceId         sourceId;        ///< s: interned
+    SourceId         destinationId;   ///< d: interned
+    std::string_view textString;      ///< t:, refers to the characters of the parsed line
+
+    bool has(Parameter parameter) const noexcept { return (present & parameter) != 0; }
+};
@@ -0,0 +1,316 @@
+﻿#include "TraceRecorder.h"
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <vector>
+
+namespace
+{
+    // A span, written by one thread and read by any. The sequence is the index of the span in the spans of
+    // the thread plus one, and 0 while the span is written, so a reader can tell a span overwritten while it
+    // was read, and a span of a previous session.
+    struct Event
+    {
+        std::atomic<uint64_t>    sequence{ 0 };
+        std::atomic<const char*> name{ nullptr };
+        std::atomic<int64_t>     begin{ 0 };
+        std::atomic<int64_t>     end{ 0 };
+        std::atomic<uint64_t>    labels{ 0 };  ///< The source, then up to 6 formatter characters
+    };
+
+    // The spans of one thread
+    struct ThreadRing
+    {
+        // Written by the thread with the registry locked, read with the registry locked
+        uint64_t                 session = 0;
+        uint64_t                 sessionStart = 0;  ///< The head when the session started
+        std::unique_ptr<Event[]> events;
+        size_t                   mask = 0;
+        uint32_t                 tid = 0;
+        std::string              name;
+
+        // The ring of the next session allocated by start(), or the ring of a previous session.
+        // Written with the registry locked.
+        std::unique_ptr<Event[]> spare;
+        size_t                   spareCapacity = 0;
+
+        std::atomic<uint64_t>    head{ 0 };  ///< The number of spans written by the thread
+    };
+
+    struct Registry
+    {
+        std::mutex                               mutex;
+        std::vector<std::shared_ptr<ThreadRing>> threads;
+        uint32_t                                 nextTid = 1;
+        size_t                                   capacity = 0;
+    };
+
+    std::atomic<uint64_t> currentSession{ 0 };
+
+    Registry& registry()
+    {
+        // Never destroyed, so threads exiting after main can still record
+        static Registry* const instance = new Registry;
+        return *instance;
+    }
+
+    ThreadRing& threadRing()
+    {
+        // Kept by the registry after the thread exits, until the next session starts
+        thread_local const std::shared_ptr<ThreadRing> ring = [] {
+            auto created = std::make_shared<ThreadRing>();
+            auto& threads = registry();
+            std::lock_guard<std::mutex> lock(threads.mutex);
+            created->tid = threads.nextTid++;
+            created->name = "thread " + std::to_string(created->tid);
+            threads.threads.push_back(created);
+            return created;
+        }();
+        return *ring;
+    }
+
+    bool hasCapacity(const ThreadRing& ring, size_t capacity) noexcept
+    {
+        return ring.events != nullptr && ring.mask + 1 == capacity;
+    }
+
+    // Starts the current session in the ring of the calling thread, false if the ring can't be allocated.
+    // The spans of the previous session are left in the ring, their sequences are below the session start.
+    bool renew(ThreadRing& ring) noexcept
+    {
+        auto& threads = registry();
+        std::lock_guard<std::mutex> lock(threads.mutex);
+        ring.session = currentSession.load(std::memory_order_relaxed);
+        ring.sessionStart = ring.head.load(std::memory_order_relaxed);
+
+        if (!hasCapacity(ring, threads.capacity))
+        {
+            // The spare is allocated here only for a thread start() did not know of
+            if (ring.spareCapacity != threads.capacity)
+            {
+                ring.spare.reset(new (std::nothrow) Event[threads.capacity]);
+                ring.spareCapacity = ring.spare != nullptr ? threads.capacity : 0;
+            }
+
+            const size_t previous = ring.events != nullptr ? ring.mask + 1 : 0;
+            std::swap(ring.events, ring.spare);
+            ring.mask = ring.events != nullptr ? threads.capacity - 1 : 0;
+            ring.spareCapacity = previous;
+        }
+
+        return ring.events != nullptr;
+    }
+
+    uint64_t labels(SourceId source, std::string_view formatter) noexcept
+    {
+        uint64_t packed = source;
+        const size_t length = formatter.size() < 6 ? formatter.size() : 6;
+        for (size_t i = 0; i < length; ++i)
+            packed |= static_cast<uint64_t>(static_cast<uint8_t>(formatter[i])) << (8 * (i + 2));
+        return packed;
+    }
+
+    struct Copy
+    {
+        uint32_t    tid;
+        const char* name;
+        int64_t     begin;
+        int64_t     end;
+        uint64_t    labels;
+    };
+
+    void writeString(std::ostream& out, std::string_view text)
+    {
+        out << '"';
+        for (const char c : text)
+        {
+            if (c == '"' || c == '\\')
+            {
+                out << '\\' << c;
+            }
+            else if (static_cast<unsigned char>(c) < 0x20)
+            {
+                char escaped[8];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned>(c));
+                out << escaped;
+            }
+            else
+            {
+                out << c;
+            }
+        }
+        out << '"';
+    }
+
+    // Microseconds with 3 decimals, as the Trace Event Format wants
+    void writeMicroseconds(std::ostream& out, int64_t ns)
+    {
+        char text[32];
+        std::snprintf(text, sizeof(text), "%lld.%03lld", static_cast<long long>(ns / 1000), static_cast<long long>(ns % 1000));
+        out << text;
+    }
+}
+
+void TraceRecorder::start(size_t eventsPerThread)
+{
+    auto& threads = registry();
+    std::lock_guard<std::mutex> lock(threads.mutex);
+    threads.capacity = std::bit_ceil(std::max<size_t>(eventsPerThread, 2));
+
+    // The spans of the threads that have exited belong to the previous session
+    std::erase_if(threads.threads, [](const std::shared_ptr<ThreadRing>& ring) { return ring.use_count() == 1; });
+
+    // The rings of the threads known are allocated here rather than by their first span. A thread swaps its
+    // spare in when it renews its ring, and only with the registry locked, so the spare can be replaced here.
+    for (const auto& ring : threads.threads)
+    {
+        if (hasCapacity(*ring, threads.capacity))
+        {
+            ring->spare.reset();
+            ring->spareCapacity = 0;
+        }
+        else if (ring->spareCapacity != threads.capacity)
+        {
+            ring->spare.reset(new (std::nothrow) Event[threads.capacity]);
+            ring->spareCapacity = ring->spare != nullptr ? threads.capacity : 0;
+        }
+    }
+
+    currentSession.fetch_add(1, std::memory_order_release);
+    m_Recording.store(true, std::memory_order_release);
+}
+
+void TraceRecorder::stop() noexcept
+{
+    m_Recording.store(false, std::memory_order_release);
+}
+
+int64_t TraceRecorder::now() noexcept
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+void TraceRecorder::record(const char* name, int64_t begin, int64_t end, SourceId source, std::string_view formatter) noexcept
+{
+    if (!recording())
+        return;
+
+    ThreadRing* ring;
+    try
+    {
+        ring = &threadRing();
+    }
+    catch (const std::bad_alloc&)
+    {
+        return;
+    }
+
+    if (ring->session != currentSession.load(std::memory_order_acquire) && !renew(*ring))
+        return;
+    if (ring->events == nullptr)
+        return;
+
+    const uint64_t head = ring->head.load(std::memory_order_relaxed);
+    Event& event = ring->events[head & ring->mask];
+    event.sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    event.name.store(name, std::memory_order_relaxed);
+    event.begin.store(begin, std::memory_order_relaxed);
+    event.end.store(end, std::memory_order_relaxed);
+    event.labels.store(labels(source, formatter), std::memory_order_relaxed);
+    event.sequence.store(head + 1, std::memory_order_release);
+    ring->head.store(head + 1, std::memory_order_release);
+}
+
+void TraceRecorder::setThreadName(std::string_view name)
+{
+    auto& ring = threadRing();
+    std::lock_guard<std::mutex> lock(registry().mutex);
+    ring.name.assign(name.data(), name.size());
+}
+
+size_t TraceRecorder::writeJson(std::ostream& out, const SourceInterner& interner)
+{
+    std::vector<Copy> spans;
+    std::vector<std::pair<uint32_t, std::string>> names;
+    {
+        auto& threads = registry();
+        std::lock_guard<std::mutex> lock(threads.mutex);
+        const uint64_t session = currentSession.load(std::memory_order_acquire);
+
+        for (const auto& ring : threads.threads)
+        {
+            names.emplace_back(ring->tid, ring->name);
+            if (ring->session != session || ring->events == nullptr)
+                continue;
+
+            const uint64_t head = ring->head.load(std::memory_order_acquire);
+            const uint64_t capacity = ring->mask + 1;
+            for (uint64_t index = std::max(ring->sessionStart, head > capacity ? head - capacity : 0); index < head; ++index)
+            {
+                const Event& event = ring->events[index & ring->mask];
+                if (event.sequence.load(std::memory_order_acquire) != index + 1)
+                    continue;
+
+                const Copy span{ ring->tid, event.name.load(std::memory_order_relaxed), event.begin.load(std::memory_order_relaxed),
+                    event.end.load(std::memory_order_relaxed), event.labels.load(std::memory_order_relaxed) };
+
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (event.sequence.load(std::memory_order_relaxed) == index + 1)
+                    spans.push_back(span);
+            }
+        }
+    }
+
+    int64_t origin = 0;
+    if (!spans.empty())
+        origin = std::min_element(spans.begin(), spans.end(), [](const Copy& a, const Copy& b) { return a.begin < b.begin; })->begin;
+
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    bool first = true;
+    for (const auto& [tid, name] : names)
+    {
+        out << (first ? "\n" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << tid << ",\"args\":{\"name\":";
+        writeString(out, name);
+        out << "}}";
+        first = false;
+    }
+
+    for (const auto& span : spans)
+    {
+        out << (first ? "\n" : ",\n") << "{\"name\":";
+        writeString(out, span.name);
+        out << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << span.tid << ",\"ts\":";
+        writeMicroseconds(out, span.begin - origin);
+        out << ",\"dur\":";
+        writeMicroseconds(out, std::max<int64_t>(span.end - span.begin, 0));
+
+        const auto source = static_cast<SourceId>(span.labels & 0xFFFF);
+        std::string formatter;
+        for (uint64_t characters = span.labels >> 16; characters != 0; characters >>= 8)
+            formatter += static_cast<char>(characters & 0xFF);
+
+        out << ",\"args\":{";
+        if (source != noSource)
+        {
+            out << "\"source\":";
+            writeString(out, interner.name(source));
+        }
+        if (!formatter.empty())
+        {
+            out << (source != noSource ? ",\"formatter\":" : "\"formatter\":");
+            writeString(out, formatter);
+        }
+        out << "}}";
+        first = false;
+    }
+    out << "\n]}\n";
+
+    return spans.size();
+}
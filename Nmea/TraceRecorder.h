@@ -0,0 +1,137 @@
+﻿#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <string_view>
+
+#include "SourceInterner.h"
+
+/// <summary>
+///        Records timestamped spans of the ingest path per thread, and writes them as Chrome trace events.
+/// </summary>
+/// Recording is switched on and off at run time. While it is off, a span costs one relaxed load. While it
+/// is on, each thread writes its spans into its own ring of fixed size, without locking or atomic
+/// read-modify-write instructions, and the oldest spans of a thread are overwritten once its ring is full.
+/// start() allocates the rings of the threads that have recorded or been named before. A thread first seen
+/// during a session allocates its ring with its first span. A ring is kept for the next session of the same
+/// size without being cleared.
+/// writeJson() can be called at any time, e.g. while recording, to write the spans in the rings in the Trace
+/// Event Format read by chrome://tracing and Perfetto. Times are those of LineOrigin::receiveTime, so the
+/// time a line waited before a span can be recorded as a span too.
+/// \code{.cpp}
+///     TraceRecorder::start();
+///     ...
+///     TraceRecorder::stop();
+///     std::ofstream file("trace.json");
+///     TraceRecorder::writeJson(file);
+/// \endcode
+class TraceRecorder
+{
+public:
+    /// <summary>
+    ///        Starts a session, dropping the spans of the previous one.
+    /// </summary>
+    /// \param eventsPerThread [in] The number of spans kept per thread, rounded up to a power of two.
+    static void start(size_t eventsPerThread = 65536);
+
+    /// Stops recording, the spans are kept until the next session starts
+    static void stop() noexcept;
+
+    static bool recording() noexcept { return m_Recording.load(std::memory_order_relaxed); }
+
+    /// Nanoseconds since 1970-01-01 UTC, as in LineOrigin::receiveTime
+    static int64_t now() noexcept;
+
+    /// <summary>
+    ///        Records a span of the calling thread, if recording.
+    /// </summary>
+    /// \param name [in] A string literal, e.g. "parse". Only the pointer is kept.
+    /// \param formatter [in] e.g. GGA, the first 6 characters are kept.
+    static void record(const char* name, int64_t begin, int64_t end, SourceId source = noSource,
+        std::string_view formatter = {}) noexcept;
+
+    /// <summary>
+    ///        Names the calling thread in the traces, e.g. "shard 2".
+    /// </summary>
+    /// The name is kept across sessions.
+    static void setThreadName(std::string_view name);
+
+    /// <summary>
+    ///        Writes the spans recorded in the current or last session as a Chrome trace JSON object.
+    /// </summary>
+    /// Spans overwritten while they are read are left out. Times are written relative to the earliest span.
+    /// \param interner [in] Names the sources of the spans.
+    /// \return The number of spans written
+    static size_t writeJson(std::ostream& out, const SourceInterner& interner = SourceInterner::global());
+
+    /// <summary>
+    ///        Records the span of its own lifetime, if recording when it was constructed.
+    /// </summary>
+    class Span
+    {
+    public:
+        explicit Span(const char* name, SourceId source = noSource) noexcept :
+            m_Name(recording() ? name : nullptr),
+            m_Source(source),
+            m_Begin(m_Name != nullptr ? now() : 0)
+        {
+        }
+
+        ~Span()
+        {
+            if (m_Name != nullptr)
+                record(m_Name, m_Begin, now(), m_Source, m_Formatter);
+        }
+
+        Span(const Span&) = delete;
+        Span& operator=(const Span&) = delete;
+
+        /// The formatter of the line, when known only at the end of the span. The view must outlive the span.
+        void setFormatter(std::string_view formatter) noexcept { m_Formatter = formatter; }
+
+    private:
+        const char*      m_Name;
+        SourceId         m_Source;
+        int64_t          m_Begin;
+        std::string_view m_Formatter;
+    };
+
+    /// <summary>
+    ///        Records the framing of each line and its dispatch to the line handler.
+    /// </summary>
+    /// Lives while the lines of one read are handed out, as StageProfiler::HandlerTimer: begin() when the bytes
+    /// are received, framed() when a line is found, handled() when the handler returns. A line is framed from
+    /// the end of the read or of the previous line.
+    class HandlerSpans
+    {
+    public:
+        HandlerSpans() noexcept : m_Last(0), m_Source(noSource) {}
+
+        void begin(SourceId source) noexcept
+        {
+            m_Source = source;
+            m_Last = recording() ? now() : 0;
+        }
+
+        void framed() noexcept { lap("frame"); }
+        void handled() noexcept { lap("dispatch"); }
+
+    private:
+        void lap(const char* name) noexcept
+        {
+            if (m_Last == 0)
+                return;
+
+            const int64_t time = now();
+            record(name, m_Last, time, m_Source);
+            m_Last = time;
+        }
+
+        int64_t  m_Last;
+        SourceId m_Source;
+    };
+
+private:
+    static inline std::atomic<bool> m_Recording{ false };
+};
@@ -0,0 +1,99 @@
+﻿#include "UdpReceiver.h"
+
+#if defined(__linux__)
+
+#include <cerrno>
+#include <ctime>
+#include <system_error>
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+UdpReceiver::UdpReceiver(size_t batchSize, size_t datagramSize) :
+    m_BatchSize(batchSize),
+    m_DatagramSize(datagramSize),
+    m_ControlSize(CMSG_SPACE(sizeof(timespec))),
+    m_Buffers(std::make_unique<char[]>(batchSize * datagramSize)),
+    m_Controls(std::make_unique<char[]>(batchSize * CMSG_SPACE(sizeof(timespec)))),
+    m_Headers(std::make_unique<mmsghdr[]>(batchSize)),
+    m_Vectors(std::make_unique<iovec[]>(batchSize)),
+    m_ReceiveTimes(batchSize, 0),
+    m_SystemCalls(0)
+{
+    // The buffers are registered once, only the lengths are reset between calls
+    for (size_t i = 0; i < m_BatchSize; ++i)
+    {
+        m_Vectors[i].iov_base = m_Buffers.get() + i * m_DatagramSize;
+        m_Vectors[i].iov_len = m_DatagramSize;
+
+        auto& header = m_Headers[i].msg_hdr;
+        header.msg_iov = &m_Vectors[i];
+        header.msg_iovlen = 1;
+        header.msg_control = m_Controls.get() + i * m_ControlSize;
+    }
+}
+
+UdpReceiver::~UdpReceiver()
+{
+}
+
+bool UdpReceiver::enableTimestamps(int fd) noexcept
+{
+    const int on = 1;
+    return ::setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on)) == 0;
+}
+
+size_t UdpReceiver::receive(int fd)
+{
+    for (size_t i = 0; i < m_BatchSize; ++i)
+    {
+        // The kernel overwrites the control length with the length used
+        m_Headers[i].msg_hdr.msg_controllen = m_ControlSize;
+        m_Headers[i].msg_hdr.msg_flags = 0;
+    }
+
+    int count;
+    do
+    {
+        count = ::recvmmsg(fd, m_Headers.get(), static_cast<unsigned>(m_BatchSize), MSG_WAITFORONE, nullptr);
+    } while (count < 0 && errno == EINTR);
+
+    if (count < 0)
+    {
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+            return 0;
+
+        throw std::system_error(errno, std::generic_category(), "recvmmsg");
+    }
+
+    ++m_SystemCalls;
+
+    for (int i = 0; i < count; ++i)
+    {
+        m_ReceiveTimes[i] = 0;
+
+        auto& header = m_Headers[i].msg_hdr;
+        for (auto control = CMSG_FIRSTHDR(&header); control != nullptr; control = CMSG_NXTHDR(&header, control))
+        {
+            if (control->cmsg_level == SOL_SOCKET && control->cmsg_type == SCM_TIMESTAMPNS)
+            {
+                const auto time = reinterpret_cast<const timespec*>(CMSG_DATA(control));
+                m_ReceiveTimes[i] = static_cast<int64_t>(time->tv_sec) * 1000000000 + time->tv_nsec;
+            }
+        }
+    }
+
+    return static_cast<size_t>(count);
+}
+
+std::string_view UdpReceiver::datagram(size_t i) const noexcept
+{
+    return std::string_view(m_Buffers.get() + i * m_DatagramSize, m_Headers[i].msg_len);
+}
+
+bool UdpReceiver::truncated(size_t i) const noexcept
+{
+    return (m_Headers[i].msg_hdr.msg_flags & MSG_TRUNC) != 0;
+}
+
+#endif
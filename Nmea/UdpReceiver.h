@@ -0,0 +1,71 @@
+﻿#pragma once
+
+#if defined(__linux__)
+
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+struct mmsghdr;
+struct iovec;
+
+/// <summary>
+///        Receives a batch of UDP datagrams with one system call (recvmmsg) into a buffer pool allocated once.
+/// </summary>
+/// The kernel receive time (SO_TIMESTAMPNS) of each datagram is captured alongside the datagram.
+/// The datagrams are valid until the next call to receive, so they can be framed and parsed in place.
+/// \note Linux only.
+class UdpReceiver
+{
+public:
+    /// <summary>
+    ///        Creates the buffer pool.
+    /// </summary>
+    /// \param batchSize [in] The maximum number of datagrams received by one call.
+    /// \param datagramSize [in] The size of each buffer, longer datagrams are truncated.
+    explicit UdpReceiver(size_t batchSize = 64, size_t datagramSize = 2048);
+    ~UdpReceiver();
+
+    UdpReceiver(const UdpReceiver&) = delete;
+    UdpReceiver& operator=(const UdpReceiver&) = delete;
+
+    /// <summary>
+    ///        Asks the kernel to time stamp the datagrams received on a socket.
+    /// </summary>
+    /// \return false if the socket does not support time stamps
+    static bool enableTimestamps(int fd) noexcept;
+
+    /// <summary>
+    ///        Receives the datagrams waiting on a socket, up to the batch size.
+    /// </summary>
+    /// A blocking socket waits for the first datagram only, a non-blocking socket does not wait.
+    /// \return The number of datagrams received, 0 if none is waiting or the socket timed out
+    /// \exception std::system_error on other errors
+    size_t receive(int fd);
+
+    /// The datagram i of the last call to receive
+    std::string_view datagram(size_t i) const noexcept;
+
+    /// true if datagram i was longer than the buffer and has been truncated
+    bool truncated(size_t i) const noexcept;
+
+    /// The kernel receive time of datagram i in nanoseconds since 1970-01-01 UTC, or 0 if not time stamped
+    int64_t receiveTime(size_t i) const noexcept { return m_ReceiveTimes[i]; }
+
+    /// The number of calls to receive that returned datagrams
+    uint64_t systemCalls() const noexcept { return m_SystemCalls; }
+
+private:
+    size_t                     m_BatchSize;
+    size_t                     m_DatagramSize;
+    size_t                     m_ControlSize;
+    std::unique_ptr<char[]>    m_Buffers;
+    std::unique_ptr<char[]>    m_Controls;
+    std::unique_ptr<mmsghdr[]> m_Headers;
+    std::unique_ptr<iovec[]>   m_Vectors;
+    std::vector<int64_t>       m_ReceiveTimes;
+    uint64_t                   m_SystemCalls;
+};
+
+#endif
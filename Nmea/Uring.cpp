@@ -0,0 +1,207 @@
+﻿#include "Uring.h"
+
+#if defined(__linux__)
+
+#include <algorithm>
+#include <cerrno>
+#include <system_error>
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace
+{
+    [[noreturn]] void throwSystemError(const char* what)
+    {
+        throw std::system_error(errno, std::generic_category(), what);
+    }
+
+    void* map(size_t size, int fd, off_t offset)
+    {
+        void* memory = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, offset);
+        return memory == MAP_FAILED ? nullptr : memory;
+    }
+}
+
+Uring::Uring(unsigned entries, unsigned buffers, unsigned bufferSize) :
+    m_Fd(-1),
+    m_SqRing(nullptr),
+    m_SqRingSize(0),
+    m_CqRing(nullptr),
+    m_CqRingSize(0),
+    m_Sqes(nullptr),
+    m_SqesSize(0),
+    m_SqHead(nullptr),
+    m_SqTailShared(nullptr),
+    m_SqTail(0),
+    m_SqMask(0),
+    m_SqEntries(0),
+    m_CqHead(nullptr),
+    m_CqTail(nullptr),
+    m_CqMask(0),
+    m_Cqes(nullptr),
+    m_Buffers(nullptr),
+    m_BufferCount(buffers),
+    m_BufferSize(bufferSize),
+    m_Mutex()
+{
+    io_uring_params parameters{};
+    m_Fd = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &parameters));
+    if (m_Fd < 0)
+        throwSystemError("io_uring_setup");
+
+    try
+    {
+        m_SqRingSize = parameters.sq_off.array + parameters.sq_entries * sizeof(unsigned);
+        m_CqRingSize = parameters.cq_off.cqes + parameters.cq_entries * sizeof(io_uring_cqe);
+
+        if (parameters.features & IORING_FEAT_SINGLE_MMAP)
+        {
+            m_SqRingSize = m_CqRingSize = std::max(m_SqRingSize, m_CqRingSize);
+            m_SqRing = m_CqRing = map(m_SqRingSize, m_Fd, IORING_OFF_SQ_RING);
+        }
+        else
+        {
+            m_SqRing = map(m_SqRingSize, m_Fd, IORING_OFF_SQ_RING);
+            m_CqRing = map(m_CqRingSize, m_Fd, IORING_OFF_CQ_RING);
+        }
+
+        m_SqesSize = parameters.sq_entries * sizeof(io_uring_sqe);
+        m_Sqes = static_cast<io_uring_sqe*>(map(m_SqesSize, m_Fd, IORING_OFF_SQES));
+
+        if (m_SqRing == nullptr || m_CqRing == nullptr || m_Sqes == nullptr)
+            throwSystemError("mmap");
+
+        auto sq = static_cast<char*>(m_SqRing);
+        m_SqHead = reinterpret_cast<unsigned*>(sq + parameters.sq_off.head);
+        m_SqTailShared = reinterpret_cast<unsigned*>(sq + parameters.sq_off.tail);
+        m_SqTail = *m_SqTailShared;
+        m_SqMask = *reinterpret_cast<unsigned*>(sq + parameters.sq_off.ring_mask);
+        m_SqEntries = parameters.sq_entries;
+
+        // Entry i of the submission queue is always slot i of the entry array
+        auto array = reinterpret_cast<unsigned*>(sq + parameters.sq_off.array);
+        for (unsigned i = 0; i < m_SqEntries; ++i)
+            array[i] = i;
+
+        auto cq = static_cast<char*>(m_CqRing);
+        m_CqHead = reinterpret_cast<unsigned*>(cq + parameters.cq_off.head);
+        m_CqTail = reinterpret_cast<unsigned*>(cq + parameters.cq_off.tail);
+        m_CqMask = *reinterpret_cast<unsigned*>(cq + parameters.cq_off.ring_mask);
+        m_Cqes = reinterpret_cast<io_uring_cqe*>(cq + parameters.cq_off.cqes);
+
+        void* memory = ::mmap(nullptr, static_cast<size_t>(m_BufferCount) * m_BufferSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED)
+            throwSystemError("mmap");
+        m_Buffers = static_cast<char*>(memory);
+
+        provide(0, m_BufferCount);
+        submit();
+    }
+    catch (...)
+    {
+        release();
+        throw;
+    }
+}
+
+Uring::~Uring()
+{
+    release();
+}
+
+void Uring::release() noexcept
+{
+    if (m_Buffers != nullptr)
+        ::munmap(m_Buffers, static_cast<size_t>(m_BufferCount) * m_BufferSize);
+    if (m_Sqes != nullptr)
+        ::munmap(m_Sqes, m_SqesSize);
+    if (m_CqRing != nullptr && m_CqRing != m_SqRing)
+        ::munmap(m_CqRing, m_CqRingSize);
+    if (m_SqRing != nullptr)
+        ::munmap(m_SqRing, m_SqRingSize);
+    if (m_Fd >= 0)
+        ::close(m_Fd);
+
+    m_Buffers = nullptr;
+    m_Sqes = nullptr;
+    m_CqRing = m_SqRing = nullptr;
+    m_Fd = -1;
+}
+
+bool Uring::available() noexcept
+{
+    static const bool available = [] {
+        try
+        {
+            Uring probe(2, 1, 64);
+            return true;
+        }
+        catch (const std::exception&)
+        {
+            return false;
+        }
+    }();
+
+    return available;
+}
+
+void Uring::submit()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    enter(m_SqTail - __atomic_load_n(m_SqHead, __ATOMIC_ACQUIRE), 0, 0);
+}
+
+void Uring::wait()
+{
+    unsigned queued;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        queued = m_SqTail - __atomic_load_n(m_SqHead, __ATOMIC_ACQUIRE);
+    }
+
+    // Not under the lock, so other threads can enqueue while this one waits
+    enter(queued, 1, IORING_ENTER_GETEVENTS);
+}
+
+std::string_view Uring::buffer(uint32_t flags, int32_t length) const noexcept
+{
+    const unsigned id = flags >> IORING_CQE_BUFFER_SHIFT;
+    return std::string_view(m_Buffers + static_cast<size_t>(id) * m_BufferSize, static_cast<size_t>(length));
+}
+
+void Uring::recycle(uint32_t flags)
+{
+    provide(flags >> IORING_CQE_BUFFER_SHIFT, 1);
+}
+
+void Uring::provide(unsigned id, unsigned count)
+{
+    enqueue([&](io_uring_sqe& sqe) {
+        sqe.opcode = IORING_OP_PROVIDE_BUFFERS;
+        sqe.fd = static_cast<int32_t>(count);
+        sqe.addr = reinterpret_cast<uint64_t>(m_Buffers + static_cast<size_t>(id) * m_BufferSize);
+        sqe.len = m_BufferSize;
+        sqe.off = id;
+        sqe.buf_group = bufferGroup;
+        sqe.user_data = provided;
+    });
+}
+
+void Uring::enter(unsigned submit, unsigned waitFor, unsigned flags)
+{
+    if (submit == 0 && waitFor == 0)
+        return;
+
+    while (::syscall(__NR_io_uring_enter, m_Fd, submit, waitFor, flags, nullptr, 0) < 0)
+    {
+        // Interrupted, or the completion queue is full and shall be handled first
+        if (errno != EINTR && errno != EAGAIN && errno != EBUSY)
+            throwSystemError("io_uring_enter");
+        if (errno != EINTR)
+            return;
+    }
+}
+
+#endif
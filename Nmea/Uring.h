@@ -0,0 +1,136 @@
+﻿#pragma once
+
+#if defined(__linux__)
+
+#include <cstdint>
+#include <mutex>
+#include <string_view>
+
+#include <linux/io_uring.h>
+
+/// <summary>
+///        A minimal io_uring: a submission queue, a completion queue and a pool of provided receive buffers.
+/// </summary>
+/// The ring is set up with the raw system calls, so liburing is not needed.
+/// Any thread may enqueue and submit, completions shall be handled by one thread at a time.
+/// The user data 0 is used for giving buffers back to the kernel, and shall not be used by the requests.
+/// \note Linux only, io_uring with provided buffers needs Linux 5.7.
+class Uring
+{
+public:
+    /// The buffer group of the provided buffers, for IOSQE_BUFFER_SELECT
+    static const uint16_t bufferGroup = 0;
+
+    /// <summary>
+    ///        Sets up the ring and provides the receive buffers.
+    /// </summary>
+    /// \param entries [in] The size of the submission queue.
+    /// \param buffers [in] The number of provided buffers.
+    /// \param bufferSize [in] The size of each provided buffer.
+    /// \exception std::system_error if io_uring is not available
+    Uring(unsigned entries = 256, unsigned buffers = 256, unsigned bufferSize = 4096);
+    ~Uring();
+
+    Uring(const Uring&) = delete;
+    Uring& operator=(const Uring&) = delete;
+
+    /// <summary>
+    ///        Checks once if io_uring can be set up, it may be missing or disabled by the kernel or a sandbox.
+    /// </summary>
+    static bool available() noexcept;
+
+    /// <summary>
+    ///        Queues a request without submitting it.
+    /// </summary>
+    /// \param prepare [in] Called with a cleared submission queue entry to fill in.
+    template<typename Prepare>
+    void enqueue(Prepare&& prepare)
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+
+        if (m_SqTail - __atomic_load_n(m_SqHead, __ATOMIC_ACQUIRE) == m_SqEntries)
+            enter(m_SqEntries, 0, 0);
+
+        io_uring_sqe& sqe = m_Sqes[m_SqTail & m_SqMask];
+        sqe = io_uring_sqe{};
+        prepare(sqe);
+        __atomic_store_n(m_SqTailShared, ++m_SqTail, __ATOMIC_RELEASE);
+    }
+
+    /// <summary>
+    ///        Submits the queued requests.
+    /// </summary>
+    void submit();
+
+    /// <summary>
+    ///        Submits the queued requests and waits for at least one completion.
+    /// </summary>
+    void wait();
+
+    /// <summary>
+    ///        Hands out each completion.
+    /// </summary>
+    /// \param handler [in] Called with each completion queue entry.
+    /// \return The number of completions
+    template<typename Handler>
+    unsigned complete(Handler&& handler)
+    {
+        unsigned head = *m_CqHead;
+        const unsigned tail = __atomic_load_n(m_CqTail, __ATOMIC_ACQUIRE);
+
+        const unsigned count = tail - head;
+        for (; head != tail; ++head)
+        {
+            // Copied, so the entry can be reused while the handler runs
+            const io_uring_cqe cqe = m_Cqes[head & m_CqMask];
+            __atomic_store_n(m_CqHead, head + 1, __ATOMIC_RELEASE);
+            if (cqe.user_data != provided)
+                handler(cqe);
+        }
+
+        return count;
+    }
+
+    /// <summary>
+    ///        The data received into a provided buffer.
+    /// </summary>
+    /// \param flags [in] The flags of the completion, with IORING_CQE_F_BUFFER set.
+    /// \param length [in] The result of the completion.
+    std::string_view buffer(uint32_t flags, int32_t length) const noexcept;
+
+    /// <summary>
+    ///        Gives a provided buffer back to the kernel once its data has been handled.
+    /// </summary>
+    /// The buffer is handed over with the next submission.
+    void recycle(uint32_t flags);
+
+private:
+    static const uint64_t provided = 0;
+
+    void provide(unsigned id, unsigned count);
+    void release() noexcept;
+    void enter(unsigned submit, unsigned waitFor, unsigned flags);
+
+    int           m_Fd;
+    void*         m_SqRing;
+    size_t        m_SqRingSize;
+    void*         m_CqRing;
+    size_t        m_CqRingSize;
+    io_uring_sqe* m_Sqes;
+    size_t        m_SqesSize;
+    unsigned*     m_SqHead;
+    unsigned*     m_SqTailShared;
+    unsigned      m_SqTail;
+    unsigned      m_SqMask;
+    unsigned      m_SqEntries;
+    unsigned*     m_CqHead;
+    unsigned*     m_CqTail;
+    unsigned      m_CqMask;
+    io_uring_cqe* m_Cqes;
+    char*         m_Buffers;
+    unsigned      m_BufferCount;
+    unsigned      m_BufferSize;
+    std::mutex    m_Mutex;
+};
+
+#endif
@@ -0,0 +1,28 @@
+﻿#include "Validation.h"
+
+#include <limits>
+
+ValidationLevels::ValidationLevels(Validation level) :
+    m_Levels(std::make_unique<std::atomic<uint8_t>[]>(size_t(std::numeric_limits<SourceId>::max()) + 1)),
+    m_Default(static_cast<uint8_t>(level))
+{
+    for (size_t source = 0; source <= std::numeric_limits<SourceId>::max(); ++source)
+        m_Levels[source].store(unset, std::memory_order_relaxed);
+}
+
+const char* ValidationLevels::name(Validation level) noexcept
+{
+    switch (level)
+    {
+    case Validation::framing:
+        return "framing";
+    case Validation::checksum:
+        return "checksum";
+    case Validation::general:
+        return "general";
+    case Validation::full:
+        return "full";
+    }
+
+    return "unknown";
+}
@@ -0,0 +1,68 @@
+﻿#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+#include "SourceInterner.h"
+
+/// <summary>
+///        How deep Nmea::parse checks a line. Each level includes the checks of the levels before it.
+/// </summary>
+/// The tag block parameters are checked and decoded at every level, as the source and sentence grouping
+/// of a line are needed however far its sentence is checked.
+enum class Validation : uint8_t
+{
+    framing,    ///< Tag blocks, sentence, fields and CR LF found, checksum and length fields present
+    checksum,   ///< The checksums and the length of the sentence
+    general,    ///< The characters of the address and data fields (parseGeneralContents)
+    full        ///< The fields of the sentence formatter (parseSpecificContents)
+};
+
+/// <summary>
+///        The validation level of each source.
+/// </summary>
+/// The levels can be changed while parsers read them, e.g. to validate a trusted internal feed or an archive
+/// scan less than the lines received from outside.
+/// \code{.cpp}
+///     ValidationLevels levels;
+///     levels.set(SourceInterner::global().intern("archive"), Validation::checksum);
+///     Nmea nmea;
+///     nmea.setValidation(&levels);
+/// \endcode
+class ValidationLevels
+{
+public:
+    /// <summary>
+    ///        Creates a table validating every source at the same level.
+    /// </summary>
+    explicit ValidationLevels(Validation level = Validation::full);
+
+    ValidationLevels(const ValidationLevels&) = delete;
+    ValidationLevels& operator=(const ValidationLevels&) = delete;
+
+    /// The level of the sources without a level of their own, including noSource
+    void setDefault(Validation level) noexcept { m_Default.store(static_cast<uint8_t>(level), std::memory_order_relaxed); }
+
+    /// Sets the level of a source
+    void set(SourceId source, Validation level) noexcept { m_Levels[source].store(static_cast<uint8_t>(level), std::memory_order_relaxed); }
+
+    /// Makes a source use the default level again
+    void reset(SourceId source) noexcept { m_Levels[source].store(unset, std::memory_order_relaxed); }
+
+    /// The level of a source
+    Validation of(SourceId source) const noexcept
+    {
+        const uint8_t level = m_Levels[source].load(std::memory_order_relaxed);
+        return static_cast<Validation>(level != unset ? level : m_Default.load(std::memory_order_relaxed));
+    }
+
+    /// The name of a level, e.g. "checksum"
+    static const char* name(Validation level) noexcept;
+
+private:
+    static const uint8_t unset = 0xFF;
+
+    std::unique_ptr<std::atomic<uint8_t>[]> m_Levels;
+    std::atomic<uint8_t>                    m_Default;
+};